@@ -0,0 +1,517 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "scheme.h"
+
+/*
+  exact integers: fixnums, and bignums past their 48 bits. a bignum is
+  a sign and a magnitude, 64 bit limbs least significant first, kept in
+  the string pool (see make_bignum); anything small enough to be a
+  fixnum is one, so every integer has exactly one representation.
+
+  the arithmetic works on magnitudes as plain arrays. an operand's limbs
+  are read in place, which is safe because nothing here conses (the pool
+  only moves when a collection compacts it); answers are built in
+  scratch memory, and copied into the pool at the end.
+
+  multiplication is schoolbook for small operands, and karatsuba once
+  both have KARATSUBA_LIMBS: splitting each in half, three half sized
+  products stand in for four
+
+    a b = z2 B^2m + (z1 - z2 - z0) B^m + z0
+    z2  = a1 b1,  z0 = a0 b0,  z1 = (a1 + a0)(b1 + b0)
+
+  operands more than twice the other's size get multiplied a slice at a
+  time, so the halves stay balanced. division is knuth's long division,
+  a limb of quotient at a time.
+*/
+
+#define KARATSUBA_LIMBS 32
+
+typedef unsigned __int128 wide_t;
+
+// an exact integer's sign and magnitude; a fixnum's single limb is
+// kept in small, so these can't be copied once loaded
+typedef struct exact {
+  bool      negative;
+  int       size;
+  uint64_t *limbs;
+  uint64_t  small;
+} exact_t;
+
+static void exact_load(context_p ctxt, value_t v, exact_t *x) {
+  if (is_integer(ctxt, v)) {
+    int64_t n   = as_integer(ctxt, v);
+    x->negative = n < 0;
+    x->small    = n < 0 ? -(uint64_t)n : (uint64_t)n;
+    x->limbs    = &x->small;
+    x->size     = n != 0;
+    return;
+  }
+
+  x->negative = bignum_negative(ctxt, v);
+  x->size     = bignum_size(ctxt, v);
+  x->limbs    = bignum_limbs(ctxt, v);
+}
+
+static uint64_t* alloc_limbs(int count) {
+  uint64_t *limbs = calloc(count > 0 ? count : 1, sizeof(uint64_t));
+  if (limbs == NULL) {
+    fprintf(stderr, "out of memory!\n");
+    exit(1);
+  }
+
+  return limbs;
+}
+
+// the answer's in scratch limbs, which this frees
+static value_t exact_make(context_p ctxt, bool negative, uint64_t *limbs, int size) {
+  value_t v = make_bignum(ctxt, negative, limbs, size);
+  free(limbs);
+  return v;
+}
+
+/* magnitudes */
+
+static int mag_trim(const uint64_t *a, int n) {
+  while (n > 0 && a[n - 1] == 0) {
+    n--;
+  }
+  return n;
+}
+
+static int mag_compare(const uint64_t *a, int an, const uint64_t *b, int bn) {
+  if (an != bn) {
+    return an < bn ? -1 : 1;
+  }
+
+  for (int i = an - 1; i >= 0; i--) {
+    if (a[i] != b[i]) {
+      return a[i] < b[i] ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+// r = a + b, with room for the longer one and a carry; answers r's size
+static int mag_add(const uint64_t *a, int an, const uint64_t *b, int bn, uint64_t *r) {
+  if (an < bn) {
+    const uint64_t *t = a; a = b; b = t;
+    int tn = an; an = bn; bn = tn;
+  }
+
+  uint64_t carry = 0;
+  int i = 0;
+  for (; i < bn; i++) {
+    wide_t sum = (wide_t)a[i] + b[i] + carry;
+    r[i]  = (uint64_t)sum;
+    carry = (uint64_t)(sum >> 64);
+  }
+  for (; i < an; i++) {
+    wide_t sum = (wide_t)a[i] + carry;
+    r[i]  = (uint64_t)sum;
+    carry = (uint64_t)(sum >> 64);
+  }
+  r[an] = carry;
+
+  return an + (carry != 0);
+}
+
+// r = a - b, where a >= b; r can be a
+static int mag_sub(const uint64_t *a, int an, const uint64_t *b, int bn, uint64_t *r) {
+  uint64_t borrow = 0;
+  for (int i = 0; i < an; i++) {
+    uint64_t x = a[i];
+    uint64_t y = i < bn ? b[i] : 0;
+    r[i]   = x - y - borrow;
+    borrow = x < y || (x - y) < borrow;
+  }
+
+  return mag_trim(r, an);
+}
+
+// r += a, within r's rn limbs
+static void mag_add_into(uint64_t *r, int rn, const uint64_t *a, int an) {
+  uint64_t carry = 0;
+  int i = 0;
+  for (; i < an; i++) {
+    wide_t sum = (wide_t)r[i] + a[i] + carry;
+    r[i]  = (uint64_t)sum;
+    carry = (uint64_t)(sum >> 64);
+  }
+  for (; carry && i < rn; i++) {
+    carry = ++r[i] == 0;
+  }
+}
+
+// r -= a, where r >= a
+static void mag_sub_into(uint64_t *r, int rn, const uint64_t *a, int an) {
+  uint64_t borrow = 0;
+  int i = 0;
+  for (; i < an; i++) {
+    uint64_t x = r[i];
+    r[i]   = x - a[i] - borrow;
+    borrow = x < a[i] || (x - a[i]) < borrow;
+  }
+  for (; borrow && i < rn; i++) {
+    borrow = r[i]-- == 0;
+  }
+}
+
+// r = a b, into an + bn zeroed limbs
+static void mul_schoolbook(const uint64_t *a, int an, const uint64_t *b, int bn, uint64_t *r) {
+  for (int i = 0; i < an; i++) {
+    uint64_t carry = 0;
+    for (int j = 0; j < bn; j++) {
+      wide_t product = (wide_t)a[i] * b[j] + r[i + j] + carry;
+      r[i + j] = (uint64_t)product;
+      carry    = (uint64_t)(product >> 64);
+    }
+    r[i + bn] = carry;
+  }
+}
+
+// r = a b, into an + bn zeroed limbs
+static void mag_mul(const uint64_t *a, int an, const uint64_t *b, int bn, uint64_t *r) {
+  if (an < bn) {
+    const uint64_t *t = a; a = b; b = t;
+    int tn = an; an = bn; bn = tn;
+  }
+
+  if (bn < KARATSUBA_LIMBS) {
+    mul_schoolbook(a, an, b, bn, r);
+    return;
+  }
+
+  if (an >= 2 * bn) {
+    uint64_t *slice = alloc_limbs(2 * bn);
+    for (int at = 0; at < an; at += bn) {
+      int n = an - at < bn ? an - at : bn;
+      memset(slice, 0, 2 * bn * sizeof(uint64_t));
+      mag_mul(a + at, n, b, bn, slice);
+      mag_add_into(r + at, an + bn - at, slice, mag_trim(slice, n + bn));
+    }
+    free(slice);
+    return;
+  }
+
+  // bn > m, so both high halves are non empty
+  int m   = an / 2;
+  int a0n = mag_trim(a, m);
+  int b0n = mag_trim(b, m);
+  int a1n = an - m;
+  int b1n = bn - m;
+
+  // z0 and z2 land in place, z1 is added over the middle
+  mag_mul(a, a0n, b, b0n, r);
+  mag_mul(a + m, a1n, b + m, b1n, r + 2 * m);
+
+  uint64_t *sa = alloc_limbs(a1n + 1);
+  uint64_t *sb = alloc_limbs(a1n + 1);
+  int san = mag_add(a, a0n, a + m, a1n, sa);
+  int sbn = mag_add(b, b0n, b + m, b1n, sb);
+
+  uint64_t *z1 = alloc_limbs(san + sbn);
+  mag_mul(sa, san, sb, sbn, z1);
+  int z1n = mag_trim(z1, san + sbn);
+
+  mag_sub_into(z1, z1n, r, mag_trim(r, 2 * m));
+  mag_sub_into(z1, z1n, r + 2 * m, mag_trim(r + 2 * m, an + bn - 2 * m));
+  mag_add_into(r + m, an + bn - m, z1, mag_trim(z1, z1n));
+
+  free(sa);
+  free(sb);
+  free(z1);
+}
+
+// a = a / d, answering the remainder
+static uint64_t mag_divide_small(uint64_t *a, int an, uint64_t d) {
+  wide_t rem = 0;
+  for (int i = an - 1; i >= 0; i--) {
+    wide_t n = (rem << 64) | a[i];
+    a[i] = (uint64_t)(n / d);
+    rem  = n % d;
+  }
+  return (uint64_t)rem;
+}
+
+// q = a / b and r = a % b, where an >= bn >= 2; q has an - bn + 1 limbs,
+// and r has bn. knuth's algorithm d: each quotient limb is estimated
+// from the top limbs, off by at most two, after shifting b's top bit up
+static void mag_divide(const uint64_t *a, int an, const uint64_t *b, int bn, uint64_t *q, uint64_t *r) {
+  int shift = __builtin_clzll(b[bn - 1]);
+  uint64_t *u = alloc_limbs(an + 1);
+  uint64_t *v = alloc_limbs(bn);
+
+  for (int i = bn - 1; i > 0; i--) {
+    v[i] = (b[i] << shift) | (shift ? b[i - 1] >> (64 - shift) : 0);
+  }
+  v[0] = b[0] << shift;
+
+  u[an] = shift ? a[an - 1] >> (64 - shift) : 0;
+  for (int i = an - 1; i > 0; i--) {
+    u[i] = (a[i] << shift) | (shift ? a[i - 1] >> (64 - shift) : 0);
+  }
+  u[0] = a[0] << shift;
+
+  for (int j = an - bn; j >= 0; j--) {
+    wide_t top  = ((wide_t)u[j + bn] << 64) | u[j + bn - 1];
+    wide_t qhat = top / v[bn - 1];
+    wide_t rhat = top % v[bn - 1];
+
+    while (qhat >> 64 || qhat * v[bn - 2] > ((rhat << 64) | u[j + bn - 2])) {
+      qhat--;
+      rhat += v[bn - 1];
+      if (rhat >> 64) {
+        break;
+      }
+    }
+
+    // u -= qhat v, at j
+    uint64_t carry  = 0;
+    uint64_t borrow = 0;
+    for (int i = 0; i < bn; i++) {
+      wide_t   product = qhat * v[i] + carry;
+      uint64_t low     = (uint64_t)product;
+      uint64_t x       = u[i + j];
+      carry    = (uint64_t)(product >> 64);
+      u[i + j] = x - low - borrow;
+      borrow   = x < low || (x - low) < borrow;
+    }
+    uint64_t x = u[j + bn];
+    u[j + bn]  = x - carry - borrow;
+    borrow     = x < carry || (x - carry) < borrow;
+
+    // one too many, add v back
+    if (borrow) {
+      qhat--;
+      carry = 0;
+      for (int i = 0; i < bn; i++) {
+        wide_t sum = (wide_t)u[i + j] + v[i] + carry;
+        u[i + j] = (uint64_t)sum;
+        carry    = (uint64_t)(sum >> 64);
+      }
+      u[j + bn] += carry;
+    }
+
+    q[j] = (uint64_t)qhat;
+  }
+
+  for (int i = 0; i < bn; i++) {
+    r[i] = (u[i] >> shift) | (shift ? u[i + 1] << (64 - shift) : 0);
+  }
+
+  free(u);
+  free(v);
+}
+
+/* exact integers */
+
+inline bool is_exact(context_p ctxt, value_t v) {
+  return is_integer(ctxt, v) || is_bignum(ctxt, v);
+}
+
+value_t make_exact(context_p ctxt, int64_t n) {
+  if (n >= FIXNUM_MIN && n <= FIXNUM_MAX) {
+    return make_integer(ctxt, n);
+  }
+
+  uint64_t limb = n < 0 ? -(uint64_t)n : (uint64_t)n;
+  return make_bignum(ctxt, n < 0, &limb, 1);
+}
+
+// x + y, with negative standing in for y's sign, so this subtracts too
+static value_t exact_add_signed(context_p ctxt, exact_t *x, exact_t *y, bool negative) {
+  int size = (x->size > y->size ? x->size : y->size) + 1;
+  uint64_t *r = alloc_limbs(size);
+
+  if (x->negative == negative) {
+    size = mag_add(x->limbs, x->size, y->limbs, y->size, r);
+    negative = x->negative;
+  } else if (mag_compare(x->limbs, x->size, y->limbs, y->size) >= 0) {
+    size = mag_sub(x->limbs, x->size, y->limbs, y->size, r);
+    negative = x->negative;
+  } else {
+    size = mag_sub(y->limbs, y->size, x->limbs, x->size, r);
+  }
+
+  return exact_make(ctxt, negative, r, size);
+}
+
+value_t exact_add(context_p ctxt, value_t a, value_t b) {
+  if (is_integer(ctxt, a) && is_integer(ctxt, b)) {
+    return make_exact(ctxt, as_integer(ctxt, a) + as_integer(ctxt, b));
+  }
+
+  exact_t x, y;
+  exact_load(ctxt, a, &x);
+  exact_load(ctxt, b, &y);
+  return exact_add_signed(ctxt, &x, &y, y.negative);
+}
+
+value_t exact_sub(context_p ctxt, value_t a, value_t b) {
+  if (is_integer(ctxt, a) && is_integer(ctxt, b)) {
+    return make_exact(ctxt, as_integer(ctxt, a) - as_integer(ctxt, b));
+  }
+
+  exact_t x, y;
+  exact_load(ctxt, a, &x);
+  exact_load(ctxt, b, &y);
+  return exact_add_signed(ctxt, &x, &y, !y.negative);
+}
+
+value_t exact_mul(context_p ctxt, value_t a, value_t b) {
+  int64_t n;
+  if (is_integer(ctxt, a) && is_integer(ctxt, b) &&
+      !__builtin_mul_overflow(as_integer(ctxt, a), as_integer(ctxt, b), &n)) {
+    return make_exact(ctxt, n);
+  }
+
+  exact_t x, y;
+  exact_load(ctxt, a, &x);
+  exact_load(ctxt, b, &y);
+
+  uint64_t *r = alloc_limbs(x.size + y.size);
+  mag_mul(x.limbs, x.size, y.limbs, y.size, r);
+  return exact_make(ctxt, x.negative != y.negative, r, x.size + y.size);
+}
+
+// the quotient's sign is the signs multiplied, the remainder's is a's
+void exact_divide(context_p ctxt, value_t a, value_t b, value_t *quotient, value_t *remainder) {
+  if (is_integer(ctxt, a) && is_integer(ctxt, b)) {
+    int64_t x = as_integer(ctxt, a);
+    int64_t y = as_integer(ctxt, b);
+    *quotient  = make_exact(ctxt, x / y);
+    *remainder = make_integer(ctxt, x % y);
+    return;
+  }
+
+  exact_t x, y;
+  exact_load(ctxt, a, &x);
+  exact_load(ctxt, b, &y);
+
+  if (mag_compare(x.limbs, x.size, y.limbs, y.size) < 0) {
+    *quotient  = make_integer(ctxt, 0);
+    *remainder = a;
+    return;
+  }
+
+  int size = x.size - y.size + 1;
+  uint64_t *q = alloc_limbs(size);
+  uint64_t *r = alloc_limbs(y.size);
+  if (y.size == 1) {
+    memcpy(q, x.limbs, x.size * sizeof(uint64_t));
+    r[0] = mag_divide_small(q, x.size, y.limbs[0]);
+  } else {
+    mag_divide(x.limbs, x.size, y.limbs, y.size, q, r);
+  }
+
+  *quotient  = exact_make(ctxt, x.negative != y.negative, q, size);
+  *remainder = exact_make(ctxt, x.negative, r, y.size);
+}
+
+int exact_compare(context_p ctxt, value_t a, value_t b) {
+  if (is_integer(ctxt, a) && is_integer(ctxt, b)) {
+    int64_t x = as_integer(ctxt, a);
+    int64_t y = as_integer(ctxt, b);
+    return (x > y) - (x < y);
+  }
+
+  exact_t x, y;
+  exact_load(ctxt, a, &x);
+  exact_load(ctxt, b, &y);
+
+  if (x.negative != y.negative) {
+    return x.negative ? -1 : 1;
+  }
+
+  int order = mag_compare(x.limbs, x.size, y.limbs, y.size);
+  return x.negative ? -order : order;
+}
+
+double exact_double(context_p ctxt, value_t v) {
+  if (is_integer(ctxt, v)) {
+    return (double)as_integer(ctxt, v);
+  }
+
+  exact_t x;
+  exact_load(ctxt, v, &x);
+
+  double d = 0;
+  for (int i = x.size - 1; i >= 0; i--) {
+    d = ldexp(d, 64) + (double)x.limbs[i];
+  }
+  return x.negative ? -d : d;
+}
+
+/* decimal, 19 digits at a time (the most a limb holds) */
+
+#define DECIMAL_DIGITS 19
+#define DECIMAL_BASE   10000000000000000000ULL
+
+value_t exact_parse(context_p ctxt, const char *digits, int len, bool negative) {
+  uint64_t *r = alloc_limbs(len / DECIMAL_DIGITS + 2);
+  int size = 0;
+
+  // the first chunk takes the odd digits, so the rest are full
+  int at = 0;
+  int n  = len % DECIMAL_DIGITS ? len % DECIMAL_DIGITS : DECIMAL_DIGITS;
+  for (; at < len; at += n, n = DECIMAL_DIGITS) {
+    uint64_t chunk = 0;
+    uint64_t scale = 1;
+    for (int i = at; i < at + n; i++) {
+      chunk = chunk * 10 + (uint64_t)(digits[i] - '0');
+      scale *= 10;
+    }
+
+    uint64_t carry = chunk;
+    for (int i = 0; i < size; i++) {
+      wide_t sum = (wide_t)r[i] * scale + carry;
+      r[i]  = (uint64_t)sum;
+      carry = (uint64_t)(sum >> 64);
+    }
+    if (carry) {
+      r[size++] = carry;
+    }
+  }
+
+  return exact_make(ctxt, negative, r, size);
+}
+
+char* exact_format(context_p ctxt, value_t v, int *len) {
+  exact_t x;
+  exact_load(ctxt, v, &x);
+
+  // a limb is under 20 digits
+  int limit = x.size * 20 + 2;
+  char *str = malloc(limit);
+  uint64_t *q = alloc_limbs(x.size);
+  if (str == NULL) {
+    fprintf(stderr, "out of memory!\n");
+    exit(1);
+  }
+  memcpy(q, x.limbs, x.size * sizeof(uint64_t));
+
+  // digits come out backwards, from the end of str
+  int at = limit;
+  int size = x.size;
+  str[--at] = '\0';
+  do {
+    uint64_t chunk = mag_divide_small(q, size, DECIMAL_BASE);
+    size = mag_trim(q, size);
+    for (int i = 0; i < DECIMAL_DIGITS && (size > 0 || chunk > 0 || i == 0); i++) {
+      str[--at] = '0' + chunk % 10;
+      chunk /= 10;
+    }
+  } while (size > 0);
+
+  if (x.negative) {
+    str[--at] = '-';
+  }
+
+  *len = limit - 1 - at;
+  memmove(str, str + at, *len + 1);
+  free(q);
+  return str;
+}
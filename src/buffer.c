@@ -0,0 +1,149 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "scheme.h"
+
+/*
+  buffers: raw bytes, for binary payloads that shouldn't be inflated
+  into lists of characters or copied through the string pool.
+
+  a buffer is a slice (offset and length) of a malloc'd store, and
+  slicing one just makes another header onto the same store (see
+  make_buffer and buffer_slice), so a write through one slice shows
+  through every other that overlaps it. the bulk operations are
+  memset, memmove, memchr and memcmp over the slices, and files are
+  read and written straight from a buffer's bytes.
+
+  bytes are exact integers 0 to 255 on the way in and out.
+*/
+
+// an integer that fits in a byte
+static bool to_byte(context_p ctxt, value_t x, int *out) {
+  if (!is_integer(ctxt, x)) {
+    return false;
+  }
+
+  int64_t n = as_integer(ctxt, x);
+  *out = (int)n;
+  return n >= 0 && n <= UINT8_MAX;
+}
+
+value_t buffer_get(context_p ctxt, value_t v, int64_t index) {
+  if (!is_buffer(ctxt, v) || index < 0 || (uint64_t)index >= buffer_length(ctxt, v)) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  return make_integer(ctxt, (uint8_t)buffer_data(ctxt, v)[index]);
+}
+
+value_t buffer_set(context_p ctxt, value_t v, int64_t index, value_t byte) {
+  int b;
+  if (!is_buffer(ctxt, v) || index < 0 || (uint64_t)index >= buffer_length(ctxt, v) ||
+      !to_byte(ctxt, byte, &b)) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  buffer_data(ctxt, v)[index] = (char)b;
+  return vnil;
+}
+
+/* bulk operations */
+
+value_t buffer_fill(context_p ctxt, value_t v, value_t byte) {
+  int b;
+  if (!is_buffer(ctxt, v) || !to_byte(ctxt, byte, &b)) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  memset(buffer_data(ctxt, v), b, buffer_length(ctxt, v));
+  return vnil;
+}
+
+// all of from into to, starting at; they can share a store, and overlap
+value_t buffer_copy(context_p ctxt, value_t to, int64_t at, value_t from) {
+  if (!is_buffer(ctxt, to) || !is_buffer(ctxt, from) || at < 0 ||
+      (uint64_t)at > buffer_length(ctxt, to) ||
+      buffer_length(ctxt, from) > buffer_length(ctxt, to) - at) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  memmove(buffer_data(ctxt, to) + at, buffer_data(ctxt, from), buffer_length(ctxt, from));
+  return vnil;
+}
+
+// where byte first shows up at or after start, or #f
+value_t buffer_index(context_p ctxt, value_t v, value_t byte, int64_t start) {
+  int b;
+  if (!is_buffer(ctxt, v) || !to_byte(ctxt, byte, &b) ||
+      start < 0 || (uint64_t)start > buffer_length(ctxt, v)) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  char *data  = buffer_data(ctxt, v);
+  char *found = memchr(data + start, b, buffer_length(ctxt, v) - start);
+  return found ? make_integer(ctxt, found - data) : vfalse;
+}
+
+// -1, 0 or 1, comparing bytes as unsigned; a prefix sorts first
+value_t buffer_compare(context_p ctxt, value_t a, value_t b) {
+  if (!is_buffer(ctxt, a) || !is_buffer(ctxt, b)) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  uint64_t alen = buffer_length(ctxt, a);
+  uint64_t blen = buffer_length(ctxt, b);
+
+  int c = memcmp(buffer_data(ctxt, a), buffer_data(ctxt, b), alen < blen ? alen : blen);
+  if (c == 0) {
+    c = (alen > blen) - (alen < blen);
+  }
+  return make_integer(ctxt, (c > 0) - (c < 0));
+}
+
+/* files */
+
+// the whole of a regular file, read straight into a new buffer; path is
+// only looked at before anything's allocated, so it can be a string's
+value_t buffer_read_file(context_p ctxt, const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  struct stat st;
+  if (fstat(fileno(file), &st) < 0 || !S_ISREG(st.st_mode)) {
+    fclose(file);
+    return make_error(ctxt, __LINE__);
+  }
+
+  value_t buf = make_buffer(ctxt, st.st_size, 0);
+  if (is_error(ctxt, buf)) {
+    fclose(file);
+    return buf;
+  }
+
+  size_t got = fread(buffer_data(ctxt, buf), 1, st.st_size, file);
+  bool ok = got == (size_t)st.st_size && !ferror(file);
+  fclose(file);
+
+  return ok ? buf : make_error(ctxt, __LINE__);
+}
+
+value_t buffer_write_file(context_p ctxt, const char *path, value_t v, bool append) {
+  if (!is_buffer(ctxt, v)) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  FILE *file = fopen(path, append ? "ab" : "wb");
+  if (file == NULL) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  uint64_t len = buffer_length(ctxt, v);
+  bool ok = fwrite(buffer_data(ctxt, v), 1, len, file) == len;
+  ok = (fclose(file) == 0) && ok;
+
+  return ok ? vnil : make_error(ctxt, __LINE__);
+}
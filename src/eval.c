@@ -1,119 +1,809 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include "scheme.h"
 
-value_t eval(context_p ctxt, value_t v, value_t* env) {
- tailcall:
+/*
+  eval runs in two stages. analyze turns an expression into a tree of
+  nodes, once, and the machine below runs the nodes; the special forms
+  are recognized while analyzing, so running a procedure's body never
+  compares a symbol against them again.
+
+  a node is a vector, its kind first and then its fields
+
+    N_CONST     value
+    N_LOCAL     depth index               in a heap frame
+    N_SLOT      index                     in the stack frame
+    N_GLOBAL    index
+    N_IF        test then else
+    N_DEFINE    index value               at the top level
+    N_BIND      index value               inside a lambda, on the heap
+    N_BIND_SLOT index value               inside a lambda, on the stack
+    N_SEQ       node node...              a body, the last is the tail
+    N_LAMBDA    params slots body heap
+    N_CALL      operator arg...
+
+  variables are resolved while analyzing. a procedure has a slot for
+  each param, and each define in its body. if the body makes no
+  closures, nothing can keep hold of the slots, so they stay on the
+  stack where the args were; otherwise they're copied into a heap
+  frame, a vector of its parent (the env it captured) and then the
+  slots, the same as the vm's. a local in a heap frame is found by
+  following depth parents, counting only heap frames, and taking a
+  slot. anything else is a global, and its node holds the index of its
+  cell in ctxt->globals.
+
+  the machine doesn't recurse: whatever's left to do once a node has a
+  value is pushed on ctxt->eval_stack as a continuation, a few values
+  topped by a tag, and the loop carries on with the node. when there's
+  a value, the top continuation is popped and resumed with it.
+
+    K_IF       node                       pick a branch
+    K_SEQ      node index                 run the rest of the body
+    K_DEFINE   node                       bind the value
+    K_BIND     node                       fill in the slot
+    K_ARGS     node count                 (over the values so far) next one
+    K_RESTORE  env fp slots               back to the caller's frame
+
+  a procedure runs with its args on the stack, just above the proc
+  itself, at fp; the rest of a stack frame's slots go after them, and
+  a heap frame's args are dropped once they're copied. over those is a
+  K_RESTORE for the caller's registers, then the body's continuations.
+  a call with nothing over the K_RESTORE is a tail call: the new proc
+  and args slide down over the frame and keep the caller's K_RESTORE.
+
+  the stack is a gc root; it's limited to ctxt->eval_stack_max values,
+  past which eval gives up and answers an error.
+*/
+
+typedef enum {
+  N_CONST = 1,
+  N_LOCAL,
+  N_SLOT,
+  N_GLOBAL,
+  N_IF,
+  N_DEFINE,
+  N_BIND,
+  N_BIND_SLOT,
+  N_SEQ,
+  N_LAMBDA,
+  N_CALL,
+} node_kind_t;
+
+typedef enum {
+  K_IF = 1,
+  K_SEQ,
+  K_DEFINE,
+  K_BIND,
+  K_ARGS,
+  K_RESTORE,
+} continuation_t;
+
+/* nodes */
+
+static value_t make_node(context_p ctxt, node_kind_t kind, int fields) {
+  value_t node = make_vector(ctxt, fields + 1, vnil);
+  vector_set(ctxt, node, 0, make_integer(ctxt, kind));
+  return node;
+}
+
+inline static node_kind_t node_kind(context_p ctxt, value_t node) {
+  return (node_kind_t)as_integer(ctxt, vector_data(ctxt, node)[0]);
+}
+
+inline static value_t node_field(context_p ctxt, value_t node, int index) {
+  return vector_data(ctxt, node)[index + 1];
+}
+
+inline static int node_fields(context_p ctxt, value_t node) {
+  return vector_size(ctxt, node) - 1;
+}
+
+static value_t make_const(context_p ctxt, value_t v) {
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &v);
+
+  value_t node = make_node(ctxt, N_CONST, 1);
+  vector_set(ctxt, node, 1, v);
+
+  gc_unroot(ctxt, frame);
+  return node;
+}
+
+/* analysis */
+
+/*
+  the scope is a list of frames, innermost first, and each frame is
+  (heap . names), the names in slot order
+*/
+
+// finds sym's frame and slot, or false for a global; the depth only
+// counts heap frames, since those are all there are to follow
+static bool resolve(context_p ctxt, value_t scope, value_t sym, int *depth, int *index, bool *heap) {
+  *depth = 0;
+  for (; !is_nil(ctxt, scope); scope = cons_cdr(ctxt, scope)) {
+    value_t frame = cons_car(ctxt, scope);
+    *heap  = is_truthy(ctxt, cons_car(ctxt, frame));
+    *index = 0;
+    for (value_t names = cons_cdr(ctxt, frame); !is_nil(ctxt, names); names = cons_cdr(ctxt, names)) {
+      if (equality_exact(ctxt, cons_car(ctxt, names), sym)) {
+        return true;
+      }
+      (*index)++;
+    }
+    if (*heap) {
+      (*depth)++;
+    }
+  }
+
+  return false;
+}
+
+// names, with sym on the end unless it's already in there
+static value_t add_name(context_p ctxt, value_t names, value_t sym) {
+  value_t last = vnil;
+  for (value_t cursor = names; !is_nil(ctxt, cursor); cursor = cons_cdr(ctxt, cursor)) {
+    if (equality_exact(ctxt, cons_car(ctxt, cursor), sym)) {
+      return names;
+    }
+    last = cursor;
+  }
+
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &names);
+  gc_root(ctxt, &last);
+
+  value_t tail = make_cons(ctxt, sym, vnil);
+  gc_unroot(ctxt, frame);
+
+  if (is_nil(ctxt, last)) {
+    return tail;
+  }
+
+  cons_set_cdr(ctxt, last, tail);
+  return names;
+}
+
+// adds the names defined in v, but not inside a nested lambda
+value_t collect_defines(context_p ctxt, value_t v, value_t names) {
+  if (!is_cons(ctxt, v)) {
+    return names;
+  }
+
+  value_t car = cons_car(ctxt, v);
+  if (equality_exact(ctxt, symquote, car) || equality_exact(ctxt, symlambda, car)) {
+    return names;
+  }
+
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &v);
+  gc_root(ctxt, &names);
+
+  if (equality_exact(ctxt, symdefine, car)) {
+    names = add_name(ctxt, names, cons_cadr(ctxt, v));
+    names = collect_defines(ctxt, cons_caddr(ctxt, v), names);
+  }
+  else {
+    for (; is_cons(ctxt, v); v = cons_cdr(ctxt, v)) {
+      names = collect_defines(ctxt, cons_car(ctxt, v), names);
+    }
+  }
+
+  gc_unroot(ctxt, frame);
+  return names;
+}
+
+// whether v makes a closure anywhere
+bool has_lambda(context_p ctxt, value_t v) {
+  if (!is_cons(ctxt, v)) {
+    return false;
+  }
+
+  value_t car = cons_car(ctxt, v);
+  if (equality_exact(ctxt, symquote, car)) {
+    return false;
+  }
+  if (equality_exact(ctxt, symlambda, car)) {
+    return true;
+  }
+
+  for (; is_cons(ctxt, v); v = cons_cdr(ctxt, v)) {
+    if (has_lambda(ctxt, cons_car(ctxt, v))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static value_t analyze_in(context_p ctxt, value_t v, value_t scope);
+static value_t analyze_sequence(context_p ctxt, value_t body, value_t scope);
+
+// a procedure's frame: its params, then whatever its body defines
+value_t lambda_names(context_p ctxt, value_t v, int *params) {
+  value_t names  = vnil;
+  value_t cursor = vnil;
+
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &v);
+  gc_root(ctxt, &names);
+  gc_root(ctxt, &cursor);
+
+  for (cursor = cons_cadr(ctxt, v); !is_nil(ctxt, cursor); cursor = cons_cdr(ctxt, cursor)) {
+    names = add_name(ctxt, names, cons_car(ctxt, cursor));
+  }
+
+  *params = 0;
+  for (cursor = names; !is_nil(ctxt, cursor); cursor = cons_cdr(ctxt, cursor)) {
+    (*params)++;
+  }
+
+  names = collect_defines(ctxt, cons_cddr(ctxt, v), names);
+
+  gc_unroot(ctxt, frame);
+  return names;
+}
+
+static value_t analyze_lambda(context_p ctxt, value_t v, value_t scope) {
+  value_t names  = vnil;
+  value_t node   = vnil;
+
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &v);
+  gc_root(ctxt, &scope);
+  gc_root(ctxt, &names);
+  gc_root(ctxt, &node);
+
+  int params;
+  names = lambda_names(ctxt, v, &params);
+
+  int slots = 0;
+  for (value_t cursor = names; !is_nil(ctxt, cursor); cursor = cons_cdr(ctxt, cursor)) {
+    slots++;
+  }
+
+  bool heap = has_lambda(ctxt, cons_cddr(ctxt, v));
+  names = make_cons(ctxt, heap ? vtrue : vfalse, names);
+  scope = make_cons(ctxt, names, scope);
+
+  node = make_node(ctxt, N_LAMBDA, 4);
+  vector_set(ctxt, node, 1, make_integer(ctxt, params));
+  vector_set(ctxt, node, 2, make_integer(ctxt, slots));
+  vector_set(ctxt, node, 4, heap ? vtrue : vfalse);
+
+  value_t body = analyze_sequence(ctxt, cons_cddr(ctxt, v), scope);
+  vector_set(ctxt, node, 3, body);
+
+  gc_unroot(ctxt, frame);
+  return node;
+}
+
+static value_t analyze_in(context_p ctxt, value_t v, value_t scope) {
+  value_t node  = vnil;
+  value_t field = vnil;
+  value_t car   = vnil;
+  int depth, index;
+  bool heap;
+
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &v);
+  gc_root(ctxt, &scope);
+  gc_root(ctxt, &node);
+  gc_root(ctxt, &car);
+
   if (is_nil(ctxt, v)) {
-    return v;
+    node = make_const(ctxt, v);
+    goto done;
   }
 
   /* atoms */
   if (is_atom(ctxt, v)) {
     if (is_symbol(ctxt, v)) {
-      return environment_get(ctxt, *env, v);
+      // only the innermost frame can be on the stack; the ones around
+      // it all made a closure
+      if (!resolve(ctxt, scope, v, &depth, &index, &heap)) {
+        node = make_node(ctxt, N_GLOBAL, 1);
+        vector_set(ctxt, node, 1, make_integer(ctxt, global_index(ctxt, v)));
+      }
+      else if (heap) {
+        node = make_node(ctxt, N_LOCAL, 2);
+        vector_set(ctxt, node, 1, make_integer(ctxt, depth));
+        vector_set(ctxt, node, 2, make_integer(ctxt, index + 1));
+      }
+      else {
+        node = make_node(ctxt, N_SLOT, 1);
+        vector_set(ctxt, node, 1, make_integer(ctxt, index));
+      }
+      goto done;
     }
 
-    if (is_integer(ctxt, v))   { return v; }
-    if (is_character(ctxt, v)) { return v; }
-    if (is_float(ctxt, v))     { return v; }
-    if (is_double(ctxt, v))    { return v; }
-    if (is_string(ctxt, v))    { return v; }
-    if (is_boolean(ctxt, v))   { return v; }
+    if (is_exact(ctxt, v)     ||
+        is_character(ctxt, v) ||
+        is_float(ctxt, v)     ||
+        is_double(ctxt, v)    ||
+        is_string(ctxt, v)    ||
+        is_boolean(ctxt, v)) {
+      node = make_const(ctxt, v);
+      goto done;
+    }
 
     fprintf(stderr, "this object isn't handled currently\n");
-    return vnil;
+    node = make_const(ctxt, vnil);
+    goto done;
   }
 
   /* pairs */
-  else {
-    value_t car = cons_car(ctxt, v);
+  car = cons_car(ctxt, v);
+
+  // (quote ...)
+  if (equality_exact(ctxt, symquote, car)) {
+    node = make_const(ctxt, cons_cadr(ctxt, v));
+    goto done;
+  }
+
+  // (if test then else)
+  if (equality_exact(ctxt, symif, car)) {
+    node = make_node(ctxt, N_IF, 3);
+
+    field = analyze_in(ctxt, cons_cadr(ctxt, v), scope);
+    vector_set(ctxt, node, 1, field);
+    field = analyze_in(ctxt, cons_caddr(ctxt, v), scope);
+    vector_set(ctxt, node, 2, field);
+    field = analyze_in(ctxt, cons_cadddr(ctxt, v), scope);
+    vector_set(ctxt, node, 3, field);
+    goto done;
+  }
+
+  // (define name value), into the innermost frame if there is one
+  if (equality_exact(ctxt, symdefine, car)) {
+    if (is_nil(ctxt, scope)) {
+      node = make_node(ctxt, N_DEFINE, 2);
+      vector_set(ctxt, node, 1, make_integer(ctxt, global_index(ctxt, cons_cadr(ctxt, v))));
+    }
+    else {
+      resolve(ctxt, scope, cons_cadr(ctxt, v), &depth, &index, &heap);
+      node = make_node(ctxt, heap ? N_BIND : N_BIND_SLOT, 2);
+      vector_set(ctxt, node, 1, make_integer(ctxt, heap ? index + 1 : index));
+    }
+
+    field = analyze_in(ctxt, cons_caddr(ctxt, v), scope);
+    vector_set(ctxt, node, 2, field);
+    goto done;
+  }
+
+  // (begin ...)
+  if (equality_exact(ctxt, symbegin, car)) {
+    node = analyze_sequence(ctxt, cons_cdr(ctxt, v), scope);
+    goto done;
+  }
+
+  // (lambda (vars) body...)
+  if (equality_exact(ctxt, symlambda, car)) {
+    node = analyze_lambda(ctxt, v, scope);
+    goto done;
+  }
+
+  // otherwise it's an application, operator first
+  int count = 0;
+  for (car = v; !is_nil(ctxt, car); car = cons_cdr(ctxt, car)) {
+    count++;
+  }
+
+  node = make_node(ctxt, N_CALL, count);
+  car  = v;
+  for (int i = 1; i <= count; i++) {
+    field = analyze_in(ctxt, cons_car(ctxt, car), scope);
+    vector_set(ctxt, node, i, field);
+    car = cons_cdr(ctxt, car);
+  }
+
+ done:
+  gc_unroot(ctxt, frame);
+  return node;
+}
+
+static value_t analyze_sequence(context_p ctxt, value_t body, value_t scope) {
+  if (is_nil(ctxt, body)) {
+    return make_const(ctxt, vnil);
+  }
+
+  if (is_nil(ctxt, cons_cdr(ctxt, body))) {
+    return analyze_in(ctxt, cons_car(ctxt, body), scope);
+  }
+
+  value_t node   = vnil;
+  value_t cursor = body;
+
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &body);
+  gc_root(ctxt, &scope);
+  gc_root(ctxt, &node);
+  gc_root(ctxt, &cursor);
+
+  int count = 0;
+  for (; !is_nil(ctxt, cursor); cursor = cons_cdr(ctxt, cursor)) {
+    count++;
+  }
+
+  node   = make_node(ctxt, N_SEQ, count);
+  cursor = body;
+  for (int i = 1; i <= count; i++) {
+    value_t field = analyze_in(ctxt, cons_car(ctxt, cursor), scope);
+    vector_set(ctxt, node, i, field);
+    cursor = cons_cdr(ctxt, cursor);
+  }
+
+  gc_unroot(ctxt, frame);
+  return node;
+}
+
+// at the top level, outside any frame
+value_t analyze(context_p ctxt, value_t v) {
+  return analyze_in(ctxt, v, vnil);
+}
+
+/* the stack */
+
+// room for n more values, or false when that'd pass the limit
+bool eval_reserve(context_p ctxt, int n) {
+  value_stack_t *stack = &ctxt->eval_stack;
+  if (stack->size + n <= stack->limit) {
+    return true;
+  }
+
+  if (stack->size + n > ctxt->eval_stack_max) {
+    return false;
+  }
+
+  int limit = stack->limit ? stack->limit * 2 : 1024;
+  while (limit < stack->size + n) {
+    limit *= 2;
+  }
+  if (limit > ctxt->eval_stack_max) {
+    limit = ctxt->eval_stack_max;
+  }
+
+  value_t *values = realloc(stack->values, limit * sizeof(value_t));
+  if (values == NULL) {
+    fprintf(stderr, "out of memory!\n");
+    exit(1);
+  }
+
+  stack->limit  = limit;
+  stack->values = values;
+  return true;
+}
+
+inline static void eval_push(value_stack_t *stack, value_t v) {
+  stack->values[stack->size++] = v;
+}
+
+// anything pushed below the low water mark needs a look from the next
+// minor collection, everything under it was forwarded by the last one
+inline static void eval_drop(context_p ctxt, int n) {
+  value_stack_t *stack = &ctxt->eval_stack;
+  stack->size -= n;
+  if (stack->size < ctxt->eval_stack_clean) {
+    ctxt->eval_stack_clean = stack->size;
+  }
+}
+
+inline static value_t eval_pop(context_p ctxt) {
+  eval_drop(ctxt, 1);
+  return ctxt->eval_stack.values[ctxt->eval_stack.size];
+}
+
+// and a store under it brings it down too
+inline static void eval_store(context_p ctxt, int index, value_t v) {
+  ctxt->eval_stack.values[index] = v;
+  if (index < ctxt->eval_stack_clean) {
+    ctxt->eval_stack_clean = index;
+  }
+}
+
+/* the machine */
+
+// a K_RESTORE: the caller's env, fp and slots, then the tag
+#define RESTORE_SIZE 4
+
+// the frame depth frames out from env
+inline static value_t frame_up(context_p ctxt, value_t env, int depth) {
+  while (depth-- > 0) {
+    env = vector_data(ctxt, env)[0];
+  }
+  return env;
+}
+
+static value_t execute(context_p ctxt, value_t node, value_t* inoutenv) {
+  value_stack_t *stack = &ctxt->eval_stack;
+  int base = stack->size;
+
+  value_t env    = *inoutenv;
+  value_t result = vnil;
+  value_t proc   = vnil;
+  value_t params = vnil;
+  value_t callee = vnil;
+  value_t r_env  = vnil;
+  int     index  = 0;
+  int     fp     = base; // the frame's first slot, base at the top level
+  int     slots  = 0;    // how many of its slots are on the stack
+
+  // the registers; everything else is on the stack
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &node);
+  gc_root(ctxt, &env);
+  gc_root(ctxt, &result);
+  gc_root(ctxt, &proc);
+  gc_root(ctxt, &params);
+  gc_root(ctxt, &callee);
+  gc_root(ctxt, &r_env);
 
-    // (quote ...)
-    if (equality_exact(ctxt, symquote, car)) {
-      return cons_cadr(ctxt, v);
+ exec:
+  switch (node_kind(ctxt, node)) {
+  case N_CONST:
+    result = node_field(ctxt, node, 0);
+    goto ret;
+
+  case N_LOCAL:
+    result = frame_up(ctxt, env, as_integer(ctxt, node_field(ctxt, node, 0)));
+    result = vector_data(ctxt, result)[as_integer(ctxt, node_field(ctxt, node, 1))];
+    goto ret;
+
+  case N_SLOT:
+    result = stack->values[fp + as_integer(ctxt, node_field(ctxt, node, 0))];
+    goto ret;
+
+  case N_GLOBAL:
+    result = ctxt->globals.values[as_integer(ctxt, node_field(ctxt, node, 0))];
+    goto ret;
+
+  case N_IF:
+    if (!eval_reserve(ctxt, 2)) {
+      goto overflow;
     }
+    eval_push(stack, node);
+    eval_push(stack, make_integer(ctxt, K_IF));
 
-    // (if ...)
-    if (equality_exact(ctxt, symif, car)) {
-      value_t test = eval(ctxt, cons_cadr(ctxt, v), env);
+    node = node_field(ctxt, node, 0);
+    goto exec;
 
-      v = is_truthy(ctxt, test)
-        ? cons_caddr(ctxt, v)
-        : cons_cadddr(ctxt, v);
-      goto tailcall;
+  case N_DEFINE:
+    if (!eval_reserve(ctxt, 2)) {
+      goto overflow;
     }
+    eval_push(stack, node);
+    eval_push(stack, make_integer(ctxt, K_DEFINE));
 
-    // (define ...)
-    if (equality_exact(ctxt, symdefine, car)) {
-      value_t val = eval(ctxt, cons_caddr(ctxt, v), env);
-      *env = environment_set(ctxt, *env, cons_cadr(ctxt, v), val);
+    node = node_field(ctxt, node, 1);
+    goto exec;
 
-      // include the function in it's own captured env
-      // (body . (args . env))
-      if (is_compound_proc(ctxt, val)) {
-        cons_set_cdr(ctxt, cons_cdr(ctxt, val), *env);
-      }
+  case N_BIND:
+  case N_BIND_SLOT:
+    if (!eval_reserve(ctxt, 2)) {
+      goto overflow;
+    }
+    eval_push(stack, node);
+    eval_push(stack, make_integer(ctxt, K_BIND));
+
+    node = node_field(ctxt, node, 1);
+    goto exec;
+
+  case N_SEQ:
+    index = 0;
+    goto sequence;
+
+  case N_LAMBDA:
+    result = make_compound_proc(ctxt, node, node_field(ctxt, node, 2), env);
+    goto ret;
+
+  case N_CALL:
+    index = 0;
+    goto arguments;
+  }
+
+  fprintf(stderr, "bad node\n");
+  exit(1);
+
+  // the last node of a body is in tail position
+ sequence:
+  if (index == node_fields(ctxt, node) - 1) {
+    node = node_field(ctxt, node, index);
+    goto exec;
+  }
+
+  if (!eval_reserve(ctxt, 3)) {
+    goto overflow;
+  }
+  eval_push(stack, node);
+  eval_push(stack, make_integer(ctxt, index + 1));
+  eval_push(stack, make_integer(ctxt, K_SEQ));
+
+  node = node_field(ctxt, node, index);
+  goto exec;
 
-      return vnil;
+  // the operator and args are evaluated onto the stack, index so far
+ arguments:
+  if (index < node_fields(ctxt, node)) {
+    if (!eval_reserve(ctxt, 3)) {
+      goto overflow;
     }
+    eval_push(stack, node);
+    eval_push(stack, make_integer(ctxt, index));
+    eval_push(stack, make_integer(ctxt, K_ARGS));
 
-    // (begin ...)
-    if (equality_exact(ctxt, symbegin, car)) {
-      value_t cursor = cons_cdr(ctxt, v);
-      value_t car, cdr;
-      
-      while (1) {
-        car = cons_car(ctxt, cursor);
-        cdr = cons_cdr(ctxt, cursor);
+    node = node_field(ctxt, node, index);
+    goto exec;
+  }
 
-        if (is_nil(ctxt, cdr)) {
-          v = car;
-          goto tailcall;
-        }
+  int count = index - 1;
+  proc = stack->values[stack->size - index];
 
-        eval(ctxt, car, env);
-        cursor = cdr;
-      }
+  if (is_compound_proc(ctxt, proc)) {
+    params = compound_proc_args(ctxt, proc);
+    int n      = as_integer(ctxt, node_field(ctxt, params, 0));
+    int nslots = as_integer(ctxt, node_field(ctxt, params, 1));
+
+    // the same error a native gives for the wrong number of args
+    if (count != n) {
+      eval_drop(ctxt, index);
+      result = make_error(ctxt, __LINE__);
+      goto ret;
     }
 
-    // (lambda (vars) body...)
-    if (equality_exact(ctxt, symlambda, car)) {
-      value_t args, body;
+    // back to this frame afterwards, or, with nothing over this frame's
+    // K_RESTORE, to wherever it was going back to
+    r_env = env;
+    int r_fp    = fp;
+    int r_slots = slots;
+    if (fp > base && stack->size - index == fp + slots + RESTORE_SIZE) {
+      value_t *record = stack->values + fp + slots;
+      r_env   = record[0];
+      r_fp    = as_integer(ctxt, record[1]);
+      r_slots = as_integer(ctxt, record[2]);
 
-      args = cons_cadr(ctxt, v);
-      body = make_cons(ctxt, symbegin, cons_cddr(ctxt, v));
-      return make_compound_proc(ctxt, args, body, *env);
+      // the proc and args go where this frame's proc was
+      int from = stack->size - index;
+      for (int i = 0; i < index; i++) {
+        stack->values[fp - 1 + i] = stack->values[from + i];
+      }
+      stack->size = fp - 1 + index;
+      if (fp - 1 < ctxt->eval_stack_clean) {
+        ctxt->eval_stack_clean = fp - 1;
+      }
     }
 
-    // otherwise eval the car and invoke it
-    car = eval(ctxt, car, env);
-    if (is_compound_proc(ctxt, car)) {
-      value_t args   = cons_cdr(ctxt, v);
-      value_t params = compound_proc_args(ctxt, car);
-      value_t body   = compound_proc_body(ctxt, car);
-      value_t capenv = compound_proc_env(ctxt, car);
+    if (!eval_reserve(ctxt, nslots + RESTORE_SIZE)) {
+      goto overflow;
+    }
 
-      // bind all the args in a new environment
-      while (!is_nil(ctxt, params) && !is_nil(ctxt, args)) {
-        value_t arg = eval(ctxt, cons_car(ctxt, args), env);
-        capenv = environment_set(ctxt, capenv, cons_car(ctxt, params), arg);
+    fp = stack->size - count;
 
-        params = cons_cdr(ctxt, params);
-        args   = cons_cdr(ctxt, args);
+    if (is_truthy(ctxt, node_field(ctxt, params, 3))) {
+      // a new frame, under the env the proc captured, with the args in it
+      callee = make_vector(ctxt, nslots + 1, vnil);
+      vector_set(ctxt, callee, 0, compound_proc_env(ctxt, proc));
+      for (int i = 0; i < count; i++) {
+        vector_set(ctxt, callee, i + 1, stack->values[fp + i]);
       }
+      eval_drop(ctxt, count);
 
-      // eval the body in the new environment
-      // todo: tailcall?
-      return eval(ctxt, body, &capenv);
+      env   = callee;
+      slots = 0;
     }
+    else {
+      for (int i = count; i < nslots; i++) {
+        eval_push(stack, vnil);
+      }
 
-    if (is_native_proc(ctxt, car)) {
-      native_proc_fn fn = native_proc_function(ctxt, car);
-      return (*fn)(ctxt, cons_cdr(ctxt, v), *env);
+      env   = compound_proc_env(ctxt, proc);
+      slots = nslots;
     }
 
-    printf("not a function!\n");
-    return vnil;
+    eval_push(stack, r_env);
+    eval_push(stack, make_integer(ctxt, r_fp));
+    eval_push(stack, make_integer(ctxt, r_slots));
+    eval_push(stack, make_integer(ctxt, K_RESTORE));
+
+    node = compound_proc_body(ctxt, proc);
+    goto exec;
   }
 
+  // a native gets its args where they are, on the stack; arithmetic on
+  // two fixnums or doubles doesn't need the call at all
+  if (is_native_proc(ctxt, proc)) {
+    if (count == 2 &&
+        prim_numbers(ctxt, native_proc_prim(ctxt, proc),
+                     stack->values[stack->size - 2], stack->values[stack->size - 1], &result)) {
+      eval_drop(ctxt, index);
+      goto ret;
+    }
+
+    if (!native_proc_accepts(ctxt, proc, count)) {
+      eval_drop(ctxt, index);
+      result = make_error(ctxt, __LINE__);
+      goto ret;
+    }
+
+    native_proc_fn fn = native_proc_function(ctxt, proc);
+    result = (*fn)(ctxt, count, stack->values + stack->size - count);
+    eval_drop(ctxt, index);
+    goto ret;
+  }
+
+  printf("not a function!\n");
+  eval_drop(ctxt, index);
+  result = vnil;
+  goto ret;
+
+  // result has a value, hand it to whatever's waiting on it
+ ret:
+  if (stack->size == base) {
+    goto done;
+  }
+
+  switch ((continuation_t)as_integer(ctxt, eval_pop(ctxt))) {
+  case K_IF:
+    node = eval_pop(ctxt);
+    node = is_truthy(ctxt, result)
+      ? node_field(ctxt, node, 1)
+      : node_field(ctxt, node, 2);
+    goto exec;
+
+  case K_SEQ:
+    index = as_integer(ctxt, eval_pop(ctxt));
+    node  = eval_pop(ctxt);
+    goto sequence;
+
+  case K_DEFINE:
+    node = eval_pop(ctxt);
+    global_set(ctxt, as_integer(ctxt, node_field(ctxt, node, 0)), result);
+
+    result = vnil;
+    goto ret;
+
+  case K_BIND:
+    node = eval_pop(ctxt);
+    if (node_kind(ctxt, node) == N_BIND_SLOT) {
+      eval_store(ctxt, fp + as_integer(ctxt, node_field(ctxt, node, 0)), result);
+    }
+    else {
+      vector_set(ctxt, env, as_integer(ctxt, node_field(ctxt, node, 0)), result);
+    }
+
+    result = vnil;
+    goto ret;
+
+  case K_ARGS:
+    index = as_integer(ctxt, eval_pop(ctxt));
+    node  = eval_pop(ctxt);
+    eval_push(stack, result);
+
+    index++;
+    goto arguments;
+
+  case K_RESTORE:
+    slots = as_integer(ctxt, eval_pop(ctxt));
+    index = as_integer(ctxt, eval_pop(ctxt));
+    env   = eval_pop(ctxt);
+
+    // the frame goes, the proc under it too
+    eval_drop(ctxt, stack->size - (fp - 1));
+    fp = index;
+    goto ret;
+  }
+
+  fprintf(stderr, "bad continuation on the eval stack\n");
+  exit(1);
+
+ overflow:
+  eval_drop(ctxt, stack->size - base);
+  gc_unroot(ctxt, frame);
+  return make_error(ctxt, __LINE__);
+
+ done:
+  *inoutenv = env;
+  gc_unroot(ctxt, frame);
+  return result;
+}
+
+value_t eval(context_p ctxt, value_t v, value_t* inoutenv) {
+  return execute(ctxt, analyze(ctxt, v), inoutenv);
 }
@@ -0,0 +1,662 @@
+#define _DEFAULT_SOURCE
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "scheme.h"
+
+/*
+  a template jit for the vm, on x86-64 linux; anywhere else
+  jit_compile just says no, and the vm interprets everything.
+
+  once a template's been entered ctxt->jit_threshold times, the vm asks
+  for it to be compiled. each instruction becomes a fixed sequence of
+  machine code, with its operand patched in, and the vm's registers
+  live in machine registers while it runs
+
+    rbx  the eval stack's next free slot
+    r12  the frame's first slot
+    r13  the template's consts
+    r14  the jit_state_t
+    r15  the globals
+
+  constants, locals, globals, pops, branches and prims on two fixnums
+  run inline. the rest of what stays inside a frame calls out to c.
+  calls, tail calls, returns, and prims the fast path can't do leave
+  the code with the instruction's pc, and the vm runs it; it comes back
+  in at whichever instruction it resumes at, so every instruction's
+  code is an entry point.
+
+  the code goes into mmap'd chunks, writable only while it's copied in.
+  it lives as long as its template: when a major collection finishes
+  marking, jit_sweep lets go of the code of every template it didn't
+  reach. a chunk with nothing left in it is unmapped, or, if it's the
+  one code's going into, started over.
+*/
+
+#if defined(__x86_64__) && defined(__linux__)
+
+#include <sys/mman.h>
+
+#define JIT_CHUNK_SIZE (1 << 16)
+#define JIT_PAGE_SIZE  (1 << 12)
+
+typedef void (*jit_entry_fn)(jit_state_t *state, void *code);
+
+typedef struct jit_code {
+  value_t   tmpl;    // not a root, nil once it's gone
+  uint8_t  *base;
+  uint32_t *offsets; // where each instruction's code starts
+} jit_code_t;
+
+typedef struct jit_chunk {
+  uint8_t *bytes;
+  size_t   size;
+  size_t   used;
+  int      live;     // how many pieces of code are in it
+} jit_chunk_t;
+
+typedef struct jit {
+  int          chunk_count; // the last one's where code goes
+  int          chunk_limit;
+  jit_chunk_t *chunks;
+  jit_entry_fn entry;
+  int          count;
+  int          limit;
+  jit_code_t  *codes;
+} jit_t;
+
+/* code buffers */
+
+typedef struct fixup {
+  int      at;     // a rel32 to patch
+  uint32_t target; // the instruction it jumps to
+} fixup_t;
+
+typedef struct emitter {
+  uint8_t *bytes;
+  int      size;
+  int      limit;
+  fixup_t *fixups;
+  int      fixup_count;
+  int      fixup_limit;
+} emitter_t;
+
+static void *grow(void *ptr, int *limit, int need, size_t width) {
+  if (need <= *limit) {
+    return ptr;
+  }
+
+  while (*limit < need) {
+    *limit = *limit ? *limit * 2 : 256;
+  }
+  ptr = realloc(ptr, *limit * width);
+  if (ptr == NULL) {
+    fprintf(stderr, "out of memory!\n");
+    exit(1);
+  }
+  return ptr;
+}
+
+static void emit_bytes(emitter_t *e, const uint8_t *bytes, int len) {
+  e->bytes = grow(e->bytes, &e->limit, e->size + len, 1);
+  memcpy(e->bytes + e->size, bytes, len);
+  e->size += len;
+}
+
+#define EMIT(e, ...) do {                                   \
+    static const uint8_t bytes_[] = { __VA_ARGS__ };        \
+    emit_bytes(e, bytes_, sizeof(bytes_));                  \
+  } while (0)
+
+static void emit_u32(emitter_t *e, uint32_t v) {
+  emit_bytes(e, (uint8_t*)&v, sizeof(v));
+}
+
+static void emit_u64(emitter_t *e, uint64_t v) {
+  emit_bytes(e, (uint8_t*)&v, sizeof(v));
+}
+
+// a rel32 to the code for instruction target, patched once it's known
+static void emit_target(emitter_t *e, uint32_t target) {
+  e->fixups = grow(e->fixups, &e->fixup_limit, e->fixup_count + 1, sizeof(fixup_t));
+  e->fixups[e->fixup_count++] = (fixup_t){ e->size, target };
+  emit_u32(e, 0);
+}
+
+// a forward jump within an instruction's code, see patch_here
+static int emit_skip(emitter_t *e) {
+  emit_u32(e, 0);
+  return e->size - 4;
+}
+
+static void patch_here(emitter_t *e, int at) {
+  int32_t rel = e->size - (at + 4);
+  memcpy(e->bytes + at, &rel, sizeof(rel));
+}
+
+/* templates */
+
+#define STATE(field) ((uint8_t)offsetof(jit_state_t, field))
+
+// mov rdx, imm64
+static void emit_rdx(emitter_t *e, uint64_t imm) {
+  EMIT(e, 0x48, 0xBA);
+  emit_u64(e, imm);
+}
+
+// push rax on the eval stack
+static void emit_push_rax(emitter_t *e) {
+  EMIT(e, 0x48, 0x89, 0x03);              // mov [rbx], rax
+  EMIT(e, 0x48, 0x83, 0xC3, 0x08);        // add rbx, 8
+}
+
+// leave, for the vm to carry on at pc; the epilogue's after the last
+// instruction, so it's the target one past the end
+static void emit_exit(emitter_t *e, uint32_t pc, uint32_t epilogue) {
+  EMIT(e, 0x41, 0xC7, 0x46, STATE(pc));   // mov dword [r14 + pc], imm32
+  emit_u32(e, pc);
+  EMIT(e, 0xE9);                          // jmp epilogue
+  emit_target(e, epilogue);
+}
+
+// helper(state, arg), with the stack top synced both ways
+static void emit_helper(emitter_t *e, void (*helper)(jit_state_t*, uint32_t), uint32_t arg) {
+  EMIT(e, 0x49, 0x89, 0x5E, STATE(sp));   // mov [r14 + sp], rbx
+  EMIT(e, 0x4C, 0x89, 0xF7);              // mov rdi, r14
+  EMIT(e, 0xBE);                          // mov esi, imm32
+  emit_u32(e, arg);
+  EMIT(e, 0x48, 0xB8);                    // mov rax, imm64
+  emit_u64(e, (uint64_t)(uintptr_t)helper);
+  EMIT(e, 0xFF, 0xD0);                    // call rax
+  EMIT(e, 0x49, 0x8B, 0x5E, STATE(sp));   // mov rbx, [r14 + sp]
+}
+
+/* helpers, for what needs the heap */
+
+// anything that might collect needs the stack's size right, and the
+// frame looked at again
+static void sync_stack(jit_state_t *state) {
+  context_p ctxt = state->ctxt;
+  int fp = state->fp - ctxt->eval_stack.values;
+
+  ctxt->eval_stack.size = state->sp - ctxt->eval_stack.values;
+  if (fp - 1 < ctxt->eval_stack_clean) {
+    ctxt->eval_stack_clean = fp - 1;
+  }
+}
+
+static void jit_frame(jit_state_t *state, uint32_t arg) {
+  context_p ctxt = state->ctxt;
+
+  value_t frame = *state->env;
+  for (int depth = arg & 0xFFFF; depth > 0; depth--) {
+    frame = vector_data(ctxt, frame)[0];
+  }
+  *state->sp++ = vector_data(ctxt, frame)[arg >> 16];
+}
+
+static void jit_setlocal(jit_state_t *state, uint32_t arg) {
+  sync_stack(state);
+  state->fp[arg]    = state->sp[-1];
+  state->sp[-1]     = vnil;
+}
+
+static void jit_setframe(jit_state_t *state, uint32_t arg) {
+  vector_set(state->ctxt, *state->env, arg, state->sp[-1]);
+  state->sp[-1] = vnil;
+}
+
+static void jit_defglobal(jit_state_t *state, uint32_t arg) {
+  global_set(state->ctxt, arg, state->sp[-1]);
+  state->sp[-1] = vnil;
+}
+
+static void jit_closure(jit_state_t *state, uint32_t arg) {
+  sync_stack(state);
+  value_t proc = make_compound_proc(state->ctxt, state->consts[arg], vnil, *state->env);
+  *state->sp++ = proc;
+}
+
+/* the compiler */
+
+// the native a prim's fast path is guarded on, or nil for none
+static value_t prim_native(context_p ctxt, prim_t prim) {
+  for (int i = 0; i < ctxt->native_proc_count; i++) {
+    if (ctxt->native_procs[i].prim == prim) {
+      return native_proc_at(ctxt, i);
+    }
+  }
+  return vnil;
+}
+
+/*
+  two fixnums under the prim's native, or out to the vm:
+
+    mov rcx, [rbx-24]; cmp rcx, native; jne slow
+    mov rax, [rbx-16]; mov rdx, [rbx-8]
+    both tagged as integers, or slow
+    sign extend their 48 bits, the op on rax, rdx
+    slow unless the answer fits back in 48 bits
+    box it, into the operator's slot; sub rbx, 16
+*/
+static void emit_prim(context_p ctxt, emitter_t *e, uint32_t pc, uint32_t arg, uint32_t epilogue) {
+  prim_t   prim    = (prim_t)(arg & 0xFF);
+  bool     tail    = arg >> 8;
+  value_t  native  = prim_native(ctxt, prim);
+  uint64_t tag     = make_integer(ctxt, 0).as_uint64;
+  int      slow[5] = { 0 };
+  int      slows   = 0;
+
+  if (is_nil(ctxt, native)) {
+    emit_exit(e, pc, epilogue);
+    return;
+  }
+
+  EMIT(e, 0x48, 0x8B, 0x4B, 0xE8);        // mov rcx, [rbx-24]
+  emit_rdx(e, native.as_uint64);
+  EMIT(e, 0x48, 0x39, 0xD1);              // cmp rcx, rdx
+  EMIT(e, 0x0F, 0x85);                    // jne slow
+  slow[slows++] = emit_skip(e);
+
+  EMIT(e, 0x48, 0x8B, 0x43, 0xF0);        // mov rax, [rbx-16]
+  EMIT(e, 0x48, 0x8B, 0x53, 0xF8);        // mov rdx, [rbx-8]
+
+  EMIT(e, 0x48, 0x89, 0xC1);              // mov rcx, rax
+  EMIT(e, 0x48, 0xC1, 0xE9, 0x30);        // shr rcx, 48
+  EMIT(e, 0x81, 0xF9);                    // cmp ecx, tag
+  emit_u32(e, (uint32_t)(tag >> 48));
+  EMIT(e, 0x0F, 0x85);                    // jne slow
+  slow[slows++] = emit_skip(e);
+
+  EMIT(e, 0x48, 0x89, 0xD1);              // mov rcx, rdx
+  EMIT(e, 0x48, 0xC1, 0xE9, 0x30);        // shr rcx, 48
+  EMIT(e, 0x81, 0xF9);                    // cmp ecx, tag
+  emit_u32(e, (uint32_t)(tag >> 48));
+  EMIT(e, 0x0F, 0x85);                    // jne slow
+  slow[slows++] = emit_skip(e);
+
+  EMIT(e, 0x48, 0xC1, 0xE0, 0x10);        // shl rax, 16
+  EMIT(e, 0x48, 0xC1, 0xF8, 0x10);        // sar rax, 16
+  EMIT(e, 0x48, 0xC1, 0xE2, 0x10);        // shl rdx, 16
+  EMIT(e, 0x48, 0xC1, 0xFA, 0x10);        // sar rdx, 16
+
+  switch (prim) {
+  case PRIM_ADD:
+  case PRIM_SUB:
+  case PRIM_MUL:
+    // only a product can overflow 64 bits
+    if (prim == PRIM_ADD) {
+      EMIT(e, 0x48, 0x01, 0xD0);          // add rax, rdx
+    }
+    else if (prim == PRIM_SUB) {
+      EMIT(e, 0x48, 0x29, 0xD0);          // sub rax, rdx
+    }
+    else {
+      EMIT(e, 0x48, 0x0F, 0xAF, 0xC2);    // imul rax, rdx
+      EMIT(e, 0x0F, 0x80);                // jo slow
+      slow[slows++] = emit_skip(e);
+    }
+
+    EMIT(e, 0x48, 0x89, 0xC1);            // mov rcx, rax
+    EMIT(e, 0x48, 0xC1, 0xE1, 0x10);      // shl rcx, 16
+    EMIT(e, 0x48, 0xC1, 0xF9, 0x10);      // sar rcx, 16
+    EMIT(e, 0x48, 0x39, 0xC1);            // cmp rcx, rax
+    EMIT(e, 0x0F, 0x85);                  // jne slow
+    slow[slows++] = emit_skip(e);
+
+    EMIT(e, 0x48, 0xC1, 0xE0, 0x10);      // shl rax, 16
+    EMIT(e, 0x48, 0xC1, 0xE8, 0x10);      // shr rax, 16
+    emit_rdx(e, tag);
+    break;
+
+  default:
+    EMIT(e, 0x48, 0x39, 0xD0);            // cmp rax, rdx
+    switch (prim) {
+    case PRIM_EQ:  EMIT(e, 0x0F, 0x94, 0xC1); break; // sete cl
+    case PRIM_LT:  EMIT(e, 0x0F, 0x9C, 0xC1); break; // setl cl
+    case PRIM_GT:  EMIT(e, 0x0F, 0x9F, 0xC1); break; // setg cl
+    case PRIM_LTE: EMIT(e, 0x0F, 0x9E, 0xC1); break; // setle cl
+    default:       EMIT(e, 0x0F, 0x9D, 0xC1); break; // setge cl
+    }
+    EMIT(e, 0x0F, 0xB6, 0xC1);            // movzx eax, cl
+    emit_rdx(e, vfalse.as_uint64);        // vtrue is vfalse | 1
+    break;
+  }
+
+  EMIT(e, 0x48, 0x09, 0xD0);              // or rax, rdx
+  EMIT(e, 0x48, 0x89, 0x43, 0xE8);        // mov [rbx-24], rax
+  EMIT(e, 0x48, 0x83, 0xEB, 0x10);        // sub rbx, 16
+
+  // in tail position, the answer's returned
+  int done;
+  if (tail) {
+    EMIT(e, 0x41, 0xC7, 0x46, STATE(pc)); // mov dword [r14 + pc], JIT_RETURN
+    emit_u32(e, JIT_RETURN);
+    EMIT(e, 0xE9);                        // jmp epilogue
+    emit_target(e, epilogue);
+    done = -1;
+  }
+  else {
+    EMIT(e, 0xE9);                        // jmp done
+    done = emit_skip(e);
+  }
+
+  for (int i = 0; i < slows; i++) {
+    patch_here(e, slow[i]);
+  }
+  emit_exit(e, pc, epilogue);
+
+  if (done >= 0) {
+    patch_here(e, done);
+  }
+}
+
+static void emit_instruction(context_p ctxt, emitter_t *e, uint32_t pc, uint64_t word, uint32_t epilogue) {
+  uint32_t arg = word >> 8;
+
+  switch ((opcode_t)(word & 0xFF)) {
+  case OP_CONST:
+    EMIT(e, 0x49, 0x8B, 0x85);            // mov rax, [r13 + k*8]
+    emit_u32(e, arg * 8);
+    emit_push_rax(e);
+    return;
+
+  case OP_LOCAL:
+    EMIT(e, 0x49, 0x8B, 0x84, 0x24);      // mov rax, [r12 + i*8]
+    emit_u32(e, arg * 8);
+    emit_push_rax(e);
+    return;
+
+  case OP_GLOBAL:
+    EMIT(e, 0x49, 0x8B, 0x87);            // mov rax, [r15 + g*8]
+    emit_u32(e, arg * 8);
+    emit_push_rax(e);
+    return;
+
+  case OP_POP:
+    EMIT(e, 0x48, 0x83, 0xEB, 0x08);      // sub rbx, 8
+    return;
+
+  case OP_JUMP:
+    EMIT(e, 0xE9);                        // jmp target
+    emit_target(e, arg);
+    return;
+
+  case OP_JUMPF:
+    EMIT(e, 0x48, 0x83, 0xEB, 0x08);      // sub rbx, 8
+    EMIT(e, 0x48, 0x8B, 0x03);            // mov rax, [rbx]
+    emit_rdx(e, vfalse.as_uint64);
+    EMIT(e, 0x48, 0x39, 0xD0);            // cmp rax, rdx
+    EMIT(e, 0x0F, 0x84);                  // je target
+    emit_target(e, arg);
+    return;
+
+  case OP_FRAME:
+    emit_helper(e, &jit_frame, arg);
+    return;
+
+  case OP_SETLOCAL:
+    emit_helper(e, &jit_setlocal, arg);
+    return;
+
+  case OP_SETFRAME:
+    emit_helper(e, &jit_setframe, arg);
+    return;
+
+  case OP_DEFGLOBAL:
+    emit_helper(e, &jit_defglobal, arg);
+    return;
+
+  case OP_CLOSURE:
+    emit_helper(e, &jit_closure, arg);
+    return;
+
+  case OP_PRIM:
+    emit_prim(ctxt, e, pc, arg, epilogue);
+    return;
+
+  case OP_CALL:
+  case OP_TAILCALL:
+  case OP_RETURN:
+  case OP_COUNT:
+    break;
+  }
+
+  emit_exit(e, pc, epilogue);
+}
+
+/* code memory */
+
+// len bytes copied in to executable memory
+static uint8_t *jit_install(jit_t *jit, uint8_t *bytes, size_t len) {
+  len = (len + 15) & ~(size_t)15;
+
+  jit_chunk_t *chunk = jit->chunk_count ? &jit->chunks[jit->chunk_count - 1] : NULL;
+  if (chunk == NULL || chunk->used + len > chunk->size) {
+    size_t size = len > JIT_CHUNK_SIZE
+      ? (len + JIT_PAGE_SIZE - 1) & ~(size_t)(JIT_PAGE_SIZE - 1)
+      : JIT_CHUNK_SIZE;
+
+    void *mem = mmap(NULL, size, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+      return NULL;
+    }
+
+    // the rest of the old chunk's wasted until what's in it dies; code
+    // never moves
+    jit->chunks = grow(jit->chunks, &jit->chunk_limit, jit->chunk_count + 1, sizeof(jit_chunk_t));
+    chunk = &jit->chunks[jit->chunk_count++];
+    *chunk = (jit_chunk_t){ mem, size, 0, 0 };
+  }
+
+  if (mprotect(chunk->bytes, chunk->size, PROT_READ | PROT_WRITE) != 0) {
+    return NULL;
+  }
+
+  uint8_t *code = chunk->bytes + chunk->used;
+  memcpy(code, bytes, len);
+  chunk->used += len;
+  chunk->live++;
+
+  if (mprotect(chunk->bytes, chunk->size, PROT_READ | PROT_EXEC) != 0) {
+    return NULL;
+  }
+
+  return code;
+}
+
+// the code at base is done with; its chunk goes with the last of it
+static void jit_uninstall(jit_t *jit, uint8_t *base) {
+  int id = 0;
+  while (base < jit->chunks[id].bytes || base >= jit->chunks[id].bytes + jit->chunks[id].size) {
+    id++;
+  }
+
+  jit_chunk_t *chunk = &jit->chunks[id];
+  if (--chunk->live > 0) {
+    return;
+  }
+
+  if (id == jit->chunk_count - 1) {
+    chunk->used = 0;
+    return;
+  }
+
+  munmap(chunk->bytes, chunk->size);
+  memmove(chunk, chunk + 1, (jit->chunk_count - id - 1) * sizeof(jit_chunk_t));
+  jit->chunk_count--;
+}
+
+/*
+  the way in, shared by everything: save the callee saved registers,
+  load the vm's, and jump to the instruction. the way out is a copy of
+  the other half at the end of each template's code.
+*/
+static jit_t *jit_init(context_p ctxt) {
+  jit_t *jit = calloc(1, sizeof(jit_t));
+  if (jit == NULL) {
+    fprintf(stderr, "out of memory!\n");
+    exit(1);
+  }
+
+  emitter_t e = { 0 };
+  EMIT(&e, 0x53);                         // push rbx
+  EMIT(&e, 0x41, 0x54);                   // push r12
+  EMIT(&e, 0x41, 0x55);                   // push r13
+  EMIT(&e, 0x41, 0x56);                   // push r14
+  EMIT(&e, 0x41, 0x57);                   // push r15
+  EMIT(&e, 0x49, 0x89, 0xFE);             // mov r14, rdi
+  EMIT(&e, 0x49, 0x8B, 0x5E, STATE(sp));  // mov rbx, [r14 + sp]
+  EMIT(&e, 0x4D, 0x8B, 0x66, STATE(fp));  // mov r12, [r14 + fp]
+  EMIT(&e, 0x4D, 0x8B, 0x6E, STATE(consts)); // mov r13, [r14 + consts]
+  EMIT(&e, 0x4D, 0x8B, 0x7E, STATE(globals)); // mov r15, [r14 + globals]
+  EMIT(&e, 0xFF, 0xE6);                   // jmp rsi
+
+  uint8_t *entry = jit_install(jit, e.bytes, e.size);
+  free(e.bytes);
+  if (entry == NULL) {
+    free(jit);
+    return NULL;
+  }
+
+  jit->entry = (jit_entry_fn)entry;
+  ctxt->jit  = jit;
+  return jit;
+}
+
+bool jit_compile(context_p ctxt, value_t tmpl) {
+  jit_t *jit = ctxt->jit ? ctxt->jit : jit_init(ctxt);
+  if (jit == NULL) {
+    return false;
+  }
+
+  value_t  vector = vector_data(ctxt, tmpl)[T_CODE];
+  value_t *code   = vector_data(ctxt, vector);
+  uint32_t count  = vector_size(ctxt, vector);
+
+  // a slot past the reach of a disp32 stays interpreted
+  for (uint32_t pc = 0; pc < count; pc++) {
+    uint64_t word = as_integer(ctxt, code[pc]);
+    switch ((opcode_t)(word & 0xFF)) {
+    case OP_CONST:
+    case OP_LOCAL:
+    case OP_GLOBAL:
+      if ((word >> 8) > INT32_MAX / 8) {
+        return false;
+      }
+      break;
+    default:
+      break;
+    }
+  }
+
+  uint32_t *offsets = malloc((count + 1) * sizeof(uint32_t));
+  if (offsets == NULL) {
+    fprintf(stderr, "out of memory!\n");
+    exit(1);
+  }
+
+  emitter_t e = { 0 };
+  for (uint32_t pc = 0; pc < count; pc++) {
+    offsets[pc] = e.size;
+    emit_instruction(ctxt, &e, pc, as_integer(ctxt, code[pc]), count);
+  }
+
+  offsets[count] = e.size;
+  EMIT(&e, 0x49, 0x89, 0x5E, STATE(sp));  // mov [r14 + sp], rbx
+  EMIT(&e, 0x41, 0x5F);                   // pop r15
+  EMIT(&e, 0x41, 0x5E);                   // pop r14
+  EMIT(&e, 0x41, 0x5D);                   // pop r13
+  EMIT(&e, 0x41, 0x5C);                   // pop r12
+  EMIT(&e, 0x5B);                         // pop rbx
+  EMIT(&e, 0xC3);                         // ret
+
+  for (int i = 0; i < e.fixup_count; i++) {
+    fixup_t fixup = e.fixups[i];
+    int32_t rel   = offsets[fixup.target] - (fixup.at + 4);
+    memcpy(e.bytes + fixup.at, &rel, sizeof(rel));
+  }
+
+  uint8_t *base = jit_install(jit, e.bytes, e.size);
+  free(e.bytes);
+  free(e.fixups);
+  if (base == NULL) {
+    free(offsets);
+    return false;
+  }
+
+  // an entry a dead template left, or a new one; compiling's rare
+  // enough to just look
+  int index = 0;
+  while (index < jit->count && !is_nil(ctxt, jit->codes[index].tmpl)) {
+    index++;
+  }
+  if (index == jit->count) {
+    jit->codes = grow(jit->codes, &jit->limit, jit->count + 1, sizeof(jit_code_t));
+    jit->count++;
+  }
+  jit->codes[index] = (jit_code_t){ tmpl, base, offsets };
+
+  vector_set(ctxt, tmpl, T_JIT, make_integer(ctxt, index + 1));
+  return true;
+}
+
+// at the end of a major collection's marking: the code of any template
+// it didn't reach goes
+void jit_sweep(context_p ctxt) {
+  jit_t *jit = ctxt->jit;
+  if (jit == NULL) {
+    return;
+  }
+
+  for (int i = 0; i < jit->count; i++) {
+    jit_code_t *code = &jit->codes[i];
+    if (is_nil(ctxt, code->tmpl) || vector_marked(ctxt, code->tmpl)) {
+      continue;
+    }
+
+    jit_uninstall(jit, code->base);
+    free(code->offsets);
+    *code = (jit_code_t){ vnil, NULL, NULL };
+  }
+}
+
+// runs tmpl's code from pc, until it wants the vm; false if there's no
+// code for it, say if it came from an image
+bool jit_enter(context_p ctxt, value_t tmpl, jit_state_t *state, uint32_t pc) {
+  jit_t *jit   = ctxt->jit;
+  int    index = as_integer(ctxt, vector_data(ctxt, tmpl)[T_JIT]) - 1;
+
+  if (jit == NULL || index < 0 || index >= jit->count ||
+      !equality_exact(ctxt, jit->codes[index].tmpl, tmpl)) {
+    vector_set(ctxt, tmpl, T_JIT, make_integer(ctxt, 0));
+    return false;
+  }
+
+  jit_code_t *code = &jit->codes[index];
+  jit->entry(state, code->base + code->offsets[pc]);
+  return true;
+}
+
+#else
+
+bool jit_compile(context_p ctxt, value_t tmpl) {
+  (void)ctxt;
+  (void)tmpl;
+  return false;
+}
+
+bool jit_enter(context_p ctxt, value_t tmpl, jit_state_t *state, uint32_t pc) {
+  (void)state;
+  (void)pc;
+  vector_set(ctxt, tmpl, T_JIT, make_integer(ctxt, 0));
+  return false;
+}
+
+void jit_sweep(context_p ctxt) {
+  (void)ctxt;
+}
+
+#endif
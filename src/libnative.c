@@ -1,15 +1,31 @@
+#include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include "scheme.h"
 
-static value_t install_op(context_p ctxt, value_t env, char *name, native_proc_fn fn) {
-  value_t sym = make_symbol(ctxt, name, strlen(name));
-  value_t ptr = make_native_proc(ctxt, fn);
-  
-  return environment_set(ctxt, env, sym, ptr);
+// calls outside min..max args are turned away before fn is called; each
+// name gets its own entry, even when it shares fn with another
+static value_t install_op(context_p ctxt, char *name, native_proc_fn fn, int min, int max) {
+  value_t proc = make_native_proc(ctxt, fn, min, max);
+  value_t sym  = make_symbol(ctxt, name, strlen(name));
+  global_define(ctxt, sym, proc);
+  return proc;
 }
 
-static value_t debugprint_proc(context_p ctxt, value_t args, value_t env) {
-  value_t v = eval(ctxt, cons_car(ctxt, args), &env);
+// one the optimizer may call ahead of time, on constant args
+static value_t install_pure(context_p ctxt, char *name, native_proc_fn fn, int min, int max) {
+  value_t proc = install_op(ctxt, name, fn, min, max);
+  native_proc_set_pure(ctxt, proc, true);
+  return proc;
+}
+
+// one the evaluators can open-code, see prim_numbers; they're all pure
+static void install_prim(context_p ctxt, char *name, native_proc_fn fn, int min, int max, prim_t prim) {
+  native_proc_set_prim(ctxt, install_pure(ctxt, name, fn, min, max), prim);
+}
+
+static value_t debugprint_proc(context_p ctxt, int, value_t *argv) {
+  value_t v = argv[0];
   printf("[%lx] => ", v.as_uint64);
   print(ctxt, v);
   printf("\n");
@@ -17,288 +33,926 @@ static value_t debugprint_proc(context_p ctxt, value_t args, value_t env) {
   return vnil;
 }
 
-static value_t nullp_proc(context_p ctxt, value_t args, value_t env) {
-  return is_nil(ctxt, eval(ctxt, cons_car(ctxt, args), &env)) ? vtrue : vfalse;
+static value_t nullp_proc(context_p ctxt, int, value_t *argv) {
+  return is_nil(ctxt, argv[0]) ? vtrue : vfalse;
 }
 
-static value_t eqp_proc(context_p ctxt, value_t args, value_t env) {
-  value_t a = eval(ctxt, cons_car(ctxt, args), &env);
-  value_t b = eval(ctxt, cons_cadr(ctxt, args), &env);
+static value_t eqp_proc(context_p ctxt, int, value_t *argv) {
+  return equality_exact(ctxt, argv[0], argv[1]) ? vtrue : vfalse;
+}
 
-  return equality_exact(ctxt, a, b) ? vtrue : vfalse;
+static value_t boolp_proc(context_p ctxt, int, value_t *argv) {
+  return is_boolean(ctxt, argv[0]) ? vtrue : vfalse;
 }
 
-static value_t boolp_proc(context_p ctxt, value_t args, value_t env) {
-  return is_boolean(ctxt, eval(ctxt, cons_car(ctxt, args), &env)) ? vtrue : vfalse;
+static value_t symbolp_proc(context_p ctxt, int, value_t *argv) {
+  return is_symbol(ctxt, argv[0]) ? vtrue : vfalse;
 }
 
-static value_t symbolp_proc(context_p ctxt, value_t args, value_t env) {
-  return is_symbol(ctxt, eval(ctxt, cons_car(ctxt, args), &env)) ? vtrue : vfalse;
+static value_t integerp_proc(context_p ctxt, int, value_t *argv) {
+  return is_exact(ctxt, argv[0]) ? vtrue : vfalse;
 }
 
-static value_t integerp_proc(context_p ctxt, value_t args, value_t env) {
-  return is_integer(ctxt, eval(ctxt, cons_car(ctxt, args), &env)) ? vtrue : vfalse;
+static value_t floatp_proc(context_p ctxt, int, value_t *argv) {
+  return is_float(ctxt, argv[0]) ? vtrue : vfalse;
 }
 
-static value_t floatp_proc(context_p ctxt, value_t args, value_t env) {
-  return is_float(ctxt, eval(ctxt, cons_car(ctxt, args), &env)) ? vtrue : vfalse;
+static value_t charp_proc(context_p ctxt, int, value_t *argv) {
+  return is_character(ctxt, argv[0]) ? vtrue : vfalse;
 }
 
-static value_t charp_proc(context_p ctxt, value_t args, value_t env) {
-  return is_character(ctxt, eval(ctxt, cons_car(ctxt, args), &env)) ? vtrue : vfalse;
+static value_t stringp_proc(context_p ctxt, int, value_t *argv) {
+  return is_string(ctxt, argv[0]) ? vtrue : vfalse;
 }
 
-static value_t stringp_proc(context_p ctxt, value_t args, value_t env) {
-  return is_string(ctxt, eval(ctxt, cons_car(ctxt, args), &env)) ? vtrue : vfalse;
+static value_t consp_proc(context_p ctxt, int, value_t *argv) {
+  return is_cons(ctxt, argv[0]) ? vtrue : vfalse;
 }
 
-static value_t consp_proc(context_p ctxt, value_t args, value_t env) {
-  return is_cons(ctxt, eval(ctxt, cons_car(ctxt, args), &env)) ? vtrue : vfalse;
+static value_t procp_proc(context_p ctxt, int, value_t *argv) {
+  return is_proc(ctxt, argv[0]) ? vtrue : vfalse;
 }
 
-static value_t procp_proc(context_p ctxt, value_t args, value_t env) {
-  return is_proc(ctxt, eval(ctxt, cons_car(ctxt, args), &env)) ? vtrue : vfalse;
+static value_t to_integer_proc(context_p ctxt, int, value_t *argv) {
+  return to_integer(ctxt, argv[0]);
 }
 
-static value_t to_integer_proc(context_p ctxt, value_t args, value_t env) {
-  return to_integer(ctxt, eval(ctxt, cons_car(ctxt, args), &env));
+static value_t to_character_proc(context_p ctxt, int, value_t *argv) {
+  return to_character(ctxt, argv[0]);
 }
 
-static value_t to_character_proc(context_p ctxt, value_t args, value_t env) {
-  return to_character(ctxt, eval(ctxt, cons_car(ctxt, args), &env));
+static value_t to_string_proc(context_p ctxt, int, value_t *argv) {
+  return to_string(ctxt, argv[0]);
 }
 
-static value_t to_string_proc(context_p ctxt, value_t args, value_t env) {
-  return to_string(ctxt, eval(ctxt, cons_car(ctxt, args), &env));
+/* strings */
+
+static value_t string_length_proc(context_p ctxt, int, value_t *argv) {
+  if (!is_string(ctxt, argv[0])) {
+    return make_error(ctxt, __LINE__);
+  }
+  return make_integer(ctxt, string_len(ctxt, argv[0]));
 }
 
-static value_t to_symbol_proc(context_p ctxt, value_t args, value_t env) {
-  return to_symbol(ctxt, eval(ctxt, cons_car(ctxt, args), &env));
+static value_t string_ref_proc(context_p ctxt, int, value_t *argv) {
+  value_t str   = argv[0];
+  value_t index = argv[1];
+
+  if (!is_string(ctxt, str) || !is_integer(ctxt, index) ||
+      as_integer(ctxt, index) < 0 || as_integer(ctxt, index) >= string_len(ctxt, str)) {
+    return make_error(ctxt, __LINE__);
+  }
+  return make_character(ctxt, string_ptr(ctxt, str)[as_integer(ctxt, index)]);
 }
 
-static value_t intadd_proc(context_p ctxt, value_t args, value_t env) {
-  value_t  cursor = args;
-  uint32_t sum    = 0;
-  value_t  car;
+// end defaults to the end of the string
+static value_t substring_proc(context_p ctxt, int argc, value_t *argv) {
+  if (!is_string(ctxt, argv[0]) || !is_integer(ctxt, argv[1]) ||
+      (argc > 2 && !is_integer(ctxt, argv[2]))) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  int64_t end = argc > 2 ? as_integer(ctxt, argv[2]) : string_len(ctxt, argv[0]);
+  return make_substring(ctxt, argv[0], as_integer(ctxt, argv[1]), end);
+}
 
-  while (!is_nil(ctxt, cursor)) {
-    car    = eval(ctxt, cons_car(ctxt, cursor), &env);
-    sum   += as_integer(ctxt, car);
-    cursor = cons_cdr(ctxt, cursor);
+// the pieces between each separator, empty ones included; built from the
+// back, and the bytes are looked up again after every cons
+static value_t string_split_proc(context_p ctxt, int, value_t *argv) {
+  value_t str = argv[0];
+  if (!is_string(ctxt, str) || !is_character(ctxt, argv[1])) {
+    return make_error(ctxt, __LINE__);
   }
 
-  return make_integer(ctxt, sum);
+  char sep = as_character(ctxt, argv[1]);
+  value_t list = vnil;
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &list);
+
+  int64_t end = string_len(ctxt, str);
+  for (int64_t i = end - 1; i >= -1; i--) {
+    if (i >= 0 && string_ptr(ctxt, str)[i] != sep) {
+      continue;
+    }
+
+    list = make_cons(ctxt, make_substring(ctxt, str, i + 1, end), list);
+    end  = i;
+  }
+
+  gc_unroot(ctxt, frame);
+  return list;
+}
+
+static value_t to_symbol_proc(context_p ctxt, int, value_t *argv) {
+  return to_symbol(ctxt, argv[0]);
 }
 
-static value_t intsub_proc(context_p ctxt, value_t args, value_t env) {
-  value_t  cursor = args;
-  uint32_t diff   = 0;
-  value_t  car    = eval(ctxt, cons_car(ctxt, cursor), &env);
+/* numbers */
 
-  // unary minus, negate
-  if (is_nil(ctxt, cons_cadr(ctxt, cursor))) {
-    return make_integer(ctxt, 0 - as_integer(ctxt, car));
+/*
+  exact integers stay exact, fixnums while the answer fits and bignums
+  past that, and doubles once a double's involved; anything else is an
+  error. there are no rationals, so a division that isn't exact answers
+  a double. fixnums and doubles don't get this far for the ops marked as
+  prims, unless the answer needs a bignum.
+*/
+
+static bool is_number(context_p ctxt, value_t v) {
+  return is_exact(ctxt, v) || is_double(ctxt, v) || is_float(ctxt, v);
+}
+
+static double number_double(context_p ctxt, value_t v) {
+  if (is_exact(ctxt, v)) {
+    return exact_double(ctxt, v);
+  }
+  if (is_float(ctxt, v)) {
+    return as_float(ctxt, v);
+  }
+  return as_double(ctxt, v);
+}
+
+// acc op argv[0] op argv[1]...
+static value_t arith_fold(context_p ctxt, prim_t op, value_t acc, int argc, value_t *argv) {
+  if (!is_number(ctxt, acc)) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  int i = 0;
+  for (; i < argc; i++) {
+    value_t next;
+    if (prim_numbers(ctxt, op, acc, argv[i], &next)) {
+      acc = next;
+      continue;
+    }
+
+    if (!is_exact(ctxt, acc) || !is_exact(ctxt, argv[i])) {
+      break;
+    }
+
+    switch (op) {
+    case PRIM_ADD: acc = exact_add(ctxt, acc, argv[i]); break;
+    case PRIM_SUB: acc = exact_sub(ctxt, acc, argv[i]); break;
+    default:       acc = exact_mul(ctxt, acc, argv[i]); break;
+    }
+
+    if (is_error(ctxt, acc)) {
+      return acc;
+    }
+  }
+
+  if (i == argc) {
+    return acc;
   }
 
-  diff   = as_integer(ctxt, car);
-  cursor = cons_cdr(ctxt, cursor);
-  while (!is_nil(ctxt, cursor)) {
-    car    = eval(ctxt, cons_car(ctxt, cursor), &env);
-    diff  -= as_integer(ctxt, car);
+  double total = number_double(ctxt, acc);
+  for (; i < argc; i++) {
+    if (!is_number(ctxt, argv[i])) {
+      return make_error(ctxt, __LINE__);
+    }
 
-    cursor = cons_cdr(ctxt, cursor);
+    double x = number_double(ctxt, argv[i]);
+    switch (op) {
+    case PRIM_ADD: total += x; break;
+    case PRIM_SUB: total -= x; break;
+    default:       total *= x; break;
+    }
   }
 
-  return make_integer(ctxt, diff);
+  return make_double(ctxt, total);
 }
 
-static value_t intmul_proc(context_p ctxt, value_t args, value_t env) {
-  value_t  cursor = args;
-  uint32_t total  = 1;
-  value_t  car;
+static value_t add_proc(context_p ctxt, int argc, value_t *argv) {
+  return arith_fold(ctxt, PRIM_ADD, make_integer(ctxt, 0), argc, argv);
+}
 
-  while (!is_nil(ctxt, cursor)) {
-    car    = eval(ctxt, cons_car(ctxt, cursor), &env);
-    total *= as_integer(ctxt, car);
-    cursor = cons_cdr(ctxt, cursor);
+static value_t sub_proc(context_p ctxt, int argc, value_t *argv) {
+  // unary minus, negate
+  if (argc == 1) {
+    return arith_fold(ctxt, PRIM_SUB, make_integer(ctxt, 0), argc, argv);
   }
 
-  return make_integer(ctxt, total);
+  return arith_fold(ctxt, PRIM_SUB, argv[0], argc - 1, argv + 1);
 }
 
-static value_t compgt_proc(context_p ctxt, value_t args, value_t env) {
-  value_t  cursor = args;
-  value_t  car, cadr;
+static value_t mul_proc(context_p ctxt, int argc, value_t *argv) {
+  return arith_fold(ctxt, PRIM_MUL, make_integer(ctxt, 1), argc, argv);
+}
 
-  car = eval(ctxt, cons_car(ctxt, cursor), &env);
-  while (!is_nil(ctxt, cursor)) {
-    cadr = eval(ctxt, cons_cadr(ctxt, cursor), &env);
+// whether each neighbouring pair is ordered the way op says
+static value_t compare(context_p ctxt, prim_t op, int argc, value_t *argv) {
+  for (int i = 0; i < argc; i++) {
+    if (!is_number(ctxt, argv[i])) {
+      return make_error(ctxt, __LINE__);
+    }
+  }
 
-    bool test = as_integer(ctxt, car) > as_integer(ctxt, cadr);
-    if (!test) {
-      return vfalse;
+  for (int i = 0; i + 1 < argc; i++) {
+    value_t test;
+    if (prim_numbers(ctxt, op, argv[i], argv[i + 1], &test)) {
+      if (is_vfalse(ctxt, test)) {
+        return vfalse;
+      }
+      continue;
     }
 
-    car    = cadr;
-    cursor = cons_cdr(ctxt, cursor);
+    if (is_exact(ctxt, argv[i]) && is_exact(ctxt, argv[i + 1])) {
+      int order = exact_compare(ctxt, argv[i], argv[i + 1]);
+      bool ok;
+      switch (op) {
+      case PRIM_EQ:  ok = order == 0; break;
+      case PRIM_LT:  ok = order <  0; break;
+      case PRIM_GT:  ok = order >  0; break;
+      case PRIM_LTE: ok = order <= 0; break;
+      default:       ok = order >= 0; break;
+      }
+
+      if (!ok) {
+        return vfalse;
+      }
+      continue;
+    }
+
+    double x = number_double(ctxt, argv[i]);
+    double y = number_double(ctxt, argv[i + 1]);
+    bool   ok;
+    switch (op) {
+    case PRIM_EQ:  ok = x == y; break;
+    case PRIM_LT:  ok = x <  y; break;
+    case PRIM_GT:  ok = x >  y; break;
+    case PRIM_LTE: ok = x <= y; break;
+    default:       ok = x >= y; break;
+    }
+
+    if (!ok) {
+      return vfalse;
+    }
   }
 
   return vtrue;
 }
 
-static value_t compgte_proc(context_p ctxt, value_t args, value_t env) {
-  value_t  cursor = args;
-  value_t  car, cadr;
+static value_t numeq_proc(context_p ctxt, int argc, value_t *argv) {
+  return compare(ctxt, PRIM_EQ, argc, argv);
+}
 
-  car = eval(ctxt, cons_car(ctxt, cursor), &env);
-  while (!is_nil(ctxt, cursor)) {
-    cadr = eval(ctxt, cons_cadr(ctxt, cursor), &env);
+static value_t complt_proc(context_p ctxt, int argc, value_t *argv) {
+  return compare(ctxt, PRIM_LT, argc, argv);
+}
 
-    bool test = as_integer(ctxt, car) >= as_integer(ctxt, cadr);
-    if (!test) {
-      return vfalse;
+static value_t compgt_proc(context_p ctxt, int argc, value_t *argv) {
+  return compare(ctxt, PRIM_GT, argc, argv);
+}
+
+static value_t complte_proc(context_p ctxt, int argc, value_t *argv) {
+  return compare(ctxt, PRIM_LTE, argc, argv);
+}
+
+static value_t compgte_proc(context_p ctxt, int argc, value_t *argv) {
+  return compare(ctxt, PRIM_GTE, argc, argv);
+}
+
+static bool is_zero(context_p ctxt, value_t v) {
+  return is_integer(ctxt, v) && as_integer(ctxt, v) == 0;
+}
+
+static value_t divide(context_p ctxt, value_t a, value_t b) {
+  if (!is_number(ctxt, a) || !is_number(ctxt, b)) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  if (is_exact(ctxt, a) && is_exact(ctxt, b)) {
+    if (is_zero(ctxt, b)) {
+      return make_error(ctxt, __LINE__);
     }
 
-    car    = cadr;
-    cursor = cons_cdr(ctxt, cursor);
+    value_t quotient, remainder;
+    exact_divide(ctxt, a, b, &quotient, &remainder);
+    if (is_zero(ctxt, remainder)) {
+      return quotient;
+    }
   }
 
-  return vtrue;
+  return make_double(ctxt, number_double(ctxt, a) / number_double(ctxt, b));
 }
 
-static value_t complte_proc(context_p ctxt, value_t args, value_t env) {
-  value_t  cursor = args;
-  value_t  car, cadr;
+static value_t div_proc(context_p ctxt, int argc, value_t *argv) {
+  // unary, the reciprocal
+  if (argc == 1) {
+    return divide(ctxt, make_integer(ctxt, 1), argv[0]);
+  }
 
-  car = eval(ctxt, cons_car(ctxt, cursor), &env);
-  while (!is_nil(ctxt, cursor)) {
-    cadr = eval(ctxt, cons_cadr(ctxt, cursor), &env);
+  value_t acc = argv[0];
+  for (int i = 1; i < argc && !is_error(ctxt, acc); i++) {
+    acc = divide(ctxt, acc, argv[i]);
+  }
+  return acc;
+}
 
-    bool test = as_integer(ctxt, car) <= as_integer(ctxt, cadr);
-    if (!test) {
-      return vfalse;
+// truncating, of integers; doubles are fine if they're whole
+static value_t integer_divide(context_p ctxt, value_t a, value_t b, bool remainder) {
+  if (is_exact(ctxt, a) && is_exact(ctxt, b)) {
+    if (is_zero(ctxt, b)) {
+      return make_error(ctxt, __LINE__);
     }
 
-    car    = cadr;
-    cursor = cons_cdr(ctxt, cursor);
+    value_t q, r;
+    exact_divide(ctxt, a, b, &q, &r);
+    return remainder ? r : q;
   }
 
-  return vtrue;
+  if (!is_number(ctxt, a) || !is_number(ctxt, b)) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  double x = number_double(ctxt, a);
+  double y = number_double(ctxt, b);
+  if (x != trunc(x) || y != trunc(y) || y == 0) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  return make_double(ctxt, remainder ? fmod(x, y) : trunc(x / y));
 }
 
-static value_t complt_proc(context_p ctxt, value_t args, value_t env) {
-  value_t  cursor = args;
-  value_t  car, cadr;
+static value_t quotient_proc(context_p ctxt, int, value_t *argv) {
+  return integer_divide(ctxt, argv[0], argv[1], false);
+}
 
-  car = eval(ctxt, cons_car(ctxt, cursor), &env);
-  while (!is_nil(ctxt, cursor)) {
-    cadr = eval(ctxt, cons_cadr(ctxt, cursor), &env);
+static value_t remainder_proc(context_p ctxt, int, value_t *argv) {
+  return integer_divide(ctxt, argv[0], argv[1], true);
+}
 
-    bool test = as_integer(ctxt, car) < as_integer(ctxt, cadr);
-    if (!test) {
-      return vfalse;
+// exact for fixnums that are perfect squares; no complex numbers, so
+// negatives are an error
+static value_t sqrt_proc(context_p ctxt, int, value_t *argv) {
+  value_t v = argv[0];
+  if (!is_number(ctxt, v)) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  double x = number_double(ctxt, v);
+  if (x < 0) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  double root = sqrt(x);
+  if (is_integer(ctxt, v)) {
+    int64_t n = as_integer(ctxt, v);
+    int64_t r = (int64_t)root;
+    while (r * r > n) {
+      r--;
+    }
+    while ((r + 1) * (r + 1) <= n) {
+      r++;
     }
+    if (r * r == n) {
+      return make_integer(ctxt, r);
+    }
+  }
+
+  return make_double(ctxt, root);
+}
+
+static value_t cons_proc(context_p ctxt, int, value_t *argv) {
+  return make_cons(ctxt, argv[0], argv[1]);
+}
+
+static value_t car_proc(context_p ctxt, int, value_t *argv) {
+  return cons_car(ctxt, argv[0]);
+}
+
+static value_t cdr_proc(context_p ctxt, int, value_t *argv) {
+  return cons_cdr(ctxt, argv[0]);
+}
+
+static value_t car_set_proc(context_p ctxt, int, value_t *argv) {
+  cons_set_car(ctxt, argv[0], argv[1]);
+  return vnil;
+}
+
+static value_t cdr_set_proc(context_p ctxt, int, value_t *argv) {
+  cons_set_cdr(ctxt, argv[0], argv[1]);
+  return vnil;
+}
+
+static value_t vectorp_proc(context_p ctxt, int, value_t *argv) {
+  return is_vector(ctxt, argv[0]) ? vtrue : vfalse;
+}
+
+// sizes and indices are ints past here
+static bool is_index(context_p ctxt, value_t v) {
+  return is_integer(ctxt, v) && as_integer(ctxt, v) >= 0 && as_integer(ctxt, v) <= INT32_MAX;
+}
+
+static value_t make_vector_proc(context_p ctxt, int argc, value_t *argv) {
+  value_t size = argv[0];
+  value_t fill = argc > 1 ? argv[1] : vnil;
 
-    car    = cadr;
-    cursor = cons_cdr(ctxt, cursor);
+  if (!is_index(ctxt, size)) {
+    return make_error(ctxt, __LINE__);
   }
 
-  return vtrue;
+  return make_vector(ctxt, as_integer(ctxt, size), fill);
 }
 
-static value_t cons_proc(context_p ctxt, value_t args, value_t env) {
-  value_t car = eval(ctxt, cons_car(ctxt, args), &env);
-  value_t cdr = eval(ctxt, cons_cadr(ctxt, args), &env);
+static value_t vector_length_proc(context_p ctxt, int, value_t *argv) {
+  value_t vec = argv[0];
+
+  if (!is_vector(ctxt, vec)) {
+    return make_error(ctxt, __LINE__);
+  }
 
-  return make_cons(ctxt, car, cdr);
+  return make_integer(ctxt, vector_size(ctxt, vec));
 }
 
-static value_t car_proc(context_p ctxt, value_t args, value_t env) {
-  value_t cons = eval(ctxt, cons_car(ctxt, args), &env);
-  return cons_car(ctxt, cons);
+static value_t vector_ref_proc(context_p ctxt, int, value_t *argv) {
+  value_t vec   = argv[0];
+  value_t index = argv[1];
+
+  if (!is_index(ctxt, index)) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  return vector_get(ctxt, vec, as_integer(ctxt, index));
 }
 
-static value_t cdr_proc(context_p ctxt, value_t args, value_t env) {
-  value_t cons = eval(ctxt, cons_car(ctxt, args), &env);
-  return cons_cdr(ctxt, cons);
+static value_t vector_set_proc(context_p ctxt, int, value_t *argv) {
+  value_t vec   = argv[0];
+  value_t index = argv[1];
+  value_t val   = argv[2];
+
+  if (!is_index(ctxt, index)) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  return vector_set(ctxt, vec, as_integer(ctxt, index), val);
 }
 
-static value_t car_set_proc(context_p ctxt, value_t args, value_t env) {
-  value_t cons = eval(ctxt, cons_car(ctxt, args), &env);
-  value_t val  = eval(ctxt, cons_cadr(ctxt, args), &env);
+/* numeric vectors */
 
-  cons_set_car(ctxt, cons, val);
-  return vnil;
+static value_t make_numvec_of(context_p ctxt, numvec_type_t type, int argc, value_t *argv) {
+  if (!is_integer(ctxt, argv[0])) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  value_t vec = make_numvec(ctxt, type, as_integer(ctxt, argv[0]));
+  if (argc > 1 && !is_error(ctxt, vec)) {
+    value_t result = numvec_fill(ctxt, vec, argv[1]);
+    if (is_error(ctxt, result)) {
+      return result;
+    }
+  }
+  return vec;
 }
 
-static value_t cdr_set_proc(context_p ctxt, value_t args, value_t env) {
-  value_t cons = eval(ctxt, cons_car(ctxt, args), &env);
-  value_t val  = eval(ctxt, cons_cadr(ctxt, args), &env);
+static value_t numvec_of(context_p ctxt, numvec_type_t type, int argc, value_t *argv) {
+  value_t vec = make_numvec(ctxt, type, argc);
+  for (int i = 0; i < argc; i++) {
+    value_t result = numvec_set(ctxt, vec, i, argv[i]);
+    if (is_error(ctxt, result)) {
+      return result;
+    }
+  }
+  return vec;
+}
 
-  cons_set_cdr(ctxt, cons, val);
-  return vnil;
+static value_t make_f64vector_proc(context_p ctxt, int argc, value_t *argv) {
+  return make_numvec_of(ctxt, NUMVEC_F64, argc, argv);
+}
+
+static value_t make_s32vector_proc(context_p ctxt, int argc, value_t *argv) {
+  return make_numvec_of(ctxt, NUMVEC_S32, argc, argv);
+}
+
+static value_t make_u8vector_proc(context_p ctxt, int argc, value_t *argv) {
+  return make_numvec_of(ctxt, NUMVEC_U8, argc, argv);
+}
+
+static value_t f64vector_proc(context_p ctxt, int argc, value_t *argv) {
+  return numvec_of(ctxt, NUMVEC_F64, argc, argv);
+}
+
+static value_t s32vector_proc(context_p ctxt, int argc, value_t *argv) {
+  return numvec_of(ctxt, NUMVEC_S32, argc, argv);
+}
+
+static value_t u8vector_proc(context_p ctxt, int argc, value_t *argv) {
+  return numvec_of(ctxt, NUMVEC_U8, argc, argv);
+}
+
+static bool is_numvec_of(context_p ctxt, numvec_type_t type, value_t v) {
+  return is_numvec(ctxt, v) && numvec_type(ctxt, v) == type;
 }
 
-static value_t list_proc(context_p ctxt, value_t args, value_t env) {
-  value_t cursor = args;
-  value_t car, cdr;
-  
-  while(!is_nil(ctxt, cursor)) {
-    car = eval(ctxt, cons_car(ctxt, cursor), &env);
-    cons_set_car(ctxt, cursor, car);
-    
-    cursor = cons_cdr(ctxt, cursor);
+static value_t numvec_length_of(context_p ctxt, numvec_type_t type, value_t *argv) {
+  if (!is_numvec_of(ctxt, type, argv[0])) {
+    return make_error(ctxt, __LINE__);
   }
+  return make_integer(ctxt, numvec_count(ctxt, argv[0]));
+}
 
-  return args;
+static value_t numvec_ref_of(context_p ctxt, numvec_type_t type, value_t *argv) {
+  if (!is_numvec_of(ctxt, type, argv[0]) || !is_integer(ctxt, argv[1])) {
+    return make_error(ctxt, __LINE__);
+  }
+  return numvec_get(ctxt, argv[0], as_integer(ctxt, argv[1]));
 }
 
-static value_t not_implemented_proc(context_p, value_t, value_t) {
-  fprintf(stderr, "no implemented, sorry\n");
-  return vnil;
+static value_t numvec_set_of(context_p ctxt, numvec_type_t type, value_t *argv) {
+  if (!is_numvec_of(ctxt, type, argv[0]) || !is_integer(ctxt, argv[1])) {
+    return make_error(ctxt, __LINE__);
+  }
+  return numvec_set(ctxt, argv[0], as_integer(ctxt, argv[1]), argv[2]);
+}
+
+static value_t f64vectorp_proc(context_p ctxt, int, value_t *argv) {
+  return is_numvec_of(ctxt, NUMVEC_F64, argv[0]) ? vtrue : vfalse;
+}
+
+static value_t s32vectorp_proc(context_p ctxt, int, value_t *argv) {
+  return is_numvec_of(ctxt, NUMVEC_S32, argv[0]) ? vtrue : vfalse;
+}
+
+static value_t u8vectorp_proc(context_p ctxt, int, value_t *argv) {
+  return is_numvec_of(ctxt, NUMVEC_U8, argv[0]) ? vtrue : vfalse;
+}
+
+static value_t f64vector_length_proc(context_p ctxt, int, value_t *argv) {
+  return numvec_length_of(ctxt, NUMVEC_F64, argv);
+}
+
+static value_t s32vector_length_proc(context_p ctxt, int, value_t *argv) {
+  return numvec_length_of(ctxt, NUMVEC_S32, argv);
+}
+
+static value_t u8vector_length_proc(context_p ctxt, int, value_t *argv) {
+  return numvec_length_of(ctxt, NUMVEC_U8, argv);
+}
+
+static value_t f64vector_ref_proc(context_p ctxt, int, value_t *argv) {
+  return numvec_ref_of(ctxt, NUMVEC_F64, argv);
+}
+
+static value_t s32vector_ref_proc(context_p ctxt, int, value_t *argv) {
+  return numvec_ref_of(ctxt, NUMVEC_S32, argv);
+}
+
+static value_t u8vector_ref_proc(context_p ctxt, int, value_t *argv) {
+  return numvec_ref_of(ctxt, NUMVEC_U8, argv);
+}
+
+static value_t f64vector_set_proc(context_p ctxt, int, value_t *argv) {
+  return numvec_set_of(ctxt, NUMVEC_F64, argv);
+}
+
+static value_t s32vector_set_proc(context_p ctxt, int, value_t *argv) {
+  return numvec_set_of(ctxt, NUMVEC_S32, argv);
+}
+
+static value_t u8vector_set_proc(context_p ctxt, int, value_t *argv) {
+  return numvec_set_of(ctxt, NUMVEC_U8, argv);
+}
+
+// the rest take any numeric vector
+static value_t numvec_fill_proc(context_p ctxt, int, value_t *argv) {
+  return numvec_fill(ctxt, argv[0], argv[1]);
+}
+
+static value_t numvec_copy_proc(context_p ctxt, int, value_t *argv) {
+  return numvec_copy(ctxt, argv[0], argv[1]);
+}
+
+static value_t numvec_sum_proc(context_p ctxt, int, value_t *argv) {
+  return numvec_sum(ctxt, argv[0]);
+}
+
+static value_t numvec_dot_proc(context_p ctxt, int, value_t *argv) {
+  return numvec_dot(ctxt, argv[0], argv[1]);
+}
+
+static value_t numvec_scale_proc(context_p ctxt, int, value_t *argv) {
+  return numvec_scale(ctxt, argv[0], argv[1]);
+}
+
+static value_t numvec_add_proc(context_p ctxt, int, value_t *argv) {
+  return numvec_add(ctxt, argv[0], argv[1]);
+}
+
+static value_t numvec_min_proc(context_p ctxt, int, value_t *argv) {
+  return numvec_min(ctxt, argv[0]);
+}
+
+static value_t numvec_max_proc(context_p ctxt, int, value_t *argv) {
+  return numvec_max(ctxt, argv[0]);
+}
+
+/* buffers */
+
+static value_t make_buffer_proc(context_p ctxt, int argc, value_t *argv) {
+  value_t size = argv[0];
+  value_t fill = argc > 1 ? argv[1] : make_integer(ctxt, 0);
+
+  if (!is_integer(ctxt, size) || !is_integer(ctxt, fill) ||
+      as_integer(ctxt, fill) < 0 || as_integer(ctxt, fill) > UINT8_MAX) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  return make_buffer(ctxt, as_integer(ctxt, size), (char)as_integer(ctxt, fill));
+}
+
+static value_t bufferp_proc(context_p ctxt, int, value_t *argv) {
+  return is_buffer(ctxt, argv[0]) ? vtrue : vfalse;
+}
+
+static value_t buffer_length_proc(context_p ctxt, int, value_t *argv) {
+  if (!is_buffer(ctxt, argv[0])) {
+    return make_error(ctxt, __LINE__);
+  }
+  return make_integer(ctxt, buffer_length(ctxt, argv[0]));
+}
+
+static value_t buffer_ref_proc(context_p ctxt, int, value_t *argv) {
+  if (!is_integer(ctxt, argv[1])) {
+    return make_error(ctxt, __LINE__);
+  }
+  return buffer_get(ctxt, argv[0], as_integer(ctxt, argv[1]));
+}
+
+static value_t buffer_set_proc(context_p ctxt, int, value_t *argv) {
+  if (!is_integer(ctxt, argv[1])) {
+    return make_error(ctxt, __LINE__);
+  }
+  return buffer_set(ctxt, argv[0], as_integer(ctxt, argv[1]), argv[2]);
+}
+
+// end defaults to the end of the buffer
+static value_t buffer_slice_proc(context_p ctxt, int argc, value_t *argv) {
+  if (!is_buffer(ctxt, argv[0]) || !is_integer(ctxt, argv[1]) ||
+      (argc > 2 && !is_integer(ctxt, argv[2]))) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  int64_t end = argc > 2 ? as_integer(ctxt, argv[2]) : (int64_t)buffer_length(ctxt, argv[0]);
+  return buffer_slice(ctxt, argv[0], as_integer(ctxt, argv[1]), end);
+}
+
+static value_t buffer_fill_proc(context_p ctxt, int, value_t *argv) {
+  return buffer_fill(ctxt, argv[0], argv[1]);
+}
+
+static value_t buffer_copy_proc(context_p ctxt, int, value_t *argv) {
+  if (!is_integer(ctxt, argv[1])) {
+    return make_error(ctxt, __LINE__);
+  }
+  return buffer_copy(ctxt, argv[0], as_integer(ctxt, argv[1]), argv[2]);
+}
+
+static value_t buffer_index_proc(context_p ctxt, int argc, value_t *argv) {
+  if (argc > 2 && !is_integer(ctxt, argv[2])) {
+    return make_error(ctxt, __LINE__);
+  }
+  return buffer_index(ctxt, argv[0], argv[1], argc > 2 ? as_integer(ctxt, argv[2]) : 0);
+}
+
+static value_t buffer_compare_proc(context_p ctxt, int, value_t *argv) {
+  return buffer_compare(ctxt, argv[0], argv[1]);
+}
+
+// strings aren't terminated, so a path is copied out for the c library
+static char* path_of(context_p ctxt, value_t str) {
+  uint32_t len = string_len(ctxt, str);
+  char *path = malloc(len + 1);
+  if (path == NULL) {
+    fprintf(stderr, "out of memory!\n");
+    exit(1);
+  }
+
+  memcpy(path, string_ptr(ctxt, str), len);
+  path[len] = '\0';
+  return path;
+}
+
+static value_t read_buffer_proc(context_p ctxt, int, value_t *argv) {
+  if (!is_string(ctxt, argv[0])) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  char *path = path_of(ctxt, argv[0]);
+  value_t buf = buffer_read_file(ctxt, path);
+  free(path);
+  return buf;
+}
+
+static value_t write_buffer_of(context_p ctxt, value_t *argv, bool append) {
+  if (!is_string(ctxt, argv[0])) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  char *path = path_of(ctxt, argv[0]);
+  value_t result = buffer_write_file(ctxt, path, argv[1], append);
+  free(path);
+  return result;
+}
+
+static value_t write_buffer_proc(context_p ctxt, int, value_t *argv) {
+  return write_buffer_of(ctxt, argv, false);
+}
+
+static value_t append_buffer_proc(context_p ctxt, int, value_t *argv) {
+  return write_buffer_of(ctxt, argv, true);
+}
+
+// the string's bytes can move when the buffer's made, so they're found again
+static value_t string_to_buffer_proc(context_p ctxt, int, value_t *argv) {
+  if (!is_string(ctxt, argv[0])) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  value_t buf = make_buffer(ctxt, string_len(ctxt, argv[0]), 0);
+  if (!is_error(ctxt, buf)) {
+    memcpy(buffer_data(ctxt, buf), string_ptr(ctxt, argv[0]), string_len(ctxt, argv[0]));
+  }
+  return buf;
 }
 
+static value_t buffer_to_string_proc(context_p ctxt, int, value_t *argv) {
+  if (!is_buffer(ctxt, argv[0]) || buffer_length(ctxt, argv[0]) > INT32_MAX) {
+    return make_error(ctxt, __LINE__);
+  }
+  return make_string(ctxt, buffer_data(ctxt, argv[0]), buffer_length(ctxt, argv[0]));
+}
+
+// argv is a root, so it's read again after every cons
+static value_t list_proc(context_p ctxt, int argc, value_t *argv) {
+  value_t list = vnil;
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &list);
+
+  for (int i = argc - 1; i >= 0; i--) {
+    list = make_cons(ctxt, argv[i], list);
+  }
+
+  gc_unroot(ctxt, frame);
+  return list;
+}
+
+/*
+  an alist of counters. the -allocated ones count up forever: cells
+  are conses only, strings are every slot in the string pool (symbols,
+  bignums and numeric vectors too), and buffers include slices. the
+  rest are a census of what's there now, live or not, except
+  cells-live-at-last-major, which a major collection sets when it
+  finishes and is 0 before the first. pause times are in microseconds.
+*/
+static value_t heap_stats_proc(context_p ctxt, int, value_t*) {
+  context_stats_t stats;
+  context_stats(ctxt, &stats);
+
+  struct { char *name; uint64_t value; } fields[] = {
+    { "cells-allocated",          stats.cells_allocated },
+    { "cells-in-use",             stats.cells_in_use },
+    { "cells-live-at-last-major", stats.cells_live },
+    { "cells-capacity",           stats.cells_capacity },
+    { "strings-allocated",        stats.strings_allocated },
+    { "strings",                  stats.string_count },
+    { "string-bytes",             stats.string_bytes },
+    { "symbols",                  stats.symbol_count },
+    { "symbol-bytes",             stats.symbol_bytes },
+    { "vectors-allocated",        stats.vectors_allocated },
+    { "vectors",                  stats.vector_count },
+    { "vector-bytes",             stats.vector_bytes },
+    { "buffers-allocated",        stats.buffers_allocated },
+    { "buffers",                  stats.buffer_count },
+    { "buffer-bytes",             stats.buffer_bytes },
+    { "symbol-table-size",        stats.symbol_table_limit },
+    { "symbol-probe-max",         stats.symbol_probe_max },
+    { "gc-minor",                 stats.gc_minor_count },
+    { "gc-major",                 stats.gc_major_count },
+    { "gc-pause-total-us",        stats.gc_pause_total / 1000 },
+    { "gc-pause-max-us",          stats.gc_pause_max / 1000 },
+  };
+
+  value_t list = vnil;
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &list);
+
+  for (int i = sizeof(fields) / sizeof(fields[0]) - 1; i >= 0; i--) {
+    value_t name  = make_symbol(ctxt, fields[i].name, strlen(fields[i].name));
+    value_t entry = make_cons(ctxt, name, make_integer(ctxt, fields[i].value));
+    list = make_cons(ctxt, entry, list);
+  }
+
+  gc_unroot(ctxt, frame);
+  return list;
+}
+
+// natives are globals; the env is answered as it was
 value_t enhance_native_environment(context_p ctxt) {
-  value_t env = ctxt->curr_env;
-
-  env = install_op(ctxt, env, "print-debug",    &debugprint_proc);
-
-  env = install_op(ctxt, env, "null?",          &nullp_proc);
-  env = install_op(ctxt, env, "eq?",            &eqp_proc);
-
-  env = install_op(ctxt, env, "bool?",          &boolp_proc);
-  env = install_op(ctxt, env, "symbol?",        &symbolp_proc);
-  env = install_op(ctxt, env, "integer?",       &integerp_proc);
-  env = install_op(ctxt, env, "float?",         &floatp_proc);
-  env = install_op(ctxt, env, "char?",          &charp_proc);
-  env = install_op(ctxt, env, "string?",        &stringp_proc);
-  env = install_op(ctxt, env, "pair?",          &consp_proc);
-  env = install_op(ctxt, env, "procedure?",     &procp_proc);
-
-  env = install_op(ctxt, env, "char->integer",  &to_integer_proc);
-  env = install_op(ctxt, env, "integer->char",  &to_character_proc);
-  env = install_op(ctxt, env, "number->string", &to_string_proc);
-  env = install_op(ctxt, env, "string->number", &to_integer_proc);
-  env = install_op(ctxt, env, "symbol->string", &to_string_proc);
-  env = install_op(ctxt, env, "string->symbol", &to_symbol_proc);
-
-  env = install_op(ctxt, env, "+",              &intadd_proc);
-  env = install_op(ctxt, env, "-",              &intsub_proc);
-  env = install_op(ctxt, env, "*",              &intmul_proc);
-  env = install_op(ctxt, env, "quotient",       &not_implemented_proc);
-  env = install_op(ctxt, env, "remainder",      &not_implemented_proc);
-  env = install_op(ctxt, env, "=",              &eqp_proc);
-  env = install_op(ctxt, env, "<",              &compgt_proc);
-  env = install_op(ctxt, env, ">",              &complt_proc);
-  env = install_op(ctxt, env, ">=",             &compgte_proc);
-  env = install_op(ctxt, env, "<=",             &complte_proc);
-
-  env = install_op(ctxt, env, "cons",           &cons_proc);
-  env = install_op(ctxt, env, "car",            &car_proc);
-  env = install_op(ctxt, env, "cdr",            &cdr_proc);
-  env = install_op(ctxt, env, "set-car!",       &car_set_proc);
-  env = install_op(ctxt, env, "set-cdr!",       &cdr_set_proc);
-  env = install_op(ctxt, env, "list",           &list_proc);
-
-  return env;
+  install_op(ctxt, "print-debug",    &debugprint_proc,       1, 1);
+  install_op(ctxt, "heap-stats",     &heap_stats_proc,       0, 0);
+
+  install_pure(ctxt, "null?",        &nullp_proc,            1, 1);
+  install_pure(ctxt, "eq?",          &eqp_proc,              2, 2);
+
+  install_pure(ctxt, "bool?",        &boolp_proc,            1, 1);
+  install_pure(ctxt, "symbol?",      &symbolp_proc,          1, 1);
+  install_pure(ctxt, "integer?",     &integerp_proc,         1, 1);
+  install_pure(ctxt, "float?",       &floatp_proc,           1, 1);
+  install_pure(ctxt, "char?",        &charp_proc,            1, 1);
+  install_pure(ctxt, "string?",      &stringp_proc,          1, 1);
+  install_pure(ctxt, "pair?",        &consp_proc,            1, 1);
+  install_pure(ctxt, "procedure?",   &procp_proc,            1, 1);
+  install_pure(ctxt, "vector?",      &vectorp_proc,          1, 1);
+
+  install_pure(ctxt, "char->integer", &to_integer_proc,      1, 1);
+  install_pure(ctxt, "integer->char", &to_character_proc,    1, 1);
+  install_op(ctxt, "number->string", &to_string_proc,        1, 1);
+  install_op(ctxt, "string->number", &to_integer_proc,       1, 1);
+  install_op(ctxt, "symbol->string", &to_string_proc,        1, 1);
+  install_op(ctxt, "string->symbol", &to_symbol_proc,        1, 1);
+
+  install_op(ctxt, "string-length",  &string_length_proc,    1, 1);
+  install_op(ctxt, "string-ref",     &string_ref_proc,       2, 2);
+  install_op(ctxt, "substring",      &substring_proc,        2, 3);
+  install_op(ctxt, "string-split",   &string_split_proc,     2, 2);
+
+  install_prim(ctxt, "+",            &add_proc,              0, ARITY_ANY, PRIM_ADD);
+  install_prim(ctxt, "-",            &sub_proc,              1, ARITY_ANY, PRIM_SUB);
+  install_prim(ctxt, "*",            &mul_proc,              0, ARITY_ANY, PRIM_MUL);
+  install_prim(ctxt, "=",            &numeq_proc,            1, ARITY_ANY, PRIM_EQ);
+  install_prim(ctxt, "<",            &complt_proc,           1, ARITY_ANY, PRIM_LT);
+  install_prim(ctxt, ">",            &compgt_proc,           1, ARITY_ANY, PRIM_GT);
+  install_prim(ctxt, "<=",           &complte_proc,          1, ARITY_ANY, PRIM_LTE);
+  install_prim(ctxt, ">=",           &compgte_proc,          1, ARITY_ANY, PRIM_GTE);
+  install_pure(ctxt, "/",            &div_proc,              1, ARITY_ANY);
+  install_pure(ctxt, "quotient",     &quotient_proc,         2, 2);
+  install_pure(ctxt, "remainder",    &remainder_proc,        2, 2);
+  install_pure(ctxt, "sqrt",         &sqrt_proc,             1, 1);
+
+  install_op(ctxt, "cons",           &cons_proc,             2, 2);
+  install_op(ctxt, "car",            &car_proc,              1, 1);
+  install_op(ctxt, "cdr",            &cdr_proc,              1, 1);
+  install_op(ctxt, "set-car!",       &car_set_proc,          2, 2);
+  install_op(ctxt, "set-cdr!",       &cdr_set_proc,          2, 2);
+  install_op(ctxt, "list",           &list_proc,             0, ARITY_ANY);
+
+  install_op(ctxt, "make-vector",    &make_vector_proc,      1, 2);
+  install_op(ctxt, "vector-length",  &vector_length_proc,    1, 1);
+  install_op(ctxt, "vector-ref",     &vector_ref_proc,       2, 2);
+  install_op(ctxt, "vector-set!",    &vector_set_proc,       3, 3);
+
+  install_op(ctxt, "make-f64vector", &make_f64vector_proc,   1, 2);
+  install_op(ctxt, "make-s32vector", &make_s32vector_proc,   1, 2);
+  install_op(ctxt, "make-u8vector",  &make_u8vector_proc,    1, 2);
+  install_op(ctxt, "f64vector",      &f64vector_proc,        0, ARITY_ANY);
+  install_op(ctxt, "s32vector",      &s32vector_proc,        0, ARITY_ANY);
+  install_op(ctxt, "u8vector",       &u8vector_proc,         0, ARITY_ANY);
+  install_pure(ctxt, "f64vector?",   &f64vectorp_proc,       1, 1);
+  install_pure(ctxt, "s32vector?",   &s32vectorp_proc,       1, 1);
+  install_pure(ctxt, "u8vector?",    &u8vectorp_proc,        1, 1);
+  install_op(ctxt, "f64vector-length", &f64vector_length_proc, 1, 1);
+  install_op(ctxt, "s32vector-length", &s32vector_length_proc, 1, 1);
+  install_op(ctxt, "u8vector-length",  &u8vector_length_proc,  1, 1);
+  install_op(ctxt, "f64vector-ref",  &f64vector_ref_proc,    2, 2);
+  install_op(ctxt, "s32vector-ref",  &s32vector_ref_proc,    2, 2);
+  install_op(ctxt, "u8vector-ref",   &u8vector_ref_proc,     2, 2);
+  install_op(ctxt, "f64vector-set!", &f64vector_set_proc,    3, 3);
+  install_op(ctxt, "s32vector-set!", &s32vector_set_proc,    3, 3);
+  install_op(ctxt, "u8vector-set!",  &u8vector_set_proc,     3, 3);
+  install_op(ctxt, "numvec-fill!",   &numvec_fill_proc,      2, 2);
+  install_op(ctxt, "numvec-copy!",   &numvec_copy_proc,      2, 2);
+  install_op(ctxt, "numvec-sum",     &numvec_sum_proc,       1, 1);
+  install_op(ctxt, "numvec-dot",     &numvec_dot_proc,       2, 2);
+  install_op(ctxt, "numvec-scale!",  &numvec_scale_proc,     2, 2);
+  install_op(ctxt, "numvec-add!",    &numvec_add_proc,       2, 2);
+  install_op(ctxt, "numvec-min",     &numvec_min_proc,       1, 1);
+  install_op(ctxt, "numvec-max",     &numvec_max_proc,       1, 1);
+
+  install_op(ctxt, "make-buffer",    &make_buffer_proc,      1, 2);
+  install_pure(ctxt, "buffer?",      &bufferp_proc,          1, 1);
+  install_op(ctxt, "buffer-length",  &buffer_length_proc,    1, 1);
+  install_op(ctxt, "buffer-ref",     &buffer_ref_proc,       2, 2);
+  install_op(ctxt, "buffer-set!",    &buffer_set_proc,       3, 3);
+  install_op(ctxt, "buffer-slice",   &buffer_slice_proc,     2, 3);
+  install_op(ctxt, "buffer-fill!",   &buffer_fill_proc,      2, 2);
+  install_op(ctxt, "buffer-copy!",   &buffer_copy_proc,      3, 3);
+  install_op(ctxt, "buffer-index",   &buffer_index_proc,     2, 3);
+  install_op(ctxt, "buffer-compare", &buffer_compare_proc,   2, 2);
+  install_op(ctxt, "read-buffer",    &read_buffer_proc,      1, 1);
+  install_op(ctxt, "write-buffer",   &write_buffer_proc,     2, 2);
+  install_op(ctxt, "append-buffer",  &append_buffer_proc,    2, 2);
+  install_op(ctxt, "string->buffer", &string_to_buffer_proc, 1, 1);
+  install_op(ctxt, "buffer->string", &buffer_to_string_proc, 1, 1);
+
+  return ctxt->curr_env;
+}
+
+// eq?'s native, found by its function, so a global that's rebound
+// eq? can't stand in for it
+value_t eq_native(context_p ctxt) {
+  for (int i = 0; i < ctxt->native_proc_count; i++) {
+    if (ctxt->native_procs[i].fn == &eqp_proc) {
+      return native_proc_at(ctxt, i);
+    }
+  }
+  return vnil;
 }
@@ -0,0 +1,664 @@
+#include <stdlib.h>
+#include <string.h>
+#include "scheme.h"
+
+/*
+  numeric vectors: f64vector, s32vector and u8vector, elements stored
+  unboxed and contiguous (see make_numvec), and the bulk operations on
+  them.
+
+  every kernel is a plain loop, and on x86-64 there's an avx2 version as
+  well, picked at run time when the cpu has it. the two answer the same,
+  except that a double sum or dot is added up four lanes at a time, so
+  its rounding can differ from a left to right fold.
+
+  integer elements wrap, like c's unsigned arithmetic (an s32 is two's
+  complement). sums and dots of integer vectors are exact, though: s32
+  and u8 sums fit in 64 bits for any vector that fits in the pool, and
+  an s32 dot's accumulated in 128 bits, which is why it's the one
+  kernel without an avx2 version.
+*/
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+
+#include <immintrin.h>
+
+#define NUMVEC_AVX2
+#define AVX2 __attribute__((target("avx2")))
+
+static bool has_avx2(void) {
+  static int avx2 = -1;
+  if (avx2 < 0) {
+    __builtin_cpu_init();
+    avx2 = __builtin_cpu_supports("avx2") != 0;
+  }
+  return avx2;
+}
+
+AVX2 static double sum_f64_avx2(const double *v, uint32_t n) {
+  __m256d acc = _mm256_setzero_pd();
+  uint32_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    acc = _mm256_add_pd(acc, _mm256_loadu_pd(v + i));
+  }
+
+  double lanes[4];
+  _mm256_storeu_pd(lanes, acc);
+  double sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+  for (; i < n; i++) {
+    sum += v[i];
+  }
+  return sum;
+}
+
+// widened to 64 bit lanes, 8 at a time
+AVX2 static int64_t sum_s32_avx2(const int32_t *v, uint32_t n) {
+  __m256i acc = _mm256_setzero_si256();
+  uint32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i x = _mm256_loadu_si256((const __m256i*)(v + i));
+    acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(x)));
+    acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(x, 1)));
+  }
+
+  int64_t lanes[4];
+  _mm256_storeu_si256((__m256i*)lanes, acc);
+  int64_t sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  for (; i < n; i++) {
+    sum += v[i];
+  }
+  return sum;
+}
+
+// psadbw against zero sums each 8 bytes into a 64 bit lane
+AVX2 static int64_t sum_u8_avx2(const uint8_t *v, uint32_t n) {
+  __m256i acc  = _mm256_setzero_si256();
+  __m256i zero = _mm256_setzero_si256();
+  uint32_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i*)(v + i));
+    acc = _mm256_add_epi64(acc, _mm256_sad_epu8(x, zero));
+  }
+
+  int64_t lanes[4];
+  _mm256_storeu_si256((__m256i*)lanes, acc);
+  int64_t sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  for (; i < n; i++) {
+    sum += v[i];
+  }
+  return sum;
+}
+
+AVX2 static double dot_f64_avx2(const double *a, const double *b, uint32_t n) {
+  __m256d acc = _mm256_setzero_pd();
+  uint32_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    acc = _mm256_add_pd(acc, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+  }
+
+  double lanes[4];
+  _mm256_storeu_pd(lanes, acc);
+  double dot = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+  for (; i < n; i++) {
+    dot += a[i] * b[i];
+  }
+  return dot;
+}
+
+// widened to 16 bits, so pmaddwd pairs up products into 32 bit lanes
+AVX2 static int64_t dot_u8_avx2(const uint8_t *a, const uint8_t *b, uint32_t n) {
+  __m256i acc = _mm256_setzero_si256();
+  uint32_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i x = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(a + i)));
+    __m256i y = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(b + i)));
+    __m256i p = _mm256_madd_epi16(x, y);
+    acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(p)));
+    acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(p, 1)));
+  }
+
+  int64_t lanes[4];
+  _mm256_storeu_si256((__m256i*)lanes, acc);
+  int64_t dot = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  for (; i < n; i++) {
+    dot += a[i] * b[i];
+  }
+  return dot;
+}
+
+AVX2 static void scale_f64_avx2(double *v, uint32_t n, double k) {
+  __m256d scale = _mm256_set1_pd(k);
+  uint32_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(v + i, _mm256_mul_pd(_mm256_loadu_pd(v + i), scale));
+  }
+  for (; i < n; i++) {
+    v[i] *= k;
+  }
+}
+
+AVX2 static void scale_s32_avx2(int32_t *v, uint32_t n, uint32_t k) {
+  __m256i scale = _mm256_set1_epi32(k);
+  uint32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i x = _mm256_loadu_si256((const __m256i*)(v + i));
+    _mm256_storeu_si256((__m256i*)(v + i), _mm256_mullo_epi32(x, scale));
+  }
+  for (; i < n; i++) {
+    v[i] = (int32_t)((uint32_t)v[i] * k);
+  }
+}
+
+AVX2 static void add_f64_avx2(double *a, const double *b, uint32_t n) {
+  uint32_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(a + i, _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+  }
+  for (; i < n; i++) {
+    a[i] += b[i];
+  }
+}
+
+AVX2 static void add_s32_avx2(int32_t *a, const int32_t *b, uint32_t n) {
+  uint32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+    __m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+    _mm256_storeu_si256((__m256i*)(a + i), _mm256_add_epi32(x, y));
+  }
+  for (; i < n; i++) {
+    a[i] = (int32_t)((uint32_t)a[i] + (uint32_t)b[i]);
+  }
+}
+
+AVX2 static void add_u8_avx2(uint8_t *a, const uint8_t *b, uint32_t n) {
+  uint32_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+    __m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+    _mm256_storeu_si256((__m256i*)(a + i), _mm256_add_epi8(x, y));
+  }
+  for (; i < n; i++) {
+    a[i] += b[i];
+  }
+}
+
+// minpd answers its second operand when either's a nan, so m keeps its
+// value past a nan element, the same as the plain loop
+AVX2 static double extreme_f64_avx2(const double *v, uint32_t n, bool max) {
+  __m256d m = _mm256_set1_pd(v[0]);
+  uint32_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d x = _mm256_loadu_pd(v + i);
+    m = max ? _mm256_max_pd(x, m) : _mm256_min_pd(x, m);
+  }
+
+  double lanes[4];
+  _mm256_storeu_pd(lanes, m);
+  double r = lanes[0];
+  for (int l = 1; l < 4; l++) {
+    r = (max ? lanes[l] > r : lanes[l] < r) ? lanes[l] : r;
+  }
+  for (; i < n; i++) {
+    r = (max ? v[i] > r : v[i] < r) ? v[i] : r;
+  }
+  return r;
+}
+
+AVX2 static int32_t extreme_s32_avx2(const int32_t *v, uint32_t n, bool max) {
+  __m256i m = _mm256_set1_epi32(v[0]);
+  uint32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i x = _mm256_loadu_si256((const __m256i*)(v + i));
+    m = max ? _mm256_max_epi32(x, m) : _mm256_min_epi32(x, m);
+  }
+
+  int32_t lanes[8];
+  _mm256_storeu_si256((__m256i*)lanes, m);
+  int32_t r = lanes[0];
+  for (int l = 1; l < 8; l++) {
+    r = (max ? lanes[l] > r : lanes[l] < r) ? lanes[l] : r;
+  }
+  for (; i < n; i++) {
+    r = (max ? v[i] > r : v[i] < r) ? v[i] : r;
+  }
+  return r;
+}
+
+AVX2 static uint8_t extreme_u8_avx2(const uint8_t *v, uint32_t n, bool max) {
+  __m256i m = _mm256_set1_epi8((char)v[0]);
+  uint32_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i*)(v + i));
+    m = max ? _mm256_max_epu8(x, m) : _mm256_min_epu8(x, m);
+  }
+
+  uint8_t lanes[32];
+  _mm256_storeu_si256((__m256i*)lanes, m);
+  uint8_t r = lanes[0];
+  for (int l = 1; l < 32; l++) {
+    r = (max ? lanes[l] > r : lanes[l] < r) ? lanes[l] : r;
+  }
+  for (; i < n; i++) {
+    r = (max ? v[i] > r : v[i] < r) ? v[i] : r;
+  }
+  return r;
+}
+
+#endif
+
+/* kernels */
+
+static double sum_f64(const double *v, uint32_t n) {
+#ifdef NUMVEC_AVX2
+  if (has_avx2()) {
+    return sum_f64_avx2(v, n);
+  }
+#endif
+  double sum = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    sum += v[i];
+  }
+  return sum;
+}
+
+static int64_t sum_s32(const int32_t *v, uint32_t n) {
+#ifdef NUMVEC_AVX2
+  if (has_avx2()) {
+    return sum_s32_avx2(v, n);
+  }
+#endif
+  int64_t sum = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    sum += v[i];
+  }
+  return sum;
+}
+
+static int64_t sum_u8(const uint8_t *v, uint32_t n) {
+#ifdef NUMVEC_AVX2
+  if (has_avx2()) {
+    return sum_u8_avx2(v, n);
+  }
+#endif
+  int64_t sum = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    sum += v[i];
+  }
+  return sum;
+}
+
+static double dot_f64(const double *a, const double *b, uint32_t n) {
+#ifdef NUMVEC_AVX2
+  if (has_avx2()) {
+    return dot_f64_avx2(a, b, n);
+  }
+#endif
+  double dot = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    dot += a[i] * b[i];
+  }
+  return dot;
+}
+
+static __int128 dot_s32(const int32_t *a, const int32_t *b, uint32_t n) {
+  __int128 dot = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    dot += (int64_t)a[i] * b[i];
+  }
+  return dot;
+}
+
+static int64_t dot_u8(const uint8_t *a, const uint8_t *b, uint32_t n) {
+#ifdef NUMVEC_AVX2
+  if (has_avx2()) {
+    return dot_u8_avx2(a, b, n);
+  }
+#endif
+  int64_t dot = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    dot += a[i] * b[i];
+  }
+  return dot;
+}
+
+static void scale_f64(double *v, uint32_t n, double k) {
+#ifdef NUMVEC_AVX2
+  if (has_avx2()) {
+    scale_f64_avx2(v, n, k);
+    return;
+  }
+#endif
+  for (uint32_t i = 0; i < n; i++) {
+    v[i] *= k;
+  }
+}
+
+static void scale_s32(int32_t *v, uint32_t n, uint32_t k) {
+#ifdef NUMVEC_AVX2
+  if (has_avx2()) {
+    scale_s32_avx2(v, n, k);
+    return;
+  }
+#endif
+  for (uint32_t i = 0; i < n; i++) {
+    v[i] = (int32_t)((uint32_t)v[i] * k);
+  }
+}
+
+static void scale_u8(uint8_t *v, uint32_t n, uint8_t k) {
+  for (uint32_t i = 0; i < n; i++) {
+    v[i] = (uint8_t)(v[i] * k);
+  }
+}
+
+static void add_f64(double *a, const double *b, uint32_t n) {
+#ifdef NUMVEC_AVX2
+  if (has_avx2()) {
+    add_f64_avx2(a, b, n);
+    return;
+  }
+#endif
+  for (uint32_t i = 0; i < n; i++) {
+    a[i] += b[i];
+  }
+}
+
+static void add_s32(int32_t *a, const int32_t *b, uint32_t n) {
+#ifdef NUMVEC_AVX2
+  if (has_avx2()) {
+    add_s32_avx2(a, b, n);
+    return;
+  }
+#endif
+  for (uint32_t i = 0; i < n; i++) {
+    a[i] = (int32_t)((uint32_t)a[i] + (uint32_t)b[i]);
+  }
+}
+
+static void add_u8(uint8_t *a, const uint8_t *b, uint32_t n) {
+#ifdef NUMVEC_AVX2
+  if (has_avx2()) {
+    add_u8_avx2(a, b, n);
+    return;
+  }
+#endif
+  for (uint32_t i = 0; i < n; i++) {
+    a[i] += b[i];
+  }
+}
+
+// the smallest (or largest) of n > 0 elements
+static double extreme_f64(const double *v, uint32_t n, bool max) {
+#ifdef NUMVEC_AVX2
+  if (has_avx2()) {
+    return extreme_f64_avx2(v, n, max);
+  }
+#endif
+  double r = v[0];
+  for (uint32_t i = 1; i < n; i++) {
+    r = (max ? v[i] > r : v[i] < r) ? v[i] : r;
+  }
+  return r;
+}
+
+static int32_t extreme_s32(const int32_t *v, uint32_t n, bool max) {
+#ifdef NUMVEC_AVX2
+  if (has_avx2()) {
+    return extreme_s32_avx2(v, n, max);
+  }
+#endif
+  int32_t r = v[0];
+  for (uint32_t i = 1; i < n; i++) {
+    r = (max ? v[i] > r : v[i] < r) ? v[i] : r;
+  }
+  return r;
+}
+
+static uint8_t extreme_u8(const uint8_t *v, uint32_t n, bool max) {
+#ifdef NUMVEC_AVX2
+  if (has_avx2()) {
+    return extreme_u8_avx2(v, n, max);
+  }
+#endif
+  uint8_t r = v[0];
+  for (uint32_t i = 1; i < n; i++) {
+    r = (max ? v[i] > r : v[i] < r) ? v[i] : r;
+  }
+  return r;
+}
+
+/* elements */
+
+static bool to_f64(context_p ctxt, value_t x, double *out) {
+  if (is_double(ctxt, x)) {
+    *out = as_double(ctxt, x);
+  } else if (is_exact(ctxt, x)) {
+    *out = exact_double(ctxt, x);
+  } else if (is_float(ctxt, x)) {
+    *out = as_float(ctxt, x);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// a fixnum that fits the element type
+static bool to_element(context_p ctxt, numvec_type_t type, value_t x, int64_t *out) {
+  if (!is_integer(ctxt, x)) {
+    return false;
+  }
+
+  *out = as_integer(ctxt, x);
+  if (type == NUMVEC_S32) {
+    return *out >= INT32_MIN && *out <= INT32_MAX;
+  }
+  return *out >= 0 && *out <= UINT8_MAX;
+}
+
+// a and b the same type and length
+static bool numvec_match(context_p ctxt, value_t a, value_t b) {
+  return is_numvec(ctxt, a) && is_numvec(ctxt, b) &&
+    numvec_type(ctxt, a) == numvec_type(ctxt, b) &&
+    numvec_count(ctxt, a) == numvec_count(ctxt, b);
+}
+
+value_t numvec_get(context_p ctxt, value_t v, int64_t index) {
+  if (!is_numvec(ctxt, v) || index < 0 || index >= numvec_count(ctxt, v)) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  void *data = numvec_data(ctxt, v);
+  switch (numvec_type(ctxt, v)) {
+  case NUMVEC_F64: return make_double(ctxt, ((double*)data)[index]);
+  case NUMVEC_S32: return make_integer(ctxt, ((int32_t*)data)[index]);
+  default:         return make_integer(ctxt, ((uint8_t*)data)[index]);
+  }
+}
+
+value_t numvec_set(context_p ctxt, value_t v, int64_t index, value_t x) {
+  if (!is_numvec(ctxt, v) || index < 0 || index >= numvec_count(ctxt, v)) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  void *data = numvec_data(ctxt, v);
+  numvec_type_t type = numvec_type(ctxt, v);
+  if (type == NUMVEC_F64) {
+    if (!to_f64(ctxt, x, &((double*)data)[index])) {
+      return make_error(ctxt, __LINE__);
+    }
+    return vnil;
+  }
+
+  int64_t n;
+  if (!to_element(ctxt, type, x, &n)) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  if (type == NUMVEC_S32) {
+    ((int32_t*)data)[index] = (int32_t)n;
+  } else {
+    ((uint8_t*)data)[index] = (uint8_t)n;
+  }
+  return vnil;
+}
+
+/* bulk operations */
+
+value_t numvec_fill(context_p ctxt, value_t v, value_t x) {
+  if (!is_numvec(ctxt, v)) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  void *data = numvec_data(ctxt, v);
+  uint32_t n = numvec_count(ctxt, v);
+  numvec_type_t type = numvec_type(ctxt, v);
+
+  double  d;
+  int64_t k;
+  if (type == NUMVEC_F64 ? !to_f64(ctxt, x, &d) : !to_element(ctxt, type, x, &k)) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  switch (type) {
+  case NUMVEC_F64:
+    for (uint32_t i = 0; i < n; i++) {
+      ((double*)data)[i] = d;
+    }
+    break;
+
+  case NUMVEC_S32:
+    for (uint32_t i = 0; i < n; i++) {
+      ((int32_t*)data)[i] = (int32_t)k;
+    }
+    break;
+
+  default:
+    memset(data, (int)k, n);
+    break;
+  }
+  return vnil;
+}
+
+// from's elements over the start of to, which has room for them
+value_t numvec_copy(context_p ctxt, value_t to, value_t from) {
+  if (!is_numvec(ctxt, to) || !is_numvec(ctxt, from) ||
+      numvec_type(ctxt, to) != numvec_type(ctxt, from) ||
+      numvec_count(ctxt, to) < numvec_count(ctxt, from)) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  memmove(numvec_data(ctxt, to), numvec_data(ctxt, from), numvec_bytes(ctxt, from));
+  return vnil;
+}
+
+value_t numvec_sum(context_p ctxt, value_t v) {
+  if (!is_numvec(ctxt, v)) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  void *data = numvec_data(ctxt, v);
+  uint32_t n = numvec_count(ctxt, v);
+  switch (numvec_type(ctxt, v)) {
+  case NUMVEC_F64: return make_double(ctxt, sum_f64(data, n));
+  case NUMVEC_S32: return make_exact(ctxt, sum_s32(data, n));
+  default:         return make_exact(ctxt, sum_u8(data, n));
+  }
+}
+
+value_t numvec_dot(context_p ctxt, value_t a, value_t b) {
+  if (!numvec_match(ctxt, a, b)) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  void *x = numvec_data(ctxt, a);
+  void *y = numvec_data(ctxt, b);
+  uint32_t n = numvec_count(ctxt, a);
+  switch (numvec_type(ctxt, a)) {
+  case NUMVEC_F64:
+    return make_double(ctxt, dot_f64(x, y, n));
+
+  case NUMVEC_S32: {
+    __int128 dot = dot_s32(x, y, n);
+    if (dot >= INT64_MIN && dot <= INT64_MAX) {
+      return make_exact(ctxt, (int64_t)dot);
+    }
+
+    unsigned __int128 magnitude = dot < 0 ? -(unsigned __int128)dot : (unsigned __int128)dot;
+    uint64_t limbs[2] = { (uint64_t)magnitude, (uint64_t)(magnitude >> 64) };
+    return make_bignum(ctxt, dot < 0, limbs, 2);
+  }
+
+  default:
+    return make_exact(ctxt, dot_u8(x, y, n));
+  }
+}
+
+value_t numvec_scale(context_p ctxt, value_t v, value_t k) {
+  if (!is_numvec(ctxt, v)) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  void *data = numvec_data(ctxt, v);
+  uint32_t n = numvec_count(ctxt, v);
+  numvec_type_t type = numvec_type(ctxt, v);
+
+  if (type == NUMVEC_F64) {
+    double d;
+    if (!to_f64(ctxt, k, &d)) {
+      return make_error(ctxt, __LINE__);
+    }
+    scale_f64(data, n, d);
+    return vnil;
+  }
+
+  // any fixnum, the elements wrap anyway
+  if (!is_integer(ctxt, k)) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  if (type == NUMVEC_S32) {
+    scale_s32(data, n, (uint32_t)as_integer(ctxt, k));
+  } else {
+    scale_u8(data, n, (uint8_t)as_integer(ctxt, k));
+  }
+  return vnil;
+}
+
+value_t numvec_add(context_p ctxt, value_t a, value_t b) {
+  if (!numvec_match(ctxt, a, b)) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  void *x = numvec_data(ctxt, a);
+  void *y = numvec_data(ctxt, b);
+  uint32_t n = numvec_count(ctxt, a);
+  switch (numvec_type(ctxt, a)) {
+  case NUMVEC_F64: add_f64(x, y, n); break;
+  case NUMVEC_S32: add_s32(x, y, n); break;
+  default:         add_u8(x, y, n);  break;
+  }
+  return vnil;
+}
+
+static value_t numvec_extreme(context_p ctxt, value_t v, bool max) {
+  if (!is_numvec(ctxt, v) || numvec_count(ctxt, v) == 0) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  void *data = numvec_data(ctxt, v);
+  uint32_t n = numvec_count(ctxt, v);
+  switch (numvec_type(ctxt, v)) {
+  case NUMVEC_F64: return make_double(ctxt, extreme_f64(data, n, max));
+  case NUMVEC_S32: return make_integer(ctxt, extreme_s32(data, n, max));
+  default:         return make_integer(ctxt, extreme_u8(data, n, max));
+  }
+}
+
+value_t numvec_min(context_p ctxt, value_t v) {
+  return numvec_extreme(ctxt, v, false);
+}
+
+value_t numvec_max(context_p ctxt, value_t v) {
+  return numvec_extreme(ctxt, v, true);
+}
@@ -0,0 +1,702 @@
+#include <stdio.h>
+#include "scheme.h"
+
+/*
+  an optional pass over an expression before it's evaluated. it's source
+  to source, so eval and the vm both get the benefit. it
+
+    folds calls to pure natives on literal args into their answers
+    prunes an if whose test is a literal down to the branch it picks
+    drops literals and variables that aren't the last in a body
+    inlines calls to small lambdas defined at the top level
+
+  folding and inlining are done inside lambdas, where the work they save
+  is repeated. they assume a global keeps the value it has now, and any
+  global may be defined again later, so a lambda whose body leans on
+  some is guarded: it becomes
+
+    (lambda (vars) (if (and (eq? name 'value) ...) optimized original))
+
+  with eq? the native itself, so the guard's good however it's rebound.
+  a redefinition just sends later calls down the original body. names
+  the form itself defines aren't leaned on.
+
+  ctxt->known has a #(index lambda) for each global the optimizer has
+  seen defined. lambda is the source of the top level
+  (define name (lambda ...)) that last set it, if that can be inlined,
+  and nil otherwise.
+
+  a lambda can be inlined when its body is one small expression with no
+  lambda or define in it, that doesn't mention the lambda's own name.
+  the args replace the params in the body, so each has to be a literal
+  or a variable, or else pure and used at most once.
+*/
+
+#define INLINE_SIZE  24 // atoms in a body that's inlined
+#define INLINE_DEPTH 4  // inlines inside of inlines
+
+typedef struct optimizer {
+  context_p ctxt;
+  value_t   defines; // globals the form defines
+  value_t   assumed; // (name . value) for each global the lambda leans on
+  int       depth;   // inlines we're inside of
+} optimizer_t;
+
+static value_t optimize_in(optimizer_t *o, value_t v, value_t scope);
+
+/* what's known about globals */
+
+static value_t known_entry(context_p ctxt, int index) {
+  for (value_t cursor = ctxt->known; !is_nil(ctxt, cursor); cursor = cons_cdr(ctxt, cursor)) {
+    value_t entry = cons_car(ctxt, cursor);
+    if ((int)as_integer(ctxt, vector_data(ctxt, entry)[0]) == index) {
+      return entry;
+    }
+  }
+  return vnil;
+}
+
+static value_t known_add(context_p ctxt, int index) {
+  value_t entry = known_entry(ctxt, index);
+  if (!is_nil(ctxt, entry)) {
+    return entry;
+  }
+
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &entry);
+
+  entry = make_vector(ctxt, 2, vnil);
+  vector_set(ctxt, entry, 0, make_integer(ctxt, index));
+  ctxt->known = make_cons(ctxt, entry, ctxt->known);
+
+  gc_unroot(ctxt, frame);
+  return entry;
+}
+
+// the lambda being optimized is only good while name holds value
+static void assume(optimizer_t *o, value_t name, value_t value) {
+  context_p ctxt = o->ctxt;
+  for (value_t cursor = o->assumed; !is_nil(ctxt, cursor); cursor = cons_cdr(ctxt, cursor)) {
+    if (equality_exact(ctxt, cons_car(ctxt, cons_car(ctxt, cursor)), name)) {
+      return;
+    }
+  }
+
+  value_t entry = vnil;
+
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &name);
+  gc_root(ctxt, &value);
+  gc_root(ctxt, &entry);
+
+  entry      = make_cons(ctxt, name, value);
+  o->assumed = make_cons(ctxt, entry, o->assumed);
+
+  gc_unroot(ctxt, frame);
+}
+
+/* names */
+
+static bool member(context_p ctxt, value_t names, value_t sym) {
+  for (; is_cons(ctxt, names); names = cons_cdr(ctxt, names)) {
+    if (equality_exact(ctxt, cons_car(ctxt, names), sym)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// scope is a list of frames' names, innermost first, like eval's
+static bool is_local(context_p ctxt, value_t scope, value_t sym) {
+  for (; !is_nil(ctxt, scope); scope = cons_cdr(ctxt, scope)) {
+    if (member(ctxt, cons_car(ctxt, scope), sym)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool is_keyword(context_p ctxt, value_t sym) {
+  return equality_exact(ctxt, sym, symquote)  ||
+         equality_exact(ctxt, sym, symif)     ||
+         equality_exact(ctxt, sym, symdefine) ||
+         equality_exact(ctxt, sym, symbegin)  ||
+         equality_exact(ctxt, sym, symlambda);
+}
+
+// the global v names, and its value, unless it's a local or being defined
+static bool global_value(optimizer_t *o, value_t scope, value_t v, int *index, value_t *value) {
+  context_p ctxt = o->ctxt;
+  if (!is_symbol(ctxt, v) || is_local(ctxt, scope, v) || member(ctxt, o->defines, v)) {
+    return false;
+  }
+
+  *index = global_index(ctxt, v);
+  *value = global_get(ctxt, *index);
+  return true;
+}
+
+/* literals */
+
+static bool is_self_evaluating(context_p ctxt, value_t v) {
+  return is_nil(ctxt, v)       ||
+         is_exact(ctxt, v)     ||
+         is_character(ctxt, v) ||
+         is_float(ctxt, v)     ||
+         is_double(ctxt, v)    ||
+         is_string(ctxt, v)    ||
+         is_boolean(ctxt, v);
+}
+
+// whether v evaluates to a constant, and what it is
+static bool is_literal(context_p ctxt, value_t v, value_t *value) {
+  if (is_self_evaluating(ctxt, v)) {
+    *value = v;
+    return true;
+  }
+
+  if (is_cons(ctxt, v) && equality_exact(ctxt, cons_car(ctxt, v), symquote)) {
+    *value = cons_cadr(ctxt, v);
+    return true;
+  }
+
+  return false;
+}
+
+static value_t make_literal(context_p ctxt, value_t v) {
+  if (is_self_evaluating(ctxt, v)) {
+    return v;
+  }
+
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &v);
+
+  v = make_cons(ctxt, v, vnil);
+  v = make_cons(ctxt, symquote, v);
+
+  gc_unroot(ctxt, frame);
+  return v;
+}
+
+/* folding */
+
+// a call to a pure native on literals becomes its answer, unless that's an error
+static bool fold(optimizer_t *o, value_t scope, value_t *call) {
+  context_p ctxt = o->ctxt;
+  value_t proc, arg;
+  int index;
+
+  if (!global_value(o, scope, cons_car(ctxt, *call), &index, &proc) ||
+      !is_native_proc(ctxt, proc) ||
+      !native_proc_pure(ctxt, proc)) {
+    return false;
+  }
+
+  int argc = 0;
+  for (value_t cursor = cons_cdr(ctxt, *call); !is_nil(ctxt, cursor); cursor = cons_cdr(ctxt, cursor)) {
+    if (!is_literal(ctxt, cons_car(ctxt, cursor), &arg)) {
+      return false;
+    }
+    argc++;
+  }
+
+  if (!native_proc_accepts(ctxt, proc, argc) || !eval_reserve(ctxt, argc)) {
+    return false;
+  }
+
+  // the args go on the stack, as they would for a call
+  value_stack_t *stack = &ctxt->eval_stack;
+  for (value_t cursor = cons_cdr(ctxt, *call); !is_nil(ctxt, cursor); cursor = cons_cdr(ctxt, cursor)) {
+    is_literal(ctxt, cons_car(ctxt, cursor), &arg);
+    stack->values[stack->size++] = arg;
+  }
+
+  native_proc_fn fn = native_proc_function(ctxt, proc);
+  value_t result = (*fn)(ctxt, argc, stack->values + stack->size - argc);
+
+  stack->size -= argc;
+  if (stack->size < ctxt->eval_stack_clean) {
+    ctxt->eval_stack_clean = stack->size;
+  }
+
+  if (is_error(ctxt, result)) {
+    return false;
+  }
+
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &result);
+
+  assume(o, cons_car(ctxt, *call), proc);
+  *call = make_literal(ctxt, result);
+
+  gc_unroot(ctxt, frame);
+  return true;
+}
+
+// whether v has no effects, assuming the natives it calls if asked to
+static bool is_pure(optimizer_t *o, value_t scope, value_t v, bool assuming) {
+  context_p ctxt = o->ctxt;
+  value_t proc, arg;
+  int index;
+
+  if (is_symbol(ctxt, v) || is_literal(ctxt, v, &arg)) {
+    return true;
+  }
+
+  if (!is_cons(ctxt, v) ||
+      !global_value(o, scope, cons_car(ctxt, v), &index, &proc) ||
+      !is_native_proc(ctxt, proc) ||
+      !native_proc_pure(ctxt, proc)) {
+    return false;
+  }
+
+  // assuming allocates
+  value_t cursor = vnil;
+  bool    pure   = true;
+  int     argc   = 0;
+
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &v);
+  gc_root(ctxt, &scope);
+  gc_root(ctxt, &cursor);
+
+  for (cursor = cons_cdr(ctxt, v); pure && !is_nil(ctxt, cursor); cursor = cons_cdr(ctxt, cursor)) {
+    pure = is_pure(o, scope, cons_car(ctxt, cursor), assuming);
+    argc++;
+  }
+
+  pure = pure && native_proc_accepts(ctxt, proc, argc);
+  if (pure && assuming) {
+    assume(o, cons_car(ctxt, v), proc);
+  }
+
+  gc_unroot(ctxt, frame);
+  return pure;
+}
+
+/* inlining */
+
+// how many atoms are in v, or -1 if it mentions name, lambda or define
+static int inline_size(context_p ctxt, value_t v, value_t name) {
+  if (is_cons(ctxt, v)) {
+    int car = inline_size(ctxt, cons_car(ctxt, v), name);
+    int cdr = inline_size(ctxt, cons_cdr(ctxt, v), name);
+    return car < 0 || cdr < 0 ? -1 : car + cdr;
+  }
+
+  if (equality_exact(ctxt, v, name)      ||
+      equality_exact(ctxt, v, symlambda) ||
+      equality_exact(ctxt, v, symdefine)) {
+    return -1;
+  }
+  return is_nil(ctxt, v) ? 0 : 1;
+}
+
+// whether (define name lambda) can be inlined where name's called
+static bool is_inlinable(context_p ctxt, value_t name, value_t lambda) {
+  value_t params = cons_cadr(ctxt, lambda);
+  value_t body   = cons_cddr(ctxt, lambda);
+
+  for (; is_cons(ctxt, params); params = cons_cdr(ctxt, params)) {
+    value_t param = cons_car(ctxt, params);
+    if (!is_symbol(ctxt, param) || is_keyword(ctxt, param)) {
+      return false;
+    }
+  }
+
+  if (!is_nil(ctxt, params) || !is_cons(ctxt, body) || !is_nil(ctxt, cons_cdr(ctxt, body))) {
+    return false;
+  }
+
+  int size = inline_size(ctxt, cons_car(ctxt, body), name);
+  return size >= 0 && size <= INLINE_SIZE;
+}
+
+// how many times sym is used as a variable in v
+static int uses(context_p ctxt, value_t v, value_t sym) {
+  if (equality_exact(ctxt, v, sym)) {
+    return 1;
+  }
+  if (!is_cons(ctxt, v) || equality_exact(ctxt, cons_car(ctxt, v), symquote)) {
+    return 0;
+  }
+
+  int count = 0;
+  for (; is_cons(ctxt, v); v = cons_cdr(ctxt, v)) {
+    count += uses(ctxt, cons_car(ctxt, v), sym);
+  }
+  return count;
+}
+
+// whether any variable in v but the params is bound in scope
+static bool captured(context_p ctxt, value_t v, value_t params, value_t scope) {
+  if (is_symbol(ctxt, v)) {
+    return !member(ctxt, params, v) && is_local(ctxt, scope, v);
+  }
+  if (!is_cons(ctxt, v) || equality_exact(ctxt, cons_car(ctxt, v), symquote)) {
+    return false;
+  }
+
+  for (; is_cons(ctxt, v); v = cons_cdr(ctxt, v)) {
+    if (captured(ctxt, cons_car(ctxt, v), params, scope)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// v with each param replaced by its arg
+static value_t substitute(context_p ctxt, value_t v, value_t params, value_t args) {
+  if (is_symbol(ctxt, v)) {
+    for (; !is_nil(ctxt, params); params = cons_cdr(ctxt, params), args = cons_cdr(ctxt, args)) {
+      if (equality_exact(ctxt, cons_car(ctxt, params), v)) {
+        return cons_car(ctxt, args);
+      }
+    }
+    return v;
+  }
+
+  if (!is_cons(ctxt, v) || equality_exact(ctxt, cons_car(ctxt, v), symquote)) {
+    return v;
+  }
+
+  value_t head  = vnil;
+  value_t tail  = vnil;
+  value_t field = vnil;
+
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &v);
+  gc_root(ctxt, &params);
+  gc_root(ctxt, &args);
+  gc_root(ctxt, &head);
+  gc_root(ctxt, &tail);
+  gc_root(ctxt, &field);
+
+  for (; is_cons(ctxt, v); v = cons_cdr(ctxt, v)) {
+    field = substitute(ctxt, cons_car(ctxt, v), params, args);
+    field = make_cons(ctxt, field, vnil);
+    if (is_nil(ctxt, head)) {
+      head = field;
+    }
+    else {
+      cons_set_cdr(ctxt, tail, field);
+    }
+    tail = field;
+  }
+
+  gc_unroot(ctxt, frame);
+  return head;
+}
+
+// a call to a global lambda that's known and small becomes its body
+static bool inline_call(optimizer_t *o, value_t scope, value_t *call) {
+  context_p ctxt = o->ctxt;
+  value_t proc, entry;
+  int index;
+
+  if (o->depth >= INLINE_DEPTH ||
+      !global_value(o, scope, cons_car(ctxt, *call), &index, &proc) ||
+      !is_compound_proc(ctxt, proc)) {
+    return false;
+  }
+
+  entry = known_entry(ctxt, index);
+  if (is_nil(ctxt, entry) || is_nil(ctxt, vector_data(ctxt, entry)[1])) {
+    return false;
+  }
+
+  value_t lambda = vector_data(ctxt, entry)[1];
+  value_t params = cons_cadr(ctxt, lambda);
+  value_t body   = cons_caddr(ctxt, lambda);
+  value_t args   = cons_cdr(ctxt, *call);
+  value_t arg    = args;
+  value_t param  = params;
+
+  if (captured(ctxt, body, params, scope)) {
+    return false;
+  }
+
+  // a param's arg may be put in its place as many times as it's used
+  for (; is_cons(ctxt, arg) && is_cons(ctxt, param); arg = cons_cdr(ctxt, arg), param = cons_cdr(ctxt, param)) {
+    value_t v = cons_car(ctxt, arg);
+    value_t literal;
+    if (is_symbol(ctxt, v)) {
+      if (is_keyword(ctxt, v)) {
+        return false;
+      }
+    }
+    else if (!is_literal(ctxt, v, &literal)) {
+      if (uses(ctxt, body, cons_car(ctxt, param)) > 1 || !is_pure(o, scope, v, false)) {
+        return false;
+      }
+    }
+  }
+  if (!is_nil(ctxt, arg) || !is_nil(ctxt, param)) {
+    return false;
+  }
+
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &proc);
+  gc_root(ctxt, &lambda);
+  gc_root(ctxt, &args);
+  gc_root(ctxt, &arg);
+  gc_root(ctxt, &scope);
+
+  // committed; the args keep their natives, and the call its lambda
+  for (arg = args; !is_nil(ctxt, arg); arg = cons_cdr(ctxt, arg)) {
+    is_pure(o, scope, cons_car(ctxt, arg), true);
+  }
+  assume(o, cons_car(ctxt, *call), proc);
+
+  *call = substitute(ctxt, cons_caddr(ctxt, lambda), cons_cadr(ctxt, lambda), args);
+
+  o->depth++;
+  *call = optimize_in(o, *call, scope);
+  o->depth--;
+
+  gc_unroot(ctxt, frame);
+  return true;
+}
+
+/* guards */
+
+// body as one expression
+static value_t body_expression(context_p ctxt, value_t body) {
+  if (is_cons(ctxt, body) && is_nil(ctxt, cons_cdr(ctxt, body))) {
+    return cons_car(ctxt, body);
+  }
+  return make_cons(ctxt, symbegin, body);
+}
+
+// (if test then else)
+static value_t make_if(context_p ctxt, value_t test, value_t then, value_t otherwise) {
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &test);
+  gc_root(ctxt, &then);
+  gc_root(ctxt, &otherwise);
+
+  otherwise = make_cons(ctxt, otherwise, vnil);
+  otherwise = make_cons(ctxt, then, otherwise);
+  otherwise = make_cons(ctxt, test, otherwise);
+  otherwise = make_cons(ctxt, symif, otherwise);
+
+  gc_unroot(ctxt, frame);
+  return otherwise;
+}
+
+// optimized in place of original while everything assumed still holds
+static value_t guard(optimizer_t *o, value_t optimized, value_t original) {
+  context_p ctxt = o->ctxt;
+  value_t test  = vnil;
+  value_t check = vnil;
+  value_t eq    = vnil;
+
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &optimized);
+  gc_root(ctxt, &original);
+  gc_root(ctxt, &test);
+  gc_root(ctxt, &check);
+  gc_root(ctxt, &eq);
+
+  eq = make_literal(ctxt, eq_native(ctxt));
+
+  // ((quote eq?) name (quote value)) for each, and'd together
+  for (value_t cursor = o->assumed; !is_nil(ctxt, cursor); cursor = cons_cdr(ctxt, cursor)) {
+    check = make_literal(ctxt, cons_cdr(ctxt, cons_car(ctxt, cursor)));
+    check = make_cons(ctxt, check, vnil);
+    check = make_cons(ctxt, cons_car(ctxt, cons_car(ctxt, cursor)), check);
+    check = make_cons(ctxt, eq, check);
+    test  = is_nil(ctxt, test) ? check : make_if(ctxt, check, test, vfalse);
+  }
+
+  optimized = body_expression(ctxt, optimized);
+  original  = body_expression(ctxt, original);
+  test      = make_if(ctxt, test, optimized, original);
+  test      = make_cons(ctxt, test, vnil);
+
+  gc_unroot(ctxt, frame);
+  return test;
+}
+
+/* the pass */
+
+// each of list's elements, optimized, in a new list
+static value_t optimize_list(optimizer_t *o, value_t list, value_t scope) {
+  context_p ctxt = o->ctxt;
+  value_t head  = vnil;
+  value_t tail  = vnil;
+  value_t field = vnil;
+
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &list);
+  gc_root(ctxt, &scope);
+  gc_root(ctxt, &head);
+  gc_root(ctxt, &tail);
+  gc_root(ctxt, &field);
+
+  for (; is_cons(ctxt, list); list = cons_cdr(ctxt, list)) {
+    field = optimize_in(o, cons_car(ctxt, list), scope);
+    field = make_cons(ctxt, field, vnil);
+    if (is_nil(ctxt, head)) {
+      head = field;
+    }
+    else {
+      cons_set_cdr(ctxt, tail, field);
+    }
+    tail = field;
+  }
+
+  gc_unroot(ctxt, frame);
+  return head;
+}
+
+// a body, without what only the last expression's value would need
+static value_t optimize_body(optimizer_t *o, value_t body, value_t scope) {
+  context_p ctxt = o->ctxt;
+  value_t literal;
+
+  body = optimize_list(o, body, scope);
+  while (is_cons(ctxt, cons_cdr(ctxt, body)) &&
+         (is_symbol(ctxt, cons_car(ctxt, body)) || is_literal(ctxt, cons_car(ctxt, body), &literal))) {
+    body = cons_cdr(ctxt, body);
+  }
+
+  for (value_t cursor = body; is_cons(ctxt, cons_cdr(ctxt, cursor)); ) {
+    value_t next = cons_cdr(ctxt, cursor);
+    value_t v    = cons_car(ctxt, next);
+    if (is_cons(ctxt, cons_cdr(ctxt, next)) && (is_symbol(ctxt, v) || is_literal(ctxt, v, &literal))) {
+      cons_set_cdr(ctxt, cursor, cons_cdr(ctxt, next));
+    }
+    else {
+      cursor = next;
+    }
+  }
+
+  return body;
+}
+
+static value_t optimize_in(optimizer_t *o, value_t v, value_t scope) {
+  context_p ctxt = o->ctxt;
+  value_t car   = vnil;
+  value_t field = vnil;
+  value_t literal;
+  int params;
+
+  if (!is_cons(ctxt, v)) {
+    return v;
+  }
+
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &v);
+  gc_root(ctxt, &scope);
+  gc_root(ctxt, &car);
+  gc_root(ctxt, &field);
+
+  car = cons_car(ctxt, v);
+
+  // (quote ...)
+  if (equality_exact(ctxt, symquote, car)) {
+    goto done;
+  }
+
+  // (if test then else), and with a literal test, just the branch it picks
+  if (equality_exact(ctxt, symif, car)) {
+    field = optimize_in(o, cons_cadr(ctxt, v), scope);
+    if (is_literal(ctxt, field, &literal)) {
+      v = optimize_in(o, is_truthy(ctxt, literal) ? cons_caddr(ctxt, v) : cons_cadddr(ctxt, v), scope);
+      goto done;
+    }
+
+    car = optimize_list(o, cons_cddr(ctxt, v), scope);
+    car = make_cons(ctxt, field, car);
+    v   = make_cons(ctxt, symif, car);
+    goto done;
+  }
+
+  // (define name value)
+  if (equality_exact(ctxt, symdefine, car)) {
+    field = optimize_list(o, cons_cddr(ctxt, v), scope);
+    field = make_cons(ctxt, cons_cadr(ctxt, v), field);
+    v     = make_cons(ctxt, symdefine, field);
+    goto done;
+  }
+
+  // (begin ...), which needn't be there around one expression
+  if (equality_exact(ctxt, symbegin, car)) {
+    field = optimize_body(o, cons_cdr(ctxt, v), scope);
+    v = is_cons(ctxt, field) && is_nil(ctxt, cons_cdr(ctxt, field))
+      ? cons_car(ctxt, field)
+      : make_cons(ctxt, symbegin, field);
+    goto done;
+  }
+
+  // (lambda (vars) body...), whose body sees its own frame, and is
+  // guarded by what it assumes
+  if (equality_exact(ctxt, symlambda, car)) {
+    value_t outer = o->assumed;
+    gc_root(ctxt, &outer);
+
+    o->assumed = vnil;
+    field = lambda_names(ctxt, v, &params);
+    scope = make_cons(ctxt, field, scope);
+    field = optimize_body(o, cons_cddr(ctxt, v), scope);
+    if (!is_nil(ctxt, o->assumed)) {
+      field = guard(o, field, cons_cddr(ctxt, v));
+    }
+    o->assumed = outer;
+
+    field = make_cons(ctxt, cons_cadr(ctxt, v), field);
+    v     = make_cons(ctxt, symlambda, field);
+    goto done;
+  }
+
+  // otherwise it's an application. only a lambda's body runs more than
+  // once, so a top level one isn't worth assuming anything for
+  v = optimize_list(o, v, scope);
+  if (!is_nil(ctxt, scope) && !fold(o, scope, &v)) {
+    inline_call(o, scope, &v);
+  }
+
+ done:
+  gc_unroot(ctxt, frame);
+  return v;
+}
+
+value_t optimize(context_p ctxt, value_t v) {
+  optimizer_t o = { ctxt, vnil, vnil, 0 };
+  value_t cursor = vnil;
+  value_t entry  = vnil;
+
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &v);
+  gc_root(ctxt, &o.defines);
+  gc_root(ctxt, &o.assumed);
+  gc_root(ctxt, &cursor);
+  gc_root(ctxt, &entry);
+
+  // a global that changes isn't inlined any more; code that already
+  // has it inlined is guarded
+  o.defines = collect_defines(ctxt, v, vnil);
+  for (cursor = o.defines; !is_nil(ctxt, cursor); cursor = cons_cdr(ctxt, cursor)) {
+    entry = known_entry(ctxt, global_index(ctxt, cons_car(ctxt, cursor)));
+    if (!is_nil(ctxt, entry)) {
+      vector_set(ctxt, entry, 1, vnil);
+    }
+  }
+
+  v = optimize_in(&o, v, vnil);
+
+  // (define name (lambda ...)) on its own is what calls to name inline
+  if (is_cons(ctxt, v) &&
+      equality_exact(ctxt, cons_car(ctxt, v), symdefine) &&
+      is_symbol(ctxt, cons_cadr(ctxt, v)) &&
+      is_cons(ctxt, cons_caddr(ctxt, v)) &&
+      equality_exact(ctxt, cons_car(ctxt, cons_caddr(ctxt, v)), symlambda) &&
+      is_inlinable(ctxt, cons_cadr(ctxt, v), cons_caddr(ctxt, v))) {
+    entry = known_add(ctxt, global_index(ctxt, cons_cadr(ctxt, v)));
+    vector_set(ctxt, entry, 1, cons_caddr(ctxt, v));
+  }
+
+  gc_unroot(ctxt, frame);
+  return v;
+}
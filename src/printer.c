@@ -1,5 +1,7 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <float.h>
+#include <inttypes.h>
 #include "scheme.h"
 
 static void print_cons(context_p ctxt, value_t v);
@@ -36,6 +38,23 @@ void print(context_p ctxt, value_t v) {
     return;
   }
 
+  if (is_vector(ctxt, v)) {
+    printf("#(");
+    for (uint32_t i = 0; i < vector_size(ctxt, v); i++) {
+      if (i > 0) {
+        printf(" ");
+      }
+      print(ctxt, vector_get(ctxt, v, i));
+    }
+    printf(")");
+    return;
+  }
+
+  if (is_buffer(ctxt, v)) {
+    printf("#<buffer:%" PRIu64 ">", buffer_length(ctxt, v));
+    return;
+  }
+
   if (is_string(ctxt, v)) {
     int len = string_len(ctxt, v);
     char *ptr = string_ptr(ctxt, v);
@@ -73,7 +92,33 @@ void print(context_p ctxt, value_t v) {
   }
 
   if (is_integer(ctxt, v)) {
-    printf("%d", as_integer(ctxt, v));
+    printf("%" PRId64, as_integer(ctxt, v));
+    return;
+  }
+
+  if (is_numvec(ctxt, v)) {
+    static const char *tags[] = {
+      [NUMVEC_U8]  = "u8",
+      [NUMVEC_S32] = "s32",
+      [NUMVEC_F64] = "f64",
+    };
+
+    printf("#%s(", tags[numvec_type(ctxt, v)]);
+    for (uint32_t i = 0; i < numvec_count(ctxt, v); i++) {
+      if (i > 0) {
+        printf(" ");
+      }
+      print(ctxt, numvec_get(ctxt, v, i));
+    }
+    printf(")");
+    return;
+  }
+
+  if (is_bignum(ctxt, v)) {
+    int len;
+    char *digits = exact_format(ctxt, v, &len);
+    fwrite(digits, 1, len, stdout);
+    free(digits);
     return;
   }
 
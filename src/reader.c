@@ -21,7 +21,7 @@ static bool try_consume_chars(const char* match, int len, FILE *in);
 /* reader */
 
 static value_t read_integer(context_p ctxt, FILE *in);
-static value_t read_double(context_p ctxt, uint32_t whole, FILE *in);
+static value_t read_double(context_p ctxt, double whole, FILE *in);
 static value_t read_slashchar(context_p ctxt, FILE *in);
 static value_t read_macrochar(context_p ctxt, FILE *in);
 static value_t read_pair(context_p ctxt, FILE *in);
@@ -29,6 +29,12 @@ static value_t read_string(context_p ctxt, FILE *in);
 static value_t read_symbol(context_p ctxt, FILE *in);
 /* object *read_objvector(context_p ctxt, FILE *in); */
 
+// skips whitespace and comments; answers whether anything's left to read
+bool read_done(FILE *in) {
+  consume_ws(in);
+  return peek(in) == EOF;
+}
+
 value_t read(context_p ctxt, FILE *in) {
   value_t v;
 
@@ -56,7 +62,7 @@ value_t read(context_p ctxt, FILE *in) {
   else if (c == '"') {
     v = read_string(ctxt, in);
   }
-  else if (isdigit(c)) {
+  else if (isdigit(c) || (c == '-' && isdigit(peek(in)))) {
     ungetc(c, in);
     v = read_integer(ctxt, in);
   }
@@ -141,8 +147,7 @@ value_t read_string(context_p ctxt, FILE *in) {
       exit(1);
     }
   }
-  
-  buffer[len++] = '\0';
+
   return make_string(ctxt, buffer, len);
 }
 
@@ -172,6 +177,14 @@ value_t read_string(context_p ctxt, FILE *in) {
 value_t read_integer(context_p ctxt, FILE *in) {
   char c;
   long num = 0;
+  bool negative = false;
+
+  if ((c = getc(in)) == '-') {
+    negative = true;
+  }
+  else {
+    ungetc(c, in);
+  }
 
   /* consume binary strings */
   if (try_consume_chars("0b", 2, in)) {
@@ -212,25 +225,35 @@ value_t read_integer(context_p ctxt, FILE *in) {
     ungetc(c, in);
   }
 
-  /* consume decimal strings */
+  /* consume decimal strings, as exact integers */
   else {
+    char buffer[BUFFER_MAX];
+    int len = 0;
+    double big = 0;
     while(isdigit(c = getc(in))) {
-      num = (num * 10) + (c - '0');
+      if (len == BUFFER_MAX) {
+        return make_error(ctxt, __LINE__);
+      }
+      buffer[len++] = c;
+      big = (big * 10) + (c - '0');
     }
 
     if (c == '.') {
-      return read_double(ctxt, num, in);
+      value_t v = read_double(ctxt, big, in);
+      return negative ? make_double(ctxt, -as_double(ctxt, v)) : v;
     }
 
     /* unread the non-digit */
     ungetc(c, in);
+
+    return exact_parse(ctxt, buffer, len, negative);
   }
 
-  return make_integer(ctxt, (uint32_t)num);
+  return make_exact(ctxt, negative ? -num : num);
 }
 
 /* whole number part and decimal point have already been read */
-static value_t read_double(context_p ctxt, uint32_t whole, FILE *in) {
+static value_t read_double(context_p ctxt, double whole, FILE *in) {
   double num = whole; // implicit conversion
 
   char   c;
@@ -283,6 +306,9 @@ value_t read_pair(context_p ctxt, FILE *in) {
 
   car_obj = read(ctxt, in);
 
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &car_obj);
+
   consume_ws(in);
   if (try_consume_char('.', in)) {
     /* improper list means explicit cdr, and explicit close paren */
@@ -299,6 +325,7 @@ value_t read_pair(context_p ctxt, FILE *in) {
     cdr_obj = read_pair(ctxt, in);
   }
 
+  gc_unroot(ctxt, frame);
   return make_cons(ctxt, car_obj, cdr_obj);
 }
 
@@ -1,18 +1,113 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "scheme.h"
 
-int main (void) {
-  printf("bootstrap scheme v0.01\nuse ctrl-d to exit.\n");
+static void usage(void) {
+  fprintf(stderr, "usage: scheme [--vm] [--no-jit] [--optimize] [--image file] [--save-image file] [--stack-limit values] [file]\n");
+  exit(1);
+}
+
+int main (int argc, char **argv) {
+  char *image_in  = NULL;
+  char *image_out = NULL;
+  char *source    = NULL;
+  int   stack_max = 0;
+  bool  use_vm    = false;
+  bool  use_jit   = true;
+  bool  use_opt   = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--image") == 0 && i + 1 < argc) {
+      image_in = argv[++i];
+    }
+    else if (strcmp(argv[i], "--save-image") == 0 && i + 1 < argc) {
+      image_out = argv[++i];
+    }
+    else if (strcmp(argv[i], "--stack-limit") == 0 && i + 1 < argc) {
+      stack_max = atoi(argv[++i]);
+      if (stack_max <= 0) {
+        usage();
+      }
+    }
+    else if (strcmp(argv[i], "--vm") == 0) {
+      use_vm = true;
+    }
+    else if (strcmp(argv[i], "--no-jit") == 0) {
+      use_jit = false;
+    }
+    else if (strcmp(argv[i], "--optimize") == 0) {
+      use_opt = true;
+    }
+    else if (argv[i][0] != '-' && source == NULL) {
+      source = argv[i];
+    }
+    else {
+      usage();
+    }
+  }
 
   value_t v;
-  context_p ctxt = alloc_context(4096);
-  ctxt->curr_env = enhance_native_environment(ctxt);
+  context_p ctxt;
+
+  if (image_in) {
+    ctxt = load_image(image_in);
+    if (ctxt == NULL) {
+      fprintf(stderr, "couldn't load image: %s\n", image_in);
+      return 1;
+    }
+  }
+  else {
+    ctxt = alloc_context(4096);
+    ctxt->curr_env = enhance_native_environment(ctxt);
+  }
+
+  if (stack_max) {
+    ctxt->eval_stack_max = stack_max;
+  }
+  if (!use_jit) {
+    ctxt->jit_threshold = 0;
+  }
+
+  // build the world once, and start from it next time; with a file,
+  // the world's whatever it leaves behind
+  if (image_out && !source) {
+    if (!save_image(ctxt, image_out)) {
+      fprintf(stderr, "couldn't save image: %s\n", image_out);
+      return 1;
+    }
+    return 0;
+  }
+
+  // a file runs without the prompts
+  FILE *in = stdin;
+  if (source) {
+    in = fopen(source, "r");
+    if (in == NULL) {
+      fprintf(stderr, "couldn't open: %s\n", source);
+      return 1;
+    }
+  }
+  else {
+    printf("bootstrap scheme v0.01\nuse ctrl-d to exit.\n");
+  }
 
   while (1) {
-    printf("> ");
-    v = read(ctxt, stdin);
-    v = eval(ctxt, v, &ctxt->curr_env);
+    if (!source) {
+      printf("> ");
+    }
+    else if (read_done(in)) {
+      break;
+    }
+    v = read(ctxt, in);
+
+    if (use_opt) {
+      v = optimize(ctxt, v);
+    }
+
+    v = use_vm
+      ? vm_eval(ctxt, v, &ctxt->curr_env)
+      : eval(ctxt, v, &ctxt->curr_env);
 
     if (is_error(ctxt, v)) {
       printf("!!! error: %lx", v.as_uint64);
@@ -24,5 +119,10 @@ int main (void) {
     printf("\n");
   }
 
+  fclose(in);
+  if (image_out && !save_image(ctxt, image_out)) {
+    fprintf(stderr, "couldn't save image: %s\n", image_out);
+    return 1;
+  }
   return 0;
 }
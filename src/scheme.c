@@ -1,6 +1,13 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdlib.h>
+#include <limits.h>
+#include <inttypes.h>
 #include <math.h>
 #include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "scheme.h"
 
 /*
@@ -39,11 +46,15 @@
   a handle is a type + pool_id + offset
   256 possible pool ids, this is more like page tables, than arbitrary makes
 
-  todo: how can we represent an _actual_ 64byte int?
-  definitely need (define flag 0xFFFFFFFFFFFFFFFF)
+  integers bigger than a fixnum are bignums, handles to their limbs in
+  the string pool (see bignum.c); aux is the limb count, with the top
+  bit as the sign
+
+  numeric vectors (f64vector and friends) keep their unboxed elements
+  in the string pool too (see numvec.c); aux is the element type
 
-  we can do the same thing we do for cons pools
-  a 64byte int (or arbitrary int maybe?) is a handle to an integer pool
+  a string's length is in its slot, not its aux, so it isn't limited
+  to 16 bits
 
                 s | 52 bits (exponent bits are elided)
 
@@ -64,13 +75,15 @@
   cons pool     1   1000 pppppppppppppppp oooooooooooooooooooooooooooooooo
   symbol pool   1   1001 pppppppppppppppp oooooooooooooooooooooooooooooooo
   string pool   1   1010 pppppppppppppppp oooooooooooooooooooooooooooooooo
+  bignum        1   1101 snnnnnnnnnnnnnnn oooooooooooooooooooooooooooooooo
+  numeric vec   1   1110 tttttttttttttttt oooooooooooooooooooooooooooooooo
   etc.              0000 = -infinity / NaN
                     1000 = NaNq
   
   BOX           0   tttt aux              data
   boolean       0   0001 0000000000000000 0000000000000000000000000000000b
   character     0   0010 0000000000000000 000000000000000000000000cccccccc
-  integer       0   0011 0000000000000000 dddddddddddddddddddddddddddddddd
+  integer       0   0011 dddddddddddddddd dddddddddddddddddddddddddddddddd
   double        0   0100 0000000000000000 dddddddddddddddddddddddddddddddd
   error         0   1110 0000000000000000 dddddddddddddddddddddddddddddddd
   nil           0   1111 1111111111111111 11111111111111111111111111111111
@@ -82,17 +95,90 @@
   14 box types, max 7 byte payload per type
 
   cons pool:
-    linear array of value_t
+    table of fixed size segments, indexed by the handle's pool id
+    each segment is a linear array of value_t
     car cdr car cdr car cdr
 
-  initialized with all nil (write all ones to the whole block)
+  segments are initialized with all nil (write all ones to the whole block)
+  and never move; growing the pool means adding a segment, so handles
+  stay valid for as long as the cell is live
+
+  one segment is the nursery, where every cell is born. it's bump
+  allocated, and when it fills a minor collection copies the survivors
+  into the tenured segments, then starts the nursery over from the top.
+  tenured cells are reused through cons_free_list (threaded via cdr),
+  which a major collection rebuilds.
+
+  string pool:
+    table of slots, indexed by the handle's offset
+    each slot points at the bytes, which live in growable chunks
+
+  the bytes of a string can move (when a major collection compacts the
+  chunks), its slot can't; so handles never need fixing up. freed slots
+  are threaded through their len field, from string_free_slot.
+
+  a substring is a slice: a slot of its own, pointing into the bytes of
+  its base slot, which marking it keeps alive. compaction only moves the
+  bases, and then repoints their slices from the offset they keep.
+  symbol->string answers the symbol's own slot as a string, since
+  strings are never written to.
+
+  symbol table:
+    open addressed (linear probing), power of two sized
+    each entry is the symbol's hash, and the symbol (nil when empty)
+
+  symbols are interned forever; the table is a root for their slots.
+
+  vectors:
+    a pointer to a header, followed by the elements
+
+  small vectors come out of slabs, one slab per power-of-two size class;
+  free slots are threaded through the header. anything bigger than the
+  largest class is malloc'd on its own, and chained on vector_large.
+  vectors never move.
+
+  buffers:
+    a pointer to a header (store, offset, length), where the store is
+    malloc'd bytes shared by every slice of it
+
+  headers and stores are chained on their own lists, and a major
+  collection frees whichever weren't marked; marking a header marks its
+  store, so a slice keeps the whole of its store alive. neither moves,
+  and neither holds values, so they're never traced.
+
+  native procs:
+    an index into the context's native table, not the function's address
+
+  images:
+    a context can be saved to a file, and mapped back in (privately, so
+    pages are shared until they're written to). handles are offsets, so
+    cons segments and string chunks are used in place; string slots are
+    saved as offsets into their chunk, and the native table as offsets
+    from alloc_context. vectors are copied back out of the image, and
+    the cells that held them are patched through a relocation table.
+    buffers aren't saved; a context holding one can't be saved.
 */
 
 /* fixed known globals; extern'd in header */ 
 
 #define CONS_POOL_SIZE     4096
+#define CONS_SEGMENT_MAX   0xFFFF // 0xFFFF is nil's pool id
 #define STRING_BUFFER_SIZE 8192
-#define SYMBOL_POOL_SIZE  24
+#define STRING_SLOT_FREE   0x1
+#define STRING_SLOT_MARK   0x2
+#define STRING_SLOT_SLICE  0x4
+#define SYMBOL_TABLE_SIZE  256
+#define VECTOR_SLAB_SIZE   16384
+#define VECTOR_LARGE       0xFFFF
+#define VECTOR_USED        0x1
+#define VECTOR_MARK        0x2
+#define VECTOR_REMEMBERED  0x4
+#define VECTOR_FRESH       0x8
+#define BUFFER_MARK        0x1
+#define BUFFER_MIN_GROWTH  (1 << 20)
+#define GC_STEP_WORK       8192
+#define EVAL_STACK_MAX     (1 << 24) // in values, not frames
+#define JIT_THRESHOLD      64        // entries before a template's jitted
 
 value_t symbegin;
 value_t symdefine;
@@ -125,397 +211,2156 @@ inline static hnd_type_t handle_type(value_t v);
 inline static uint16_t   handle_aux(value_t v);
 inline static uint32_t   handle_offset(value_t v);
 
+/* cons segments */
+static int     alloc_cons_segment(context_p ctxt);
+static value_t alloc_tenured(context_p ctxt);
+
+/* string chunks */
+static char*   alloc_string_bytes(context_p ctxt, int len, uint16_t *chunk);
+
+/* symbols */
+static uint64_t symbol_hash(char *name, int len);
+
+/* buffers */
+static bool buffer_pressure(context_p ctxt);
+
+/* vectors */
+static value_t *vector_elements(value_t v);
+
+/* images */
+static bool    in_image(context_p ctxt, void *ptr);
+
+/* gc */
+static bool gc_is_young(context_p ctxt, value_t v);
+static void gc_write_barrier(context_p ctxt, value_t hnd, value_t old, value_t v);
+static void gc_minor(context_p ctxt);
+static void gc_start_major(context_p ctxt);
+static void gc_mark(context_p ctxt, value_t v);
+static void gc_step(context_p ctxt, int budget);
+
 /* pools and the ctxt */
 
-context_p alloc_context(int initial_size) {
+// everything that starts out empty; shared by alloc_context and load_image
+static context_p alloc_empty_context(void) {
   context_p ctxt = malloc(sizeof(context_t));
-
-  /* cons pool - initialized to all nil */
-  int size      = initial_size * 2 * sizeof(value_t);
-  value_t *pool = malloc(size);
-  if (pool == NULL) {
+  if (ctxt == NULL) {
     fprintf(stderr, "out of memory!\n");
     exit(1);
   }
-  memset(pool, 0xFF, size);
-  ctxt->cons_pool_size  = 1;
-  ctxt->cons_pool_limit = initial_size;
-  ctxt->cons_pool_ptr   = pool;
-  ctxt->cons_free_list  = make_handle(ctxt, HND_CONS, 0, 0);
-
-  /* symbol pool */
-  size = SYMBOL_POOL_SIZE * sizeof(value_t);
-  value_t *symbols = malloc(size);
+
+  ctxt->cons_segment_count = 0;
+  ctxt->cons_segment_limit = 0;
+  ctxt->cons_segments      = NULL;
+  ctxt->cons_free_count    = 0;
+  ctxt->cons_free_list     = vnil;
+  ctxt->cons_allocated     = 0;
+
+  /* scan and gray stacks, and the remembered set, grown on demand */
+  ctxt->gc_scan       = (value_stack_t){ 0, 0, NULL };
+  ctxt->gc_gray       = (value_stack_t){ 0, 0, NULL };
+  ctxt->gc_remembered = (value_stack_t){ 0, 0, NULL };
+
+  /* no major collection running */
+  ctxt->gc_phase         = GC_IDLE;
+  ctxt->gc_step_work     = GC_STEP_WORK;
+  ctxt->gc_root_symbol   = 0;
+  ctxt->gc_root_global   = 0;
+  ctxt->gc_root_stack    = 0;
+  ctxt->gc_sweep_segment = 0;
+  ctxt->gc_sweep_index   = 0;
+  ctxt->gc_sweep_limit   = 0;
+  ctxt->gc_sweep_slots   = 0;
+  ctxt->gc_sweep_live    = 0;
+  ctxt->gc_sweep_slab    = NULL;
+  ctxt->gc_sweep_large   = NULL;
+  ctxt->gc_sweep_buffers = NULL;
+  ctxt->gc_sweep_stores  = NULL;
+  ctxt->gc_old_chunk_count = 0;
+  ctxt->gc_old_chunks      = NULL;
+
+  /* statistics */
+  ctxt->gc_cells_live  = 0;
+  ctxt->gc_minor_count = 0;
+  ctxt->gc_major_count = 0;
+  ctxt->gc_pause_total = 0;
+  ctxt->gc_pause_max   = 0;
+
+  /* precise roots */
+  ctxt->gc_root_count = 0;
+  ctxt->gc_root_limit = 0;
+  ctxt->gc_roots      = NULL;
+
+  /* string pool - chunks and slots are added on demand */
+  ctxt->string_chunk_count     = 0;
+  ctxt->string_chunk_limit     = 0;
+  ctxt->string_chunks          = NULL;
+  ctxt->string_slot_count      = 0;
+  ctxt->string_slot_limit      = 0;
+  ctxt->string_slots           = NULL;
+  ctxt->string_free_slot       = -1;
+  ctxt->string_bytes_live      = 0;
+  ctxt->string_bytes_allocated = 0;
+  ctxt->strings_allocated      = 0;
+
+  /* vectors - slabs are added on demand */
+  ctxt->vector_slabs = NULL;
+  ctxt->vector_large = NULL;
+  ctxt->vector_bytes_live      = 0;
+  ctxt->vector_bytes_allocated = 0;
+  ctxt->vectors_allocated      = 0;
+  for (int i = 0; i < VECTOR_CLASSES; i++) {
+    ctxt->vector_free[i] = NULL;
+  }
+
+  /* buffers - each one malloc'd */
+  ctxt->buffers       = NULL;
+  ctxt->buffer_stores = NULL;
+  ctxt->buffer_bytes_live      = 0;
+  ctxt->buffer_bytes_allocated = 0;
+  ctxt->buffers_allocated      = 0;
+
+  /* native table - filled in by make_native_proc */
+  ctxt->native_proc_count = 0;
+  ctxt->native_proc_limit = 0;
+  ctxt->native_procs      = NULL;
+
+  /* globals - a cell each, added as symbols are first referenced */
+  ctxt->globals = (value_stack_t){ 0, 0, NULL };
+
+  /* eval's continuation stack, grown on demand up to the max */
+  ctxt->eval_stack     = (value_stack_t){ 0, 0, NULL };
+  ctxt->eval_stack_max = EVAL_STACK_MAX;
+  ctxt->eval_stack_clean = 0;
+
+  /* the jit's code and table are made when something first gets hot */
+  ctxt->jit           = NULL;
+  ctxt->jit_threshold = JIT_THRESHOLD;
+
+  ctxt->image_base = NULL;
+  ctxt->image_size = 0;
+
+  ctxt->root_env = vnil;
+  ctxt->curr_env = vnil;
+
+  // not saved in images; a loaded one starts out assuming nothing
+  ctxt->known    = vnil;
+
+  return ctxt;
+}
+
+static void intern_known_symbols(context_p ctxt) {
+  symbegin  = make_symbol(ctxt, "begin", 5);
+  symdefine = make_symbol(ctxt, "define", 6);
+  symif     = make_symbol(ctxt, "if", 2);
+  symlambda = make_symbol(ctxt, "lambda", 6);
+  symquote  = make_symbol(ctxt, "quote", 5);
+}
+
+context_p alloc_context(int initial_size) {
+  context_p ctxt = alloc_empty_context();
+
+  /* cons pool - the nursery, and a tenured segment to promote into */
+  ctxt->cons_segment_cells = initial_size;
+  ctxt->cons_nursery       = alloc_cons_segment(ctxt);
+  ctxt->cons_tenured       = alloc_cons_segment(ctxt);
+
+  /* symbol table - initialized to all nil */
+  int size = SYMBOL_TABLE_SIZE * sizeof(symbol_entry_t);
+  symbol_entry_t *symbols = malloc(size);
   if (symbols == NULL) {
     fprintf(stderr, "out of memory\n");
     exit(1);
   }
   memset(symbols, 0xFF, size);
-  ctxt->symbol_pool_size = SYMBOL_POOL_SIZE;
-  ctxt->symbol_pool_ptr  = symbols;
-
-  /* string buffer */
-  size = initial_size;
-  char *buffer = malloc(size);
-  if (buffer == NULL) {
-    fprintf(stderr, "out of memory!\n");
-    exit(1);
-  }
-  memset(buffer, 0x00, size);
-  ctxt->string_buffer_limit  = initial_size;
-  ctxt->string_buffer_offset = 0;
-  ctxt->string_buffer_ptr    = buffer;
+  ctxt->symbol_table_size  = 0;
+  ctxt->symbol_table_limit = SYMBOL_TABLE_SIZE;
+  ctxt->symbol_table       = symbols;
 
   /* environments */
   ctxt->root_env = make_cons(ctxt, vnil, vnil);
   ctxt->curr_env = make_cons(ctxt, vnil, vnil);
 
   /* initialize known symbols */
-  symbegin  = make_symbol(ctxt, "begin", 5);
-  symdefine = make_symbol(ctxt, "define", 6);
-  symif     = make_symbol(ctxt, "if", 2);
-  symlambda = make_symbol(ctxt, "lambda", 6);
-  symquote  = make_symbol(ctxt, "quote", 5);
+  intern_known_symbols(ctxt);
 
   return ctxt;
 }
 
-static value_t alloc_cons(context_p ctxt, value_t car, value_t cdr) {
-  int index = ctxt->cons_pool_size;
-  
-  ctxt->cons_pool_ptr[index]     = car;
-  ctxt->cons_pool_ptr[index + 1] = cdr;
-  ctxt->cons_pool_size          += 2;
-
-  return make_handle(ctxt, HND_CONS, 0, index);
-}
+static int alloc_cons_segment(context_p ctxt) {
+  if (ctxt->cons_segment_count == CONS_SEGMENT_MAX) {
+    fprintf(stderr, "out of memory!\n");
+    exit(1);
+  }
 
-value_t environment_get(context_p ctxt, value_t env, value_t key) {
-  value_t cursor = env;
+  // the table can move, the segments it points at can't
+  if (ctxt->cons_segment_count == ctxt->cons_segment_limit) {
+    int limit = ctxt->cons_segment_limit ? ctxt->cons_segment_limit * 2 : 8;
+    cons_segment_t *table = realloc(ctxt->cons_segments, limit * sizeof(cons_segment_t));
+    if (table == NULL) {
+      fprintf(stderr, "out of memory!\n");
+      exit(1);
+    }
 
-  while(1) {
-    if (is_nil(ctxt, cursor)) {
-      return vnil;
-    } 
+    ctxt->cons_segment_limit = limit;
+    ctxt->cons_segments      = table;
+  }
 
-    if (equality_exact(ctxt, cons_caar(ctxt, cursor), key)) {
-      return cons_cdar(ctxt, cursor);
-    }
+  int cells  = ctxt->cons_segment_cells;
+  int size   = cells * 2 * sizeof(value_t);
+  value_t *pool = malloc(size);
+  if (pool == NULL) {
+    fprintf(stderr, "out of memory!\n");
+    exit(1);
+  }
+  memset(pool, 0xFF, size);
 
-    cursor = cons_cdr(ctxt, cursor);
+  /* one mark bit, and one remembered bit, per cell */
+  size = ((cells + 63) / 64) * sizeof(uint64_t);
+  uint64_t *marks = malloc(size * 2);
+  if (marks == NULL) {
+    fprintf(stderr, "out of memory!\n");
+    exit(1);
   }
-}
+  memset(marks, 0x00, size * 2);
 
-value_t environment_set(context_p ctxt, value_t env, value_t key, value_t value) {
-  value_t newpair = make_cons(ctxt, key, value);
-  return make_cons(ctxt, newpair, env);
+  cons_segment_t *seg = &ctxt->cons_segments[ctxt->cons_segment_count];
+  seg->size       = 0;
+  seg->cells      = pool;
+  seg->marks      = marks;
+  seg->remembered = marks + (size / sizeof(uint64_t));
+
+  return ctxt->cons_segment_count++;
 }
 
-/* comparisons */
+/* per-cell bitmaps, indexed by the cell's offset in its segment */
 
-/** exact value equality */
-inline bool equality_exact(context_p, value_t a, value_t b) {
-  return a.as_uint64 == b.as_uint64;
+inline static bool cell_bit(uint64_t *bits, uint32_t index) {
+  uint32_t cell = index >> 1;
+  return bits[cell >> 6] & (1ULL << (cell & 63));
 }
 
-bool equality_string(context_p ctxt, value_t a, value_t b) {
-  bool a_typed = is_string(ctxt, a) || is_symbol(ctxt, a);
-  bool b_typed = is_string(ctxt, b) || is_symbol(ctxt, b);
-  
-  if (!a_typed || !b_typed) { return false; }
-  if (string_len(ctxt, a) != string_len(ctxt, b)) { return false; }
+inline static void set_cell_bit(uint64_t *bits, uint32_t index) {
+  uint32_t cell = index >> 1;
+  bits[cell >> 6] |= (1ULL << (cell & 63));
+}
 
-  return strncmp(string_ptr(ctxt, a), string_ptr(ctxt, b), string_len(ctxt, a)) == 0;
+inline static void clear_cell_bit(uint64_t *bits, uint32_t index) {
+  uint32_t cell = index >> 1;
+  bits[cell >> 6] &= ~(1ULL << (cell & 63));
 }
 
-bool equality_cstring(context_p ctxt, value_t a, char *value, uint32_t len) {
-  bool a_typed = is_string(ctxt, a) || is_symbol(ctxt, a);
-  if (a_typed && (string_len(ctxt, a) == len)) {
-    return strncmp(string_ptr(ctxt, a), value, len) == 0;
+inline static value_t* gc_cell(context_p ctxt, value_t hnd) {
+  return ctxt->cons_segments[handle_aux(hnd)].cells + handle_offset(hnd);
+}
+
+// cells are born in the nursery
+static value_t alloc_cons(context_p ctxt, value_t car, value_t cdr) {
+  cons_segment_t *nursery = &ctxt->cons_segments[ctxt->cons_nursery];
+
+  if (nursery->size == ctxt->cons_segment_cells * 2) {
+    int frame = gc_root_frame(ctxt);
+    gc_root(ctxt, &car);
+    gc_root(ctxt, &cdr);
+    gc_minor(ctxt);
+    gc_unroot(ctxt, frame);
+
+    nursery = &ctxt->cons_segments[ctxt->cons_nursery];
   }
 
-  return false;
-}
+  int index = nursery->size;
+  nursery->size += 2;
+  ctxt->cons_allocated++;
 
-inline bool is_boolean(context_p ctxt, value_t v) {
-  return is_vtruth(ctxt, v) || is_vfalse(ctxt, v);
-}
+  nursery->cells[index]     = car;
+  nursery->cells[index + 1] = cdr;
 
-/** literal equality */
-inline bool is_vtruth(context_p ctxt, value_t v) {
-  return equality_exact(ctxt, v, vtrue);
+  return make_handle(ctxt, HND_CONS, ctxt->cons_nursery, index);
 }
 
-/** literal equality */
-inline bool is_vfalse(context_p ctxt, value_t v) {
-  return equality_exact(ctxt, v, vfalse);
-}
+// cells that survive the nursery; never triggers a collection, since
+// it's only called from one. if tenured space runs dry, it grows
+static value_t alloc_tenured(context_p ctxt) {
+  value_t hnd;
 
-/** scheme-like predicate: everything but #f is truthy */
-inline bool is_truthy(context_p ctxt, value_t v) {
-  return !is_vfalse(ctxt, v);
-}
+  if (!is_nil(ctxt, ctxt->cons_free_list)) {
+    hnd = ctxt->cons_free_list;
 
-/** scheme-like predicate: only #f is falsey */
-inline bool is_falsey(context_p ctxt, value_t v) {
-  return is_vfalse(ctxt, v);
-}
+    ctxt->cons_free_list = gc_cell(ctxt, hnd)[1];
+    ctxt->cons_free_count--;
+  }
+  else {
+    if (ctxt->cons_segments[ctxt->cons_tenured].size == ctxt->cons_segment_cells * 2) {
+      ctxt->cons_tenured = alloc_cons_segment(ctxt);
+    }
 
-/* doubles */
+    cons_segment_t *seg = &ctxt->cons_segments[ctxt->cons_tenured];
+    int index = seg->size;
+    seg->size += 2;
 
-#define NOT_DOUBLE_MASK 0x7FF0000000000000
-#define NOT_NANINF_MASK 0x0009000000000000
+    hnd = make_handle(ctxt, HND_CONS, ctxt->cons_tenured, index);
+  }
 
-inline value_t make_double(context_p, double v) {
-  return (value_t)v;
-}
+  // promoted while a major collection is running, so born marked
+  if (ctxt->gc_phase != GC_IDLE) {
+    set_cell_bit(ctxt->cons_segments[handle_aux(hnd)].marks, handle_offset(hnd));
+  }
 
-inline double as_double(context_p, value_t v) {
-  return v.as_double;
+  return hnd;
 }
 
-inline bool is_double(context_p, value_t v) {
-  uint64_t u = v.as_uint64;
-  return (u & NOT_DOUBLE_MASK) != NOT_DOUBLE_MASK;
+// cells we can still promote into without growing
+static int tenured_room(context_p ctxt) {
+  cons_segment_t *seg = &ctxt->cons_segments[ctxt->cons_tenured];
+  return ctxt->cons_free_count + (ctxt->cons_segment_cells * 2 - seg->size) / 2;
 }
 
-inline bool is_nan(context_p ctxt, value_t v) {
-  return equality_exact(ctxt, v, vnan) || equality_exact(ctxt, v, vnanq);
-}
+/* garbage collection */
 
-inline bool is_inf(context_p ctxt, value_t v) {
-  return equality_exact(ctxt, v, vpinf) || equality_exact(ctxt, v, vninf);
-}
+/*
+  generational: a copying nursery in front of a non-moving, mark-sweep
+  tenured space
 
-/* integers */
+  roots are the two envs, the symbol table, and the root stack: the
+  address of every c local that holds a value across an allocation
+  (see gc_root). the collector rewrites those slots when it moves a
+  cell, so it never has to guess at what the c stack holds.
 
-inline value_t make_integer(context_p, uint32_t value) {
-  return make_boxed(BOX_INTEGER, 0, (box_data_t)value);
-}
+  minor collections copy the live young cells out, starting from the
+  roots (symbols aren't cells, so the table doesn't count) and the
+  remembered set: tenured cells and vectors that had a young value
+  stored into them (see gc_write_barrier). vectors are never young, and
+  only a major collection frees them. tenured cells never move.
 
-inline bool is_integer(context_p, value_t v) {
-  return is_boxed(BOX_INTEGER, v);
-}
-  
-inline uint32_t as_integer(context_p, value_t v) {
-  return boxed_data(v).as_uint32;
-}
-/* floats */
+  major collections are incremental, see below.
 
-inline value_t make_float(context_p, float value) {
-  return make_boxed(BOX_FLOAT, 0, (box_data_t)value);
-}
+  compound procs are reshaped cons handles, so they're traced the same.
+*/
 
-inline bool is_float(context_p, value_t v) {
-  return is_boxed(BOX_FLOAT, v);
+static uint64_t gc_clock(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
 }
 
-inline float as_float(context_p, value_t v) {
-  return boxed_data(v).as_float;
+static void gc_pause(context_p ctxt, uint64_t start) {
+  uint64_t pause = gc_clock() - start;
+
+  ctxt->gc_pause_total += pause;
+  if (pause > ctxt->gc_pause_max) {
+    ctxt->gc_pause_max = pause;
+  }
 }
 
-/* chars */
+static void gc_push(value_stack_t *stack, value_t v) {
+  if (stack->size == stack->limit) {
+    int limit = stack->limit ? stack->limit * 2 : 256;
+    value_t *values = realloc(stack->values, limit * sizeof(value_t));
+    if (values == NULL) {
+      fprintf(stderr, "out of memory!\n");
+      exit(1);
+    }
 
-inline value_t make_character(context_p, char value) {
-  return make_boxed(BOX_CHARACTER, 0, (box_data_t)(uint32_t)value);
-}
+    stack->limit  = limit;
+    stack->values = values;
+  }
 
-inline bool is_character(context_p, value_t v) {
-  return is_boxed(BOX_CHARACTER, v);
+  stack->values[stack->size++] = v;
 }
 
-inline char as_character(context_p, value_t v) {
-  return (char)boxed_data(v).as_uint32;
+inline static bool gc_is_cell(context_p, value_t v) {
+  return is_handle(HND_CONS, v) || is_handle(HND_PROC, v);
 }
 
-inline value_t make_error(context_p, uint32_t code) {
-  return make_boxed(BOX_ERROR, 0, (box_data_t)code);
+inline static bool gc_is_young(context_p ctxt, value_t v) {
+  return gc_is_cell(ctxt, v) && handle_aux(v) == ctxt->cons_nursery;
 }
 
-inline bool is_error(context_p, value_t v) {
-  return is_boxed(BOX_ERROR, v);
-}
+/* precise roots */
 
-/* strings */
+int gc_root_frame(context_p ctxt) {
+  return ctxt->gc_root_count;
+}
 
-value_t make_string(context_p ctxt, char *str, int len) {
-  int offset = ctxt->string_buffer_offset;
-  memcpy(ctxt->string_buffer_ptr + offset, str, len);
+void gc_root(context_p ctxt, value_t *slot) {
+  if (ctxt->gc_root_count == ctxt->gc_root_limit) {
+    int limit = ctxt->gc_root_limit ? ctxt->gc_root_limit * 2 : 256;
+    value_t **roots = realloc(ctxt->gc_roots, limit * sizeof(value_t*));
+    if (roots == NULL) {
+      fprintf(stderr, "out of memory!\n");
+      exit(1);
+    }
 
-  // should already be the case, but ensure
-  ctxt->string_buffer_ptr[offset + len] = '\0';
-  ctxt->string_buffer_offset += len;
-  
-  // TODO: error handling
-  return make_handle(ctxt, HND_STRING, len, offset);
-}
+    ctxt->gc_root_limit = limit;
+    ctxt->gc_roots      = roots;
+  }
 
-inline bool is_string(context_p, value_t v) {
-  return is_handle(HND_STRING, v);
+  ctxt->gc_roots[ctxt->gc_root_count++] = slot;
 }
 
-inline char* string_ptr(context_p ctxt, value_t v) {
-  int offset = handle_offset(v);
-  return ctxt->string_buffer_ptr + offset;
+// drop every root registered since the frame was taken
+void gc_unroot(context_p ctxt, int frame) {
+  ctxt->gc_root_count = frame;
 }
 
-inline uint32_t string_len(context_p, value_t v) {
-  return handle_aux(v);
-}
+// tenured cells (and vectors) holding young values are roots for the
+// next minor collection; and while marking, both what a store overwrites
+// and what it stores are marked (see the major collection, below)
+inline static void gc_write_barrier(context_p ctxt, value_t hnd, value_t old, value_t v) {
+  if (ctxt->gc_phase == GC_MARKING) {
+    gc_mark(ctxt, old);
+    gc_mark(ctxt, v);
+  }
 
-/* symbols */
+  if (!gc_is_young(ctxt, v) || gc_is_young(ctxt, hnd)) {
+    return;
+  }
 
-static int symbol_hash(char *name, unsigned int len) {
-  unsigned int i;
-  unsigned int hash = 0;
-  for (i = 0; i < len; i++) {
-    hash = (hash << 5) + name[i];
+  if (is_pointer(PTR_VECTOR, hnd)) {
+    vector_header_t *hdr = pointer_addr(hnd);
+    if (hdr->flags & VECTOR_REMEMBERED) {
+      return;
+    }
+    hdr->flags |= VECTOR_REMEMBERED;
+  }
+  else {
+    uint64_t *remembered = ctxt->cons_segments[handle_aux(hnd)].remembered;
+    if (cell_bit(remembered, handle_offset(hnd))) {
+      return;
+    }
+    set_cell_bit(remembered, handle_offset(hnd));
   }
 
-  return hash % SYMBOL_POOL_SIZE;
+  gc_push(&ctxt->gc_remembered, hnd);
 }
 
-value_t make_symbol(context_p ctxt, char* name, int len) {
-  value_t pair, key;
-  int hash = symbol_hash(name, len);
+// the values held by a cell or a vector, for the collector to visit
+static value_t* gc_fields(context_p ctxt, value_t v, uint32_t *count) {
+  if (is_pointer(PTR_VECTOR, v)) {
+    *count = ((vector_header_t*)pointer_addr(v))->size;
+    return vector_elements(v);
+  }
 
-  pair = ctxt->symbol_pool_ptr[hash];
+  *count = 2;
+  return gc_cell(ctxt, v);
+}
 
-  // no list at the hash
-  if (is_nil(ctxt, pair)) {
-    key  = make_string(ctxt, name, len);
-    key  = reshape_handle(ctxt, key, HND_SYMBOL);
+/* minor collection */
 
-    ctxt->symbol_pool_ptr[hash] = make_cons(ctxt, key, vnil);
-    return key;
+// answers where a young cell lives now, promoting it on the first visit;
+// the nursery mark bits say which cells have already been forwarded
+static value_t gc_forward(context_p ctxt, value_t v) {
+  if (!gc_is_young(ctxt, v)) {
+    return v;
   }
 
-  while (1) {
-    value_t car = cons_car(ctxt, pair);
-    value_t cdr = cons_cdr(ctxt, pair);
-    
-    // found it
-    if (is_symbol(ctxt, car) &&
-        equality_cstring(ctxt, car, name, len)) {
-      return car;
-    }
+  cons_segment_t *nursery = &ctxt->cons_segments[ctxt->cons_nursery];
+  uint64_t *forwarded = nursery->marks;
+  value_t  *from      = nursery->cells + handle_offset(v);
 
-    // not in the list, add to the bottom
-    if (is_nil(ctxt, cdr)) {
-      key = make_string(ctxt, name, len);
-      key = reshape_handle(ctxt, key, HND_SYMBOL);
-      
-      car = make_cons(ctxt, key, vnil);
-      cons_set_cdr(ctxt, pair, car);
+  if (!cell_bit(forwarded, handle_offset(v))) {
+    value_t  to   = alloc_tenured(ctxt);
+    value_t *dest = gc_cell(ctxt, to);
 
-      return key;
-    }
+    dest[0] = from[0];
+    dest[1] = from[1];
+    from[0] = to;
+    set_cell_bit(forwarded, handle_offset(v));
 
-    // keep looking
-    pair = cons_cdr(ctxt, pair);
+    gc_push(&ctxt->gc_scan, to);
   }
-}
 
-inline bool is_symbol(context_p, value_t v) {
-  return is_handle(HND_SYMBOL, v);
+  return reshape_handle(ctxt, from[0], handle_type(v));
 }
 
-/* errors */
+static void gc_minor(context_p ctxt) {
+  uint64_t start = gc_clock();
+  int cells = ctxt->cons_segment_cells;
+  ctxt->gc_minor_count++;
 
-/* cons cells */
+  ctxt->root_env = gc_forward(ctxt, ctxt->root_env);
+  ctxt->curr_env = gc_forward(ctxt, ctxt->curr_env);
+  ctxt->known    = gc_forward(ctxt, ctxt->known);
+  for (int i = 0; i < ctxt->globals.size; i++) {
+    ctxt->globals.values[i] = gc_forward(ctxt, ctxt->globals.values[i]);
+  }
+  for (int i = 0; i < ctxt->gc_root_count; i++) {
+    *ctxt->gc_roots[i] = gc_forward(ctxt, *ctxt->gc_roots[i]);
+  }
+  // below the low water mark, the eval stack was forwarded last time;
+  // above it are stores marking hasn't seen
+  bool marking = ctxt->gc_phase == GC_MARKING;
+  for (int i = ctxt->eval_stack_clean; i < ctxt->eval_stack.size; i++) {
+    ctxt->eval_stack.values[i] = gc_forward(ctxt, ctxt->eval_stack.values[i]);
+    if (marking) {
+      gc_mark(ctxt, ctxt->eval_stack.values[i]);
+    }
+  }
+  ctxt->eval_stack_clean = ctxt->eval_stack.size;
 
-inline value_t make_cons(context_p ctxt, value_t car, value_t cdr) {
-  return alloc_cons(ctxt, car, cdr);
-}
+  for (int i = 0; i < ctxt->gc_remembered.size; i++) {
+    value_t hnd = ctxt->gc_remembered.values[i];
+    if (is_pointer(PTR_VECTOR, hnd)) {
+      ((vector_header_t*)pointer_addr(hnd))->flags &= ~VECTOR_REMEMBERED;
+    }
+    else {
+      clear_cell_bit(ctxt->cons_segments[handle_aux(hnd)].remembered, handle_offset(hnd));
+    }
+    gc_push(&ctxt->gc_scan, hnd);
+  }
+  ctxt->gc_remembered.size = 0;
+
+  // everything on the stack is tenured now; fix up its fields. cells
+  // promoted while marking are born marked, so what they hold is marked
+  // here, since they'll never be traced
+  while (ctxt->gc_scan.size > 0) {
+    uint32_t count;
+    value_t *fields = gc_fields(ctxt, ctxt->gc_scan.values[--ctxt->gc_scan.size], &count);
+
+    for (uint32_t i = 0; i < count; i++) {
+      fields[i] = gc_forward(ctxt, fields[i]);
+      if (marking) {
+        gc_mark(ctxt, fields[i]);
+      }
+    }
+  }
 
-inline bool is_cons(context_p, value_t v) {
-  return is_handle(HND_CONS, v);
-}
+  // whatever's left in the nursery is dead
+  cons_segment_t *nursery = &ctxt->cons_segments[ctxt->cons_nursery];
+  memset(nursery->marks, 0x00, ((cells + 63) / 64) * sizeof(uint64_t));
+  nursery->size = 0;
+
+  // a full nursery might not fit in what's left, start collecting tenured
+  // space; strings and vectors are only freed by a major, so they get a say
+  int strings = ctxt->string_bytes_live > STRING_BUFFER_SIZE * 4
+    ? ctxt->string_bytes_live
+    : STRING_BUFFER_SIZE * 4;
+  int vectors = ctxt->vector_bytes_live > VECTOR_SLAB_SIZE * 4
+    ? ctxt->vector_bytes_live
+    : VECTOR_SLAB_SIZE * 4;
+
+  if (ctxt->gc_phase == GC_IDLE &&
+      (tenured_room(ctxt) < cells ||
+       ctxt->string_bytes_allocated > strings ||
+       ctxt->vector_bytes_allocated > vectors ||
+       buffer_pressure(ctxt))) {
+    gc_start_major(ctxt);
+  }
 
-inline bool is_atom(context_p ctxt, value_t v) {
-  return !is_cons(ctxt, v);
-}
+  if (ctxt->gc_phase != GC_IDLE) {
+    gc_step(ctxt, ctxt->gc_step_work);
+  }
 
-inline bool is_nil(context_p ctxt, value_t v) {
-  return equality_exact(ctxt, v, vnil);
+  gc_pause(ctxt, start);
 }
 
-inline value_t cons_car(context_p ctxt, value_t hnd) {
-  int index = handle_offset(hnd);
-  return ctxt->cons_pool_ptr[index];
-}
+/* major collection */
 
-inline value_t cons_cdr(context_p ctxt, value_t hnd) {
-  int index = handle_offset(hnd);
-  return ctxt->cons_pool_ptr[index + 1];
-}
+/*
+  incremental: marking and sweeping run a slice at a time, at most
+  gc_step_work units (a root or a traced field looked at, or a cell,
+  slot or header swept) per step. a step runs after every minor
+  collection, and whenever vectors or buffers are being allocated fast
+  enough to need one. a cycle only has so much to do, whatever the
+  mutator does meanwhile: new objects are never traced, and a sweep only
+  covers what there was when it began.
+
+  a cycle only starts right after a minor collection, when everything
+  live is tenured. the small roots (the envs, known and the root stack)
+  are marked then; the symbol table, the globals and the eval stack are
+  scanned a slice at a time, alongside tracing. so that the mutator
+  can't hide anything from the marker meanwhile:
+
+  - promoted cells and new vectors are born marked, and whatever they
+    hold is marked as it's put there (by the minor, or make_vector)
+  - new strings, symbols and buffers are born marked too
+  - the write barrier marks both what a store overwrites and what it
+    stores, and global_set marks what it stores
+  - every minor marks what's been written onto the eval stack since the
+    last one (everything above eval_stack_clean)
+
+  young cells are never marked; the nursery belongs to the minor
+  collector. so marking only finishes with the nursery empty, once the
+  big roots have been scanned and nothing's gray, after one last look at
+  the small roots, and whatever's been written onto the eval stack.
+
+  then everything's swept, a kind at a time: tenured cells, vectors,
+  buffers and strings. the cell free list starts over, and is rebuilt
+  by the sweep; large vectors and buffers are set aside for it. strings
+  and slab vectors allocated before their sweep's done are born marked,
+  or fresh (which the sweep spares, but isn't a mark, so they're still
+  traced next time), since they might be in front of it. if more than
+  half the string chunk space turns out dead, live strings are copied
+  into fresh chunks a slot at a time, and then their slices repointed.
+*/
 
-inline void cons_set_car(context_p ctxt, value_t hnd, value_t v) {
-  int index = handle_offset(hnd);
-  ctxt->cons_pool_ptr[index] = v;
+// set the mark bit, and answer if it was already set
+inline static bool gc_test_and_mark(context_p ctxt, value_t v) {
+  uint64_t *marks = ctxt->cons_segments[handle_aux(v)].marks;
+  bool marked = cell_bit(marks, handle_offset(v));
+
+  set_cell_bit(marks, handle_offset(v));
+  return marked;
 }
 
-inline void cons_set_cdr(context_p ctxt, value_t hnd, value_t v) {
-  int index = handle_offset(hnd);
-  ctxt->cons_pool_ptr[index + 1] = v;
+// strings and symbols have nothing to trace, just mark their slot,
+// and a slice's base
+static void gc_mark_string(context_p ctxt, value_t v) {
+  uint32_t index = handle_offset(v);
+  if (index >= (uint32_t)ctxt->string_slot_count) {
+    return;
+  }
+
+  string_slot_t *slot = &ctxt->string_slots[index];
+  if (!(slot->flags & STRING_SLOT_FREE)) {
+    slot->flags |= STRING_SLOT_MARK;
+    ctxt->string_slots[slot->base].flags |= STRING_SLOT_MARK;
+  }
 }
 
-/* buffers */
+static void gc_mark(context_p ctxt, value_t v) {
+  if (is_handle(HND_STRING, v) || is_handle(HND_SYMBOL, v) ||
+      is_handle(HND_BIGNUM, v) || is_handle(HND_NUMVEC, v)) {
+    gc_mark_string(ctxt, v);
+    return;
+  }
 
-/* vectors */
+  if (is_pointer(PTR_VECTOR, v)) {
+    vector_header_t *hdr = pointer_addr(v);
+    if (!(hdr->flags & VECTOR_MARK)) {
+      hdr->flags |= VECTOR_MARK;
+      gc_push(&ctxt->gc_gray, v);
+    }
+    return;
+  }
 
-value_t make_vector(context_p ctxt, int size, value_t fill) {
-  size += 1; // account for size header
-  value_t *vecptr = malloc((size + 1) * sizeof(value_t));
-  if (vecptr == NULL) {
-    fprintf(stderr, "out of memory!\n");
-    exit(1);
+  // nothing to trace in a buffer
+  if (is_pointer(PTR_BUFFER, v)) {
+    buffer_header_t *hdr = pointer_addr(v);
+    hdr->flags        |= BUFFER_MARK;
+    hdr->store->flags |= BUFFER_MARK;
+    return;
   }
 
-  vecptr[0] = make_integer(ctxt, size);
-  for (; size > 0; size--) {
-    vecptr[size + 1] = fill;
+  if (!gc_is_cell(ctxt, v) || gc_is_young(ctxt, v) || gc_test_and_mark(ctxt, v)) {
+    return;
   }
 
-  return make_pointer(ctxt, PTR_VECTOR, vecptr);
+  gc_push(&ctxt->gc_gray, v);
 }
 
-inline bool is_vector(context_p, value_t v) {
-  return is_pointer(PTR_VECTOR, v);
+// the envs, known and the root stack; there's never much to them
+static void gc_mark_roots(context_p ctxt) {
+  gc_mark(ctxt, ctxt->root_env);
+  gc_mark(ctxt, ctxt->curr_env);
+  gc_mark(ctxt, ctxt->known);
+  for (int i = 0; i < ctxt->gc_root_count; i++) {
+    gc_mark(ctxt, *ctxt->gc_roots[i]);
+  }
 }
 
-inline value_t vector_get(context_p, value_t v, int index) {
-  // todo: bounds check
-  return ((value_t*)pointer_addr(v))[index];
-}
+// the symbol table, the globals and the eval stack, picking up where the
+// last step stopped; answers the budget that's left. a table that grew
+// was rehashed, so it's scanned again from the top (see grow_symbol_table)
+static int gc_scan_roots(context_p ctxt, int budget) {
+  for (; budget > 0 && ctxt->gc_root_symbol < ctxt->symbol_table_limit; budget--) {
+    gc_mark(ctxt, ctxt->symbol_table[ctxt->gc_root_symbol++].symbol);
+  }
+  for (; budget > 0 && ctxt->gc_root_global < ctxt->globals.size; budget--) {
+    gc_mark(ctxt, ctxt->globals.values[ctxt->gc_root_global++]);
+  }
+  for (; budget > 0 && ctxt->gc_root_stack < ctxt->eval_stack.size; budget--) {
+    gc_mark(ctxt, ctxt->eval_stack.values[ctxt->gc_root_stack++]);
+  }
 
-inline void vector_set(context_p, value_t v, int index, value_t val) {
-  // todo: bounds check
-  ((value_t*)pointer_addr(v))[index] = val;
+  return budget;
 }
 
-inline value_t vector_size(context_p, value_t v) {
-  return ((value_t*)pointer_addr(v))[0];
-}
+// trace gray values until the budget runs out; answers what's left of it
+static int gc_trace(context_p ctxt, int budget) {
+  while (budget > 0 && ctxt->gc_gray.size > 0) {
+    uint32_t count;
+    value_t *fields = gc_fields(ctxt, ctxt->gc_gray.values[--ctxt->gc_gray.size], &count);
 
-/* procs */
+    for (uint32_t i = 0; i < count; i++) {
+      gc_mark(ctxt, fields[i]);
+    }
+    budget -= count;
+  }
+
+  return budget;
+}
+
+// answers whether marking's finished, taking that last look if it can be
+static bool gc_marked(context_p ctxt, int *budget) {
+  if (ctxt->gc_root_symbol < ctxt->symbol_table_limit ||
+      ctxt->gc_root_global < ctxt->globals.size ||
+      ctxt->gc_root_stack  < ctxt->eval_stack.size ||
+      ctxt->gc_gray.size > 0 ||
+      ctxt->cons_segments[ctxt->cons_nursery].size > 0) {
+    return false;
+  }
+
+  gc_mark_roots(ctxt);
+  for (int i = ctxt->eval_stack_clean; i < ctxt->eval_stack.size; i++) {
+    gc_mark(ctxt, ctxt->eval_stack.values[i]);
+  }
+
+  *budget = gc_trace(ctxt, *budget);
+  return ctxt->gc_gray.size == 0;
+}
+
+// only valid right after a minor collection, when the nursery is empty
+static void gc_start_major(context_p ctxt) {
+  int cells = ctxt->cons_segment_cells;
+  for (int i = 0; i < ctxt->cons_segment_count; i++) {
+    memset(ctxt->cons_segments[i].marks, 0x00, ((cells + 63) / 64) * sizeof(uint64_t));
+  }
+
+  ctxt->gc_phase       = GC_MARKING;
+  ctxt->gc_root_symbol = 0;
+  ctxt->gc_root_global = 0;
+  ctxt->gc_root_stack  = 0;
+
+  gc_mark_roots(ctxt);
+}
+
+// what's to be swept is whatever there is now
+static void gc_start_sweep(context_p ctxt) {
+  // while the marks say what's live
+  jit_sweep(ctxt);
+
+  ctxt->gc_phase         = GC_SWEEPING;
+  ctxt->gc_sweep_segment = 0;
+  ctxt->gc_sweep_index   = 0;
+  ctxt->gc_sweep_limit   = ctxt->cons_segment_count;
+  ctxt->gc_sweep_slots   = ctxt->string_slot_count;
+  ctxt->cons_free_list   = vnil;
+  ctxt->cons_free_count  = 0;
+
+  ctxt->gc_sweep_slab  = ctxt->vector_slabs;
+  ctxt->gc_sweep_large = ctxt->vector_large;
+  ctxt->vector_large   = NULL;
+
+  ctxt->gc_sweep_buffers = ctxt->buffers;
+  ctxt->gc_sweep_stores  = ctxt->buffer_stores;
+  ctxt->buffers          = NULL;
+  ctxt->buffer_stores    = NULL;
+}
+
+// every unmarked cell goes on the free list, picking up where the last
+// step stopped; answers the budget that's left. segments added since the
+// sweep began only hold cells promoted since, which were born marked
+static int gc_sweep(context_p ctxt, int budget) {
+  while (budget > 0 && ctxt->gc_sweep_segment < ctxt->gc_sweep_limit) {
+    int id = ctxt->gc_sweep_segment;
+    cons_segment_t *seg = &ctxt->cons_segments[id];
+
+    if (id == ctxt->cons_nursery || ctxt->gc_sweep_index >= seg->size) {
+      ctxt->gc_sweep_segment++;
+      ctxt->gc_sweep_index = 0;
+      continue;
+    }
+
+    int index = ctxt->gc_sweep_index;
+    ctxt->gc_sweep_index += 2;
+    budget--;
+
+    if (cell_bit(seg->marks, index)) {
+      continue;
+    }
+
+    seg->cells[index]     = vnil;
+    seg->cells[index + 1] = ctxt->cons_free_list;
+    ctxt->cons_free_list  = make_handle(ctxt, HND_CONS, id, index);
+    ctxt->cons_free_count++;
+  }
+
+  return budget;
+}
+
+// unmarked slab slots go back on their class's free list, then unmarked
+// large vectors go back to malloc; answers the budget that's left
+static int gc_sweep_vectors(context_p ctxt, int budget) {
+  while (budget > 0 && ctxt->gc_sweep_slab) {
+    vector_slab_t *slab = ctxt->gc_sweep_slab;
+    if (ctxt->gc_sweep_index >= slab->slots) {
+      ctxt->gc_sweep_slab  = slab->next;
+      ctxt->gc_sweep_index = 0;
+      continue;
+    }
+
+    int width = sizeof(vector_header_t) + (sizeof(value_t) << slab->sclass);
+    vector_header_t *hdr = (vector_header_t*)(slab->bytes + ctxt->gc_sweep_index++ * width);
+    budget--;
+
+    if (!(hdr->flags & VECTOR_USED)) {
+      continue;
+    }
+
+    if (hdr->flags & (VECTOR_MARK | VECTOR_FRESH)) {
+      hdr->flags &= ~(VECTOR_MARK | VECTOR_FRESH);
+      ctxt->gc_sweep_live += width;
+      continue;
+    }
+
+    hdr->flags = 0;
+    hdr->next  = ctxt->vector_free[slab->sclass];
+    ctxt->vector_free[slab->sclass] = hdr;
+  }
+
+  while (budget > 0 && ctxt->gc_sweep_large) {
+    vector_header_t *hdr = ctxt->gc_sweep_large;
+    ctxt->gc_sweep_large = hdr->next;
+    budget--;
+
+    if (hdr->flags & VECTOR_MARK) {
+      hdr->flags &= ~VECTOR_MARK;
+      ctxt->gc_sweep_live += sizeof(vector_header_t) + hdr->size * sizeof(value_t);
+      hdr->next = ctxt->vector_large;
+      ctxt->vector_large = hdr;
+      continue;
+    }
+
+    free(hdr);
+  }
+
+  return budget;
+}
+
+// unmarked headers, and then unmarked stores, go back to malloc
+static int gc_sweep_buffers(context_p ctxt, int budget) {
+  while (budget > 0 && ctxt->gc_sweep_buffers) {
+    buffer_header_t *hdr = ctxt->gc_sweep_buffers;
+    ctxt->gc_sweep_buffers = hdr->next;
+    budget--;
+
+    if (hdr->flags & BUFFER_MARK) {
+      hdr->flags &= ~BUFFER_MARK;
+      ctxt->gc_sweep_live += sizeof(buffer_header_t);
+      hdr->next = ctxt->buffers;
+      ctxt->buffers = hdr;
+      continue;
+    }
+
+    free(hdr);
+  }
+
+  while (budget > 0 && ctxt->gc_sweep_stores) {
+    buffer_store_t *store = ctxt->gc_sweep_stores;
+    ctxt->gc_sweep_stores = store->next;
+    budget--;
+
+    if (store->flags & BUFFER_MARK) {
+      store->flags &= ~BUFFER_MARK;
+      ctxt->gc_sweep_live += sizeof(buffer_store_t) + store->size;
+      store->next = ctxt->buffer_stores;
+      ctxt->buffer_stores = store;
+      continue;
+    }
+
+    free(store);
+  }
+
+  return budget;
+}
+
+// every unmarked slot goes back on the free list
+static int gc_sweep_strings(context_p ctxt, int budget) {
+  for (; budget > 0 && ctxt->gc_sweep_index < ctxt->gc_sweep_slots; budget--) {
+    int i = ctxt->gc_sweep_index++;
+    string_slot_t *slot = &ctxt->string_slots[i];
+
+    if (slot->flags & STRING_SLOT_FREE) {
+      continue;
+    }
+
+    if (slot->flags & STRING_SLOT_MARK) {
+      slot->flags &= ~STRING_SLOT_MARK;
+      ctxt->gc_sweep_live += (slot->flags & STRING_SLOT_SLICE) ? 0 : slot->len + 1;
+      continue;
+    }
+
+    slot->flags = STRING_SLOT_FREE;
+    slot->ptr   = NULL;
+    slot->len   = ctxt->string_free_slot;
+    ctxt->string_free_slot = i;
+  }
+
+  return budget;
+}
+
+// copy live strings into fresh chunks, packed, a slot at a time; slices
+// go on reading the old chunks, which aren't freed until they've all
+// been repointed. slots freed since only make for a wasted copy
+static int gc_compact_strings(context_p ctxt, int budget) {
+  while (budget > 0 && ctxt->gc_sweep_index < ctxt->gc_sweep_slots) {
+    string_slot_t *slot = &ctxt->string_slots[ctxt->gc_sweep_index++];
+    budget--;
+
+    if (slot->flags & (STRING_SLOT_FREE | STRING_SLOT_SLICE)) {
+      continue;
+    }
+
+    char *bytes = alloc_string_bytes(ctxt, slot->len, &slot->chunk);
+    memcpy(bytes, slot->ptr, slot->len + 1);
+    slot->ptr = bytes;
+    budget -= slot->len / 64;
+  }
+
+  return budget;
+}
+
+// every slice, however new, follows its base into the fresh chunks
+static int gc_repoint_slices(context_p ctxt, int budget) {
+  for (; budget > 0 && ctxt->gc_sweep_index < ctxt->string_slot_count; budget--) {
+    string_slot_t *slot = &ctxt->string_slots[ctxt->gc_sweep_index++];
+
+    if ((slot->flags & (STRING_SLOT_FREE | STRING_SLOT_SLICE)) == STRING_SLOT_SLICE) {
+      slot->ptr   = ctxt->string_slots[slot->base].ptr + slot->offset;
+      slot->chunk = ctxt->string_slots[slot->base].chunk;
+    }
+  }
+
+  return budget;
+}
+
+// the cycle's over
+static void gc_finish_major(context_p ctxt) {
+  ctxt->gc_phase = GC_IDLE;
+  ctxt->gc_major_count++;
+  ctxt->string_bytes_allocated = 0;
+}
+
+static void gc_step(context_p ctxt, int budget) {
+  if (ctxt->gc_phase == GC_MARKING) {
+    budget = gc_scan_roots(ctxt, budget);
+    budget = gc_trace(ctxt, budget);
+    if (!gc_marked(ctxt, &budget)) {
+      return;
+    }
+
+    gc_start_sweep(ctxt);
+  }
+
+  if (ctxt->gc_phase == GC_SWEEPING) {
+    budget = gc_sweep(ctxt, budget);
+    if (ctxt->gc_sweep_segment < ctxt->gc_sweep_limit) {
+      return;
+    }
+
+    int used = 0;
+    for (int id = 0; id < ctxt->cons_segment_count; id++) {
+      if (id != ctxt->cons_nursery) {
+        used += ctxt->cons_segments[id].size / 2;
+      }
+    }
+    ctxt->gc_cells_live = used - ctxt->cons_free_count;
+
+    // grow unless there's room for a couple of nurseries' worth of
+    // survivors; with just the one, the next promotion starts another
+    // major straight away
+    int cells = ctxt->cons_segment_cells;
+    if (tenured_room(ctxt) < cells * 2) {
+      // what's left of the old segment goes on the free list first
+      cons_segment_t *seg = &ctxt->cons_segments[ctxt->cons_tenured];
+      for (; seg->size < cells * 2; seg->size += 2) {
+        seg->cells[seg->size]     = vnil;
+        seg->cells[seg->size + 1] = ctxt->cons_free_list;
+        ctxt->cons_free_list = make_handle(ctxt, HND_CONS, ctxt->cons_tenured, seg->size);
+        ctxt->cons_free_count++;
+      }
+      ctxt->cons_tenured = alloc_cons_segment(ctxt);
+    }
+
+    ctxt->gc_phase       = GC_SWEEPING_VECTORS;
+    ctxt->gc_sweep_index = 0;
+    ctxt->gc_sweep_live  = 0;
+  }
+
+  if (ctxt->gc_phase == GC_SWEEPING_VECTORS) {
+    budget = gc_sweep_vectors(ctxt, budget);
+    if (ctxt->gc_sweep_slab || ctxt->gc_sweep_large) {
+      return;
+    }
+
+    ctxt->vector_bytes_live      = ctxt->gc_sweep_live;
+    ctxt->vector_bytes_allocated = 0;
+
+    ctxt->gc_phase      = GC_SWEEPING_BUFFERS;
+    ctxt->gc_sweep_live = 0;
+  }
+
+  if (ctxt->gc_phase == GC_SWEEPING_BUFFERS) {
+    budget = gc_sweep_buffers(ctxt, budget);
+    if (ctxt->gc_sweep_buffers || ctxt->gc_sweep_stores) {
+      return;
+    }
+
+    ctxt->buffer_bytes_live      = ctxt->gc_sweep_live;
+    ctxt->buffer_bytes_allocated = 0;
+
+    ctxt->gc_phase       = GC_SWEEPING_STRINGS;
+    ctxt->gc_sweep_index = 0;
+    ctxt->gc_sweep_live  = 0;
+  }
+
+  if (ctxt->gc_phase == GC_SWEEPING_STRINGS) {
+    budget = gc_sweep_strings(ctxt, budget);
+    if (ctxt->gc_sweep_index < ctxt->gc_sweep_slots) {
+      return;
+    }
+
+    int live = ctxt->gc_sweep_live;
+    int used = 0;
+    for (int i = 0; i < ctxt->string_chunk_count; i++) {
+      used += ctxt->string_chunks[i].size;
+    }
+    ctxt->string_bytes_live = live;
+
+    // once more than half the chunk space is dead, compact
+    if (used - live <= live || used - live <= STRING_BUFFER_SIZE) {
+      gc_finish_major(ctxt);
+      return;
+    }
+
+    ctxt->gc_old_chunk_count = ctxt->string_chunk_count;
+    ctxt->gc_old_chunks      = ctxt->string_chunks;
+    ctxt->string_chunk_count = 0;
+    ctxt->string_chunk_limit = 0;
+    ctxt->string_chunks      = NULL;
+
+    ctxt->gc_phase       = GC_COMPACTING;
+    ctxt->gc_sweep_index = 0;
+    ctxt->gc_sweep_slots = ctxt->string_slot_count;
+  }
+
+  if (ctxt->gc_phase == GC_COMPACTING) {
+    budget = gc_compact_strings(ctxt, budget);
+    if (ctxt->gc_sweep_index < ctxt->gc_sweep_slots) {
+      return;
+    }
+
+    ctxt->gc_phase       = GC_REPOINTING;
+    ctxt->gc_sweep_index = 0;
+  }
+
+  if (ctxt->gc_phase == GC_REPOINTING) {
+    gc_repoint_slices(ctxt, budget);
+    if (ctxt->gc_sweep_index < ctxt->string_slot_count) {
+      return;
+    }
+
+    for (int i = 0; i < ctxt->gc_old_chunk_count; i++) {
+      if (!in_image(ctxt, ctxt->gc_old_chunks[i].bytes)) {
+        free(ctxt->gc_old_chunks[i].bytes);
+      }
+    }
+    free(ctxt->gc_old_chunks);
+    ctxt->gc_old_chunk_count = 0;
+    ctxt->gc_old_chunks      = NULL;
+
+    gc_finish_major(ctxt);
+  }
+}
+
+// stop the world: finish the cycle that's running, if any, then run
+// a whole fresh one, so everything that's dead now is freed
+void collect_garbage(context_p ctxt) {
+  gc_minor(ctxt);
+
+  uint64_t start = gc_clock();
+  while (ctxt->gc_phase != GC_IDLE) {
+    gc_step(ctxt, INT_MAX);
+  }
+
+  gc_start_major(ctxt);
+  while (ctxt->gc_phase != GC_IDLE) {
+    gc_step(ctxt, INT_MAX);
+  }
+  gc_pause(ctxt, start);
+}
+
+/* statistics */
+
+// walks the string pool, the symbol table and the vectors, so it's not free
+void context_stats(context_p ctxt, context_stats_t *stats) {
+  memset(stats, 0x00, sizeof(context_stats_t));
+
+  stats->cells_allocated   = ctxt->cons_allocated;
+  stats->cells_live        = ctxt->gc_cells_live;
+  stats->cells_capacity    = (uint64_t)ctxt->cons_segment_count * ctxt->cons_segment_cells;
+  stats->strings_allocated = ctxt->strings_allocated;
+  stats->vectors_allocated = ctxt->vectors_allocated;
+  stats->buffers_allocated = ctxt->buffers_allocated;
+
+  for (int id = 0; id < ctxt->cons_segment_count; id++) {
+    stats->cells_in_use += ctxt->cons_segments[id].size / 2;
+  }
+  stats->cells_in_use -= ctxt->cons_free_count;
+
+  /* strings and symbols share slots, the symbol table tells them apart */
+  for (int i = 0; i < ctxt->string_slot_count; i++) {
+    string_slot_t *slot = &ctxt->string_slots[i];
+    if (!(slot->flags & STRING_SLOT_FREE)) {
+      stats->string_count++;
+      stats->string_bytes += (slot->flags & STRING_SLOT_SLICE) ? 0 : slot->len + 1;
+    }
+  }
+
+  uint64_t mask = ctxt->symbol_table_limit - 1;
+  for (int i = 0; i < ctxt->symbol_table_limit; i++) {
+    symbol_entry_t *entry = &ctxt->symbol_table[i];
+    if (is_nil(ctxt, entry->symbol)) {
+      continue;
+    }
+
+    uint64_t probe = (i - (entry->hash & mask)) & mask;
+    if (probe > stats->symbol_probe_max) {
+      stats->symbol_probe_max = probe;
+    }
+
+    stats->symbol_count++;
+    stats->symbol_bytes += string_len(ctxt, entry->symbol) + 1;
+  }
+
+  stats->string_count -= stats->symbol_count;
+  stats->string_bytes -= stats->symbol_bytes;
+  stats->symbol_table_limit = ctxt->symbol_table_limit;
+
+  /* vectors */
+  for (vector_slab_t *slab = ctxt->vector_slabs; slab; slab = slab->next) {
+    int width = sizeof(vector_header_t) + (sizeof(value_t) << slab->sclass);
+
+    for (int i = 0; i < slab->slots; i++) {
+      vector_header_t *hdr = (vector_header_t*)(slab->bytes + i * width);
+      if (hdr->flags & VECTOR_USED) {
+        stats->vector_count++;
+        stats->vector_bytes += width;
+      }
+    }
+  }
+
+  // mid-cycle, some are still set aside for the sweep
+  vector_header_t *large[] = { ctxt->vector_large, ctxt->gc_sweep_large };
+  for (int i = 0; i < 2; i++) {
+    for (vector_header_t *hdr = large[i]; hdr; hdr = hdr->next) {
+      stats->vector_count++;
+      stats->vector_bytes += sizeof(vector_header_t) + hdr->size * sizeof(value_t);
+    }
+  }
+
+  /* buffers */
+  buffer_header_t *buffers[] = { ctxt->buffers, ctxt->gc_sweep_buffers };
+  for (int i = 0; i < 2; i++) {
+    for (buffer_header_t *hdr = buffers[i]; hdr; hdr = hdr->next) {
+      stats->buffer_count++;
+    }
+  }
+
+  buffer_store_t *stores[] = { ctxt->buffer_stores, ctxt->gc_sweep_stores };
+  for (int i = 0; i < 2; i++) {
+    for (buffer_store_t *store = stores[i]; store; store = store->next) {
+      stats->buffer_bytes += store->size;
+    }
+  }
+
+  stats->gc_minor_count = ctxt->gc_minor_count;
+  stats->gc_major_count = ctxt->gc_major_count;
+  stats->gc_pause_total = ctxt->gc_pause_total;
+  stats->gc_pause_max   = ctxt->gc_pause_max;
+}
+
+value_t environment_get(context_p ctxt, value_t env, value_t key) {
+  value_t cursor = env;
+
+  while(1) {
+    if (is_nil(ctxt, cursor)) {
+      return vnil;
+    } 
+
+    if (equality_exact(ctxt, cons_caar(ctxt, cursor), key)) {
+      return cons_cdar(ctxt, cursor);
+    }
+
+    cursor = cons_cdr(ctxt, cursor);
+  }
+}
+
+value_t environment_set(context_p ctxt, value_t env, value_t key, value_t value) {
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &env);
+
+  value_t newpair = make_cons(ctxt, key, value);
+  gc_unroot(ctxt, frame);
+
+  return make_cons(ctxt, newpair, env);
+}
+
+/* globals */
+
+/*
+  every global is a cell in ctxt->globals, and a symbol's entry in the
+  symbol table says which. cells never move or go away, so analyze can
+  resolve a global reference to its index once; redefining a global
+  overwrites its cell. the cells are roots, like the eval stack, so
+  they don't need a write barrier.
+*/
+
+int global_index(context_p ctxt, value_t sym) {
+  uint64_t hash = symbol_hash(string_ptr(ctxt, sym), string_len(ctxt, sym));
+  uint64_t mask = ctxt->symbol_table_limit - 1;
+  uint64_t index;
+
+  for (index = hash & mask; ; index = (index + 1) & mask) {
+    symbol_entry_t *entry = &ctxt->symbol_table[index];
+    if (equality_exact(ctxt, entry->symbol, sym)) {
+      break;
+    }
+  }
+
+  symbol_entry_t *entry = &ctxt->symbol_table[index];
+  if (entry->global < 0) {
+    entry->global = ctxt->globals.size;
+    gc_push(&ctxt->globals, vnil);
+  }
+
+  return entry->global;
+}
+
+inline value_t global_get(context_p ctxt, int index) {
+  return ctxt->globals.values[index];
+}
+
+// marking scans the globals a slice at a time, so it has to see what's
+// stored behind it
+inline void global_set(context_p ctxt, int index, value_t val) {
+  if (ctxt->gc_phase == GC_MARKING) {
+    gc_mark(ctxt, val);
+  }
+  ctxt->globals.values[index] = val;
+}
+
+void global_define(context_p ctxt, value_t sym, value_t val) {
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &val);
+
+  int index = global_index(ctxt, sym);
+  gc_unroot(ctxt, frame);
+
+  global_set(ctxt, index, val);
+}
+
+/* comparisons */
+
+/** exact value equality */
+inline bool equality_exact(context_p, value_t a, value_t b) {
+  return a.as_uint64 == b.as_uint64;
+}
+
+bool equality_string(context_p ctxt, value_t a, value_t b) {
+  bool a_typed = is_string(ctxt, a) || is_symbol(ctxt, a);
+  bool b_typed = is_string(ctxt, b) || is_symbol(ctxt, b);
+  
+  if (!a_typed || !b_typed) { return false; }
+  if (string_len(ctxt, a) != string_len(ctxt, b)) { return false; }
+
+  return strncmp(string_ptr(ctxt, a), string_ptr(ctxt, b), string_len(ctxt, a)) == 0;
+}
+
+bool equality_cstring(context_p ctxt, value_t a, char *value, uint32_t len) {
+  bool a_typed = is_string(ctxt, a) || is_symbol(ctxt, a);
+  if (a_typed && (string_len(ctxt, a) == len)) {
+    return strncmp(string_ptr(ctxt, a), value, len) == 0;
+  }
+
+  return false;
+}
+
+inline bool is_boolean(context_p ctxt, value_t v) {
+  return is_vtruth(ctxt, v) || is_vfalse(ctxt, v);
+}
+
+/** literal equality */
+inline bool is_vtruth(context_p ctxt, value_t v) {
+  return equality_exact(ctxt, v, vtrue);
+}
+
+/** literal equality */
+inline bool is_vfalse(context_p ctxt, value_t v) {
+  return equality_exact(ctxt, v, vfalse);
+}
+
+/** scheme-like predicate: everything but #f is truthy */
+inline bool is_truthy(context_p ctxt, value_t v) {
+  return !is_vfalse(ctxt, v);
+}
+
+/** scheme-like predicate: only #f is falsey */
+inline bool is_falsey(context_p ctxt, value_t v) {
+  return is_vfalse(ctxt, v);
+}
+
+/* doubles */
+
+#define NOT_DOUBLE_MASK 0x7FF0000000000000
+#define NOT_NANINF_MASK 0x0009000000000000
+
+// infinities keep their own bits, but any nan might collide with a box or
+// a handle (x86's default nan is a handle), so they all become vnan
+inline value_t make_double(context_p, double v) {
+  if (v != v) {
+    return vnan;
+  }
+  return (value_t)v;
+}
+
+inline double as_double(context_p, value_t v) {
+  return v.as_double;
+}
+
+inline bool is_double(context_p, value_t v) {
+  uint64_t u = v.as_uint64;
+  return (u & NOT_DOUBLE_MASK) != NOT_DOUBLE_MASK ||
+    u == vpinf.as_uint64 || u == vninf.as_uint64 || u == vnan.as_uint64;
+}
+
+inline bool is_nan(context_p ctxt, value_t v) {
+  return equality_exact(ctxt, v, vnan) || equality_exact(ctxt, v, vnanq);
+}
+
+inline bool is_inf(context_p ctxt, value_t v) {
+  return equality_exact(ctxt, v, vpinf) || equality_exact(ctxt, v, vninf);
+}
+
+/* integers */
+
+// a fixnum's 48 bits are the box's aux and data together
+inline value_t make_integer(context_p, int64_t value) {
+  return make_boxed(BOX_INTEGER, (uint16_t)((uint64_t)value >> 32), (box_data_t)(uint32_t)value);
+}
+
+inline bool is_integer(context_p, value_t v) {
+  return is_boxed(BOX_INTEGER, v);
+}
+  
+inline int64_t as_integer(context_p, value_t v) {
+  return (int64_t)(v.as_uint64 << 16) >> 16;
+}
+/* floats */
+
+inline value_t make_float(context_p, float value) {
+  return make_boxed(BOX_FLOAT, 0, (box_data_t)value);
+}
+
+inline bool is_float(context_p, value_t v) {
+  return is_boxed(BOX_FLOAT, v);
+}
+
+inline float as_float(context_p, value_t v) {
+  return boxed_data(v).as_float;
+}
+
+/* chars */
+
+inline value_t make_character(context_p, char value) {
+  return make_boxed(BOX_CHARACTER, 0, (box_data_t)(uint32_t)value);
+}
+
+inline bool is_character(context_p, value_t v) {
+  return is_boxed(BOX_CHARACTER, v);
+}
+
+inline char as_character(context_p, value_t v) {
+  return (char)boxed_data(v).as_uint32;
+}
+
+inline value_t make_error(context_p, uint32_t code) {
+  return make_boxed(BOX_ERROR, 0, (box_data_t)code);
+}
+
+inline bool is_error(context_p, value_t v) {
+  return is_boxed(BOX_ERROR, v);
+}
+
+/* strings */
+
+static void add_string_chunk(context_p ctxt, int limit) {
+  if (ctxt->string_chunk_count == ctxt->string_chunk_limit) {
+    int count = ctxt->string_chunk_limit ? ctxt->string_chunk_limit * 2 : 8;
+    string_chunk_t *table = realloc(ctxt->string_chunks, count * sizeof(string_chunk_t));
+    if (table == NULL) {
+      fprintf(stderr, "out of memory!\n");
+      exit(1);
+    }
+
+    ctxt->string_chunk_limit = count;
+    ctxt->string_chunks      = table;
+  }
+
+  char *bytes = malloc(limit);
+  if (bytes == NULL) {
+    fprintf(stderr, "out of memory!\n");
+    exit(1);
+  }
+
+  string_chunk_t *chunk = &ctxt->string_chunks[ctxt->string_chunk_count++];
+  chunk->size  = 0;
+  chunk->limit = limit;
+  chunk->bytes = bytes;
+}
+
+// room for len bytes and a terminator, out of the newest chunk; strings
+// too big for a regular chunk get one of their own
+static char* alloc_string_bytes(context_p ctxt, int len, uint16_t *chunk) {
+  string_chunk_t *last = ctxt->string_chunk_count
+    ? &ctxt->string_chunks[ctxt->string_chunk_count - 1]
+    : NULL;
+
+  // rounded up to keep every string 8 byte aligned, for bignum limbs
+  len = ((len + 1 + 7) & ~7) - 1;
+
+  if (last == NULL || last->size + len + 1 > last->limit) {
+    if (ctxt->string_chunk_count == 0xFFFF) {
+      fprintf(stderr, "out of memory!\n");
+      exit(1);
+    }
+
+    add_string_chunk(ctxt, len + 1 > STRING_BUFFER_SIZE ? len + 1 : STRING_BUFFER_SIZE);
+    last = &ctxt->string_chunks[ctxt->string_chunk_count - 1];
+  }
+
+  char *bytes = last->bytes + last->size;
+  last->size += len + 1;
+  ctxt->string_bytes_allocated += len + 1;
+
+  *chunk = ctxt->string_chunk_count - 1;
+  return bytes;
+}
+
+static int alloc_string_slot(context_p ctxt) {
+  ctxt->strings_allocated++;
+
+  if (ctxt->string_free_slot >= 0) {
+    int index = ctxt->string_free_slot;
+    ctxt->string_free_slot = ctxt->string_slots[index].len;
+    return index;
+  }
+
+  if (ctxt->string_slot_count == ctxt->string_slot_limit) {
+    int limit = ctxt->string_slot_limit ? ctxt->string_slot_limit * 2 : 256;
+    string_slot_t *slots = realloc(ctxt->string_slots, limit * sizeof(string_slot_t));
+    if (slots == NULL) {
+      fprintf(stderr, "out of memory!\n");
+      exit(1);
+    }
+
+    ctxt->string_slot_limit = limit;
+    ctxt->string_slots      = slots;
+  }
+
+  return ctxt->string_slot_count++;
+}
+
+// from when a cycle starts until the string sweep's done, new strings
+// are born marked; the ones that end up behind the sweep just survive
+// the next one too
+static bool gc_strings_unswept(context_p ctxt) {
+  return ctxt->gc_phase != GC_IDLE && ctxt->gc_phase <= GC_SWEEPING_STRINGS;
+}
+
+// a slot and len bytes (plus a terminator) for it; strings, symbols,
+// bignums and numeric vectors all live in the pool
+static char* alloc_string(context_p ctxt, int len, int *index) {
+  uint16_t chunk;
+  char *bytes = alloc_string_bytes(ctxt, len, &chunk);
+  bytes[len] = '\0';
+
+  *index = alloc_string_slot(ctxt);
+  string_slot_t *slot = &ctxt->string_slots[*index];
+  slot->ptr   = bytes;
+  slot->len   = len;
+  slot->chunk = chunk;
+  slot->flags = gc_strings_unswept(ctxt) ? STRING_SLOT_MARK : 0;
+  slot->base  = *index;
+  slot->offset = 0;
+
+  return bytes;
+}
+
+// never collects, so str is allowed to point into the string pool itself
+value_t make_string(context_p ctxt, char *str, int len) {
+  if (len < 0) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  int index;
+  char *bytes = alloc_string(ctxt, len, &index);
+  memcpy(bytes, str, len);
+
+  return make_handle(ctxt, HND_STRING, 0, index);
+}
+
+// [start, end) of str, as a slice of str's base; nothing's copied
+value_t make_substring(context_p ctxt, value_t str, int64_t start, int64_t end) {
+  if (!is_string(ctxt, str) || start < 0 || end < start || end > string_len(ctxt, str)) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  int index = alloc_string_slot(ctxt);
+  string_slot_t *from  = &ctxt->string_slots[handle_offset(str)];
+  string_slot_t *slot  = &ctxt->string_slots[index];
+  string_slot_t *base  = &ctxt->string_slots[from->base];
+
+  // from the base, not from str, which a compaction might not have
+  // repointed yet. born marked like any string, and while marking so is
+  // the base, which str might not have reached yet
+  slot->offset = from->offset + start;
+  slot->ptr    = base->ptr + slot->offset;
+  slot->len    = end - start;
+  slot->chunk  = base->chunk;
+  slot->base   = from->base;
+  slot->flags = STRING_SLOT_SLICE;
+  if (gc_strings_unswept(ctxt)) {
+    slot->flags |= STRING_SLOT_MARK;
+  }
+  if (ctxt->gc_phase == GC_MARKING) {
+    base->flags |= STRING_SLOT_MARK;
+  }
+
+  return make_handle(ctxt, HND_STRING, 0, index);
+}
+
+inline bool is_string(context_p, value_t v) {
+  return is_handle(HND_STRING, v);
+}
+
+inline char* string_ptr(context_p ctxt, value_t v) {
+  return ctxt->string_slots[handle_offset(v)].ptr;
+}
+
+inline uint32_t string_len(context_p ctxt, value_t v) {
+  return ctxt->string_slots[handle_offset(v)].len;
+}
+
+/* bignums */
+
+#define BIGNUM_NEGATIVE 0x8000
+#define BIGNUM_LIMIT    0x7FFF
+
+// limbs are the magnitude, least significant first; high zero limbs are
+// dropped, and anything a fixnum can hold becomes one
+value_t make_bignum(context_p ctxt, bool negative, const uint64_t *limbs, int size) {
+  while (size > 0 && limbs[size - 1] == 0) {
+    size--;
+  }
+
+  if (size == 0) {
+    return make_integer(ctxt, 0);
+  }
+
+  if (size == 1) {
+    uint64_t limit = negative ? -(uint64_t)FIXNUM_MIN : (uint64_t)FIXNUM_MAX;
+    if (limbs[0] <= limit) {
+      return make_integer(ctxt, negative ? -(int64_t)limbs[0] : (int64_t)limbs[0]);
+    }
+  }
+
+  if (size > BIGNUM_LIMIT) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  int index;
+  char *bytes = alloc_string(ctxt, size * sizeof(uint64_t), &index);
+  memcpy(bytes, limbs, size * sizeof(uint64_t));
+
+  return make_handle(ctxt, HND_BIGNUM, size | (negative ? BIGNUM_NEGATIVE : 0), index);
+}
+
+inline bool is_bignum(context_p, value_t v) {
+  return is_handle(HND_BIGNUM, v);
+}
+
+inline bool bignum_negative(context_p, value_t v) {
+  return handle_aux(v) & BIGNUM_NEGATIVE;
+}
+
+inline int bignum_size(context_p, value_t v) {
+  return handle_aux(v) & BIGNUM_LIMIT;
+}
+
+inline uint64_t* bignum_limbs(context_p ctxt, value_t v) {
+  return (uint64_t*)ctxt->string_slots[handle_offset(v)].ptr;
+}
+
+/* numeric vectors */
+
+static const int numvec_sizes[] = {
+  [NUMVEC_U8]  = sizeof(uint8_t),
+  [NUMVEC_S32] = sizeof(int32_t),
+  [NUMVEC_F64] = sizeof(double),
+};
+
+// zeroed; the element type's the handle's aux, the count comes from
+// the slot's length
+value_t make_numvec(context_p ctxt, numvec_type_t type, int64_t count) {
+  if (count < 0 || count > (INT32_MAX - 8) / numvec_sizes[type]) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  int index;
+  int len = count * numvec_sizes[type];
+  char *bytes = alloc_string(ctxt, len, &index);
+  memset(bytes, 0, len);
+
+  return make_handle(ctxt, HND_NUMVEC, type, index);
+}
+
+inline bool is_numvec(context_p, value_t v) {
+  return is_handle(HND_NUMVEC, v);
+}
+
+inline numvec_type_t numvec_type(context_p, value_t v) {
+  return (numvec_type_t)handle_aux(v);
+}
+
+inline uint32_t numvec_count(context_p ctxt, value_t v) {
+  return ctxt->string_slots[handle_offset(v)].len / numvec_sizes[handle_aux(v)];
+}
+
+inline uint32_t numvec_bytes(context_p ctxt, value_t v) {
+  return ctxt->string_slots[handle_offset(v)].len;
+}
+
+inline void* numvec_data(context_p ctxt, value_t v) {
+  return ctxt->string_slots[handle_offset(v)].ptr;
+}
+
+/* symbols */
+
+// fxhash, a word at a time
+static uint64_t symbol_hash(char *name, int len) {
+  const uint64_t seed = 0x517cc1b727220a95ULL;
+  uint64_t hash = 0;
+  uint64_t word;
+
+  for (; len >= 8; name += 8, len -= 8) {
+    memcpy(&word, name, 8);
+    hash = (((hash << 5) | (hash >> 59)) ^ word) * seed;
+  }
+
+  if (len > 0) {
+    word = 0;
+    memcpy(&word, name, len);
+    hash = (((hash << 5) | (hash >> 59)) ^ word) * seed;
+  }
+
+  return hash;
+}
+
+// keep the load under half, so probe sequences stay short
+static void grow_symbol_table(context_p ctxt) {
+  int limit = ctxt->symbol_table_limit * 2;
+  symbol_entry_t *table = malloc(limit * sizeof(symbol_entry_t));
+  if (table == NULL) {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+  }
+  memset(table, 0xFF, limit * sizeof(symbol_entry_t));
+
+  for (int i = 0; i < ctxt->symbol_table_limit; i++) {
+    symbol_entry_t entry = ctxt->symbol_table[i];
+    if (is_nil(ctxt, entry.symbol)) {
+      continue;
+    }
+
+    uint64_t index = entry.hash & (limit - 1);
+    while (!is_nil(ctxt, table[index].symbol)) {
+      index = (index + 1) & (limit - 1);
+    }
+    table[index] = entry;
+  }
+
+  free(ctxt->symbol_table);
+  ctxt->symbol_table       = table;
+  ctxt->symbol_table_limit = limit;
+
+  // entries moved, so marking has to scan them all over again
+  ctxt->gc_root_symbol = 0;
+}
+
+value_t make_symbol(context_p ctxt, char* name, int len) {
+  uint64_t hash = symbol_hash(name, len);
+  uint64_t mask = ctxt->symbol_table_limit - 1;
+  uint64_t index;
+
+  // compare hashes first, most probes stop there
+  for (index = hash & mask; ; index = (index + 1) & mask) {
+    symbol_entry_t *entry = &ctxt->symbol_table[index];
+
+    if (is_nil(ctxt, entry->symbol)) {
+      break;
+    }
+
+    if (entry->hash == hash && equality_cstring(ctxt, entry->symbol, name, len)) {
+      return entry->symbol;
+    }
+  }
+
+  // not interned yet
+  value_t key = make_string(ctxt, name, len);
+  if (is_error(ctxt, key)) {
+    return key;
+  }
+  key = reshape_handle(ctxt, key, HND_SYMBOL);
+
+  if ((ctxt->symbol_table_size + 1) * 2 > ctxt->symbol_table_limit) {
+    grow_symbol_table(ctxt);
+
+    mask = ctxt->symbol_table_limit - 1;
+    for (index = hash & mask;
+         !is_nil(ctxt, ctxt->symbol_table[index].symbol);
+         index = (index + 1) & mask);
+  }
+
+  ctxt->symbol_table[index].hash   = hash;
+  ctxt->symbol_table[index].symbol = key;
+  ctxt->symbol_table[index].global = -1;
+  ctxt->symbol_table_size++;
+
+  return key;
+}
+
+inline bool is_symbol(context_p, value_t v) {
+  return is_handle(HND_SYMBOL, v);
+}
+
+/* errors */
+
+/* cons cells */
+
+inline value_t make_cons(context_p ctxt, value_t car, value_t cdr) {
+  return alloc_cons(ctxt, car, cdr);
+}
+
+inline bool is_cons(context_p, value_t v) {
+  return is_handle(HND_CONS, v);
+}
+
+inline bool is_atom(context_p ctxt, value_t v) {
+  return !is_cons(ctxt, v);
+}
+
+inline bool is_nil(context_p ctxt, value_t v) {
+  return equality_exact(ctxt, v, vnil);
+}
+
+// procs are cells too; anything else has no car or cdr, and reads as nil
+inline static value_t* cons_cell(context_p ctxt, value_t hnd) {
+  if (!is_handle(HND_CONS, hnd) && !is_handle(HND_PROC, hnd)) {
+    return NULL;
+  }
+
+  return gc_cell(ctxt, hnd);
+}
+
+inline value_t cons_car(context_p ctxt, value_t hnd) {
+  value_t *cell = cons_cell(ctxt, hnd);
+  return cell ? cell[0] : vnil;
+}
+
+inline value_t cons_cdr(context_p ctxt, value_t hnd) {
+  value_t *cell = cons_cell(ctxt, hnd);
+  return cell ? cell[1] : vnil;
+}
+
+inline void cons_set_car(context_p ctxt, value_t hnd, value_t v) {
+  value_t *cell = cons_cell(ctxt, hnd);
+  if (cell) {
+    gc_write_barrier(ctxt, hnd, cell[0], v);
+    cell[0] = v;
+  }
+}
 
-inline value_t make_native_proc(context_p ctxt, native_proc_fn fn) {
-  return make_pointer(ctxt, PTR_NATIVE_PROC, fn);
+inline void cons_set_cdr(context_p ctxt, value_t hnd, value_t v) {
+  value_t *cell = cons_cell(ctxt, hnd);
+  if (cell) {
+    gc_write_barrier(ctxt, hnd, cell[1], v);
+    cell[1] = v;
+  }
+}
+
+/* buffers */
+
+// stores are only freed by a major, so past twice what was live, start one
+static bool buffer_pressure(context_p ctxt) {
+  size_t threshold = ctxt->buffer_bytes_live > BUFFER_MIN_GROWTH
+    ? ctxt->buffer_bytes_live
+    : BUFFER_MIN_GROWTH;
+
+  return ctxt->buffer_bytes_allocated > threshold;
+}
+
+static value_t alloc_buffer_header(context_p ctxt, buffer_store_t *store, size_t offset, size_t length) {
+  buffer_header_t *hdr = malloc(sizeof(buffer_header_t));
+  if (hdr == NULL) {
+    fprintf(stderr, "out of memory!\n");
+    exit(1);
+  }
+
+  // allocated while a major collection is marking, so born marked
+  hdr->store  = store;
+  hdr->offset = offset;
+  hdr->length = length;
+  hdr->flags  = ctxt->gc_phase == GC_MARKING ? BUFFER_MARK : 0;
+  hdr->next   = ctxt->buffers;
+  ctxt->buffers = hdr;
+  ctxt->buffer_bytes_allocated += sizeof(buffer_header_t);
+  ctxt->buffers_allocated++;
+
+  return make_pointer(ctxt, PTR_BUFFER, hdr);
+}
+
+// zero filled ones come from calloc, so big ones are fresh pages that
+// aren't touched until they're written
+value_t make_buffer(context_p ctxt, int64_t size, char fill) {
+  if (size < 0 || (uint64_t)size > SIZE_MAX - sizeof(buffer_store_t)) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  if (buffer_pressure(ctxt)) {
+    if (ctxt->gc_phase == GC_IDLE) {
+      gc_minor(ctxt);
+    }
+    else {
+      uint64_t start = gc_clock();
+      gc_step(ctxt, ctxt->gc_step_work);
+      gc_pause(ctxt, start);
+    }
+  }
+
+  buffer_store_t *store = fill == 0
+    ? calloc(1, sizeof(buffer_store_t) + size)
+    : malloc(sizeof(buffer_store_t) + size);
+  if (store == NULL) {
+    fprintf(stderr, "out of memory!\n");
+    exit(1);
+  }
+
+  if (fill != 0) {
+    memset(store->bytes, fill, size);
+  }
+
+  store->size  = size;
+  store->flags = ctxt->gc_phase == GC_MARKING ? BUFFER_MARK : 0;
+  store->next  = ctxt->buffer_stores;
+  ctxt->buffer_stores = store;
+  ctxt->buffer_bytes_allocated += sizeof(buffer_store_t) + size;
+
+  return alloc_buffer_header(ctxt, store, 0, size);
+}
+
+inline bool is_buffer(context_p, value_t v) {
+  return is_pointer(PTR_BUFFER, v);
+}
+
+inline uint64_t buffer_length(context_p, value_t v) {
+  return ((buffer_header_t*)pointer_addr(v))->length;
+}
+
+inline char* buffer_data(context_p, value_t v) {
+  buffer_header_t *hdr = pointer_addr(v);
+  return hdr->store->bytes + hdr->offset;
+}
+
+// [start, end) of v, sharing its store; nothing's copied
+value_t buffer_slice(context_p ctxt, value_t v, int64_t start, int64_t end) {
+  if (!is_buffer(ctxt, v) || start < 0 || end < start || (uint64_t)end > buffer_length(ctxt, v)) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  // the store's already marked if v was, but v might not have been reached yet
+  buffer_header_t *hdr = pointer_addr(v);
+  if (ctxt->gc_phase == GC_MARKING) {
+    hdr->store->flags |= BUFFER_MARK;
+  }
+
+  return alloc_buffer_header(ctxt, hdr->store, hdr->offset + start, end - start);
+}
+
+/* vectors */
+
+static void add_vector_slab(context_p ctxt, int sclass) {
+  int width = sizeof(vector_header_t) + (sizeof(value_t) << sclass);
+
+  vector_slab_t *slab = malloc(sizeof(vector_slab_t));
+  char *bytes = malloc(VECTOR_SLAB_SIZE);
+  if (slab == NULL || bytes == NULL) {
+    fprintf(stderr, "out of memory!\n");
+    exit(1);
+  }
+
+  slab->sclass = sclass;
+  slab->slots  = VECTOR_SLAB_SIZE / width;
+  slab->bytes  = bytes;
+  slab->next   = ctxt->vector_slabs;
+  ctxt->vector_slabs = slab;
+
+  for (int i = slab->slots - 1; i >= 0; i--) {
+    vector_header_t *hdr = (vector_header_t*)(bytes + i * width);
+    hdr->sclass = sclass;
+    hdr->flags  = 0;
+    hdr->next   = ctxt->vector_free[sclass];
+    ctxt->vector_free[sclass] = hdr;
+  }
+}
+
+static vector_header_t* alloc_vector(context_p ctxt, uint32_t size) {
+  int sclass = 0;
+  while (sclass < VECTOR_CLASSES && (1U << sclass) < size) {
+    sclass++;
+  }
+
+  vector_header_t *hdr;
+  if (sclass == VECTOR_CLASSES) {
+    hdr = malloc(sizeof(vector_header_t) + size * sizeof(value_t));
+    if (hdr == NULL) {
+      fprintf(stderr, "out of memory!\n");
+      exit(1);
+    }
+
+    hdr->sclass = VECTOR_LARGE;
+    hdr->next   = ctxt->vector_large;
+    ctxt->vector_large = hdr;
+    ctxt->vector_bytes_allocated += sizeof(vector_header_t) + size * sizeof(value_t);
+  }
+  else {
+    if (ctxt->vector_free[sclass] == NULL) {
+      add_vector_slab(ctxt, sclass);
+    }
+
+    hdr = ctxt->vector_free[sclass];
+    ctxt->vector_free[sclass] = hdr->next;
+    hdr->next = NULL;
+    ctxt->vector_bytes_allocated += sizeof(vector_header_t) + (sizeof(value_t) << sclass);
+  }
+
+  // allocated while a major collection is marking, so born marked; or
+  // while slabs are being swept, and maybe in front of the sweep
+  hdr->size  = size;
+  hdr->flags = VECTOR_USED | (ctxt->gc_phase == GC_MARKING ? VECTOR_MARK : 0);
+  if (sclass < VECTOR_CLASSES &&
+      (ctxt->gc_phase == GC_SWEEPING || ctxt->gc_phase == GC_SWEEPING_VECTORS)) {
+    hdr->flags |= VECTOR_FRESH;
+  }
+  return hdr;
+}
+
+inline static value_t* vector_elements(value_t v) {
+  return (value_t*)((vector_header_t*)pointer_addr(v) + 1);
+}
+
+value_t make_vector(context_p ctxt, int size, value_t fill) {
+  if (size < 0) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  // cons allocation might be quiet enough that nothing else collects
+  int threshold = ctxt->vector_bytes_live > VECTOR_SLAB_SIZE * 4
+    ? ctxt->vector_bytes_live
+    : VECTOR_SLAB_SIZE * 4;
+
+  if (ctxt->vector_bytes_allocated > threshold) {
+    int frame = gc_root_frame(ctxt);
+    gc_root(ctxt, &fill);
+    if (ctxt->gc_phase == GC_IDLE) {
+      gc_minor(ctxt);
+    }
+    else {
+      uint64_t start = gc_clock();
+      gc_step(ctxt, ctxt->gc_step_work);
+      gc_pause(ctxt, start);
+    }
+    gc_unroot(ctxt, frame);
+  }
+
+  vector_header_t *hdr = alloc_vector(ctxt, size);
+  value_t vec = make_pointer(ctxt, PTR_VECTOR, hdr);
+  ctxt->vectors_allocated++;
+
+  value_t *elements = vector_elements(vec);
+  for (int i = 0; i < size; i++) {
+    elements[i] = fill;
+  }
+
+  gc_write_barrier(ctxt, vec, vnil, fill);
+  return vec;
+}
+
+inline bool is_vector(context_p, value_t v) {
+  return is_pointer(PTR_VECTOR, v);
+}
+
+inline uint32_t vector_size(context_p, value_t v) {
+  return ((vector_header_t*)pointer_addr(v))->size;
+}
+
+// only settled once marking's done, and until the sweep gets to it
+inline bool vector_marked(context_p, value_t v) {
+  return ((vector_header_t*)pointer_addr(v))->flags & VECTOR_MARK;
+}
+
+value_t vector_get(context_p ctxt, value_t v, int index) {
+  if (!is_vector(ctxt, v) || index < 0 || (uint32_t)index >= vector_size(ctxt, v)) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  return vector_elements(v)[index];
+}
+
+// no checks, and no write barrier; stores go through vector_set
+inline value_t* vector_data(context_p, value_t v) {
+  return vector_elements(v);
+}
+
+value_t vector_set(context_p ctxt, value_t v, int index, value_t val) {
+  if (!is_vector(ctxt, v) || index < 0 || (uint32_t)index >= vector_size(ctxt, v)) {
+    return make_error(ctxt, __LINE__);
+  }
+
+  value_t *elements = vector_elements(v);
+  gc_write_barrier(ctxt, v, elements[index], val);
+  elements[index] = val;
+  return vnil;
+}
+
+/* procs */
+
+// a new entry in the native table, so each name a function's installed
+// under keeps its own arity and flags
+value_t make_native_proc(context_p ctxt, native_proc_fn fn, int min, int max) {
+  if (ctxt->native_proc_count == ctxt->native_proc_limit) {
+    int limit = ctxt->native_proc_limit ? ctxt->native_proc_limit * 2 : 64;
+    native_proc_t *table = realloc(ctxt->native_procs, limit * sizeof(native_proc_t));
+    if (table == NULL) {
+      fprintf(stderr, "out of memory!\n");
+      exit(1);
+    }
+
+    ctxt->native_proc_limit = limit;
+    ctxt->native_procs      = table;
+  }
+
+  ctxt->native_procs[ctxt->native_proc_count] = (native_proc_t){ fn, min, max, PRIM_NONE, false };
+  return native_proc_at(ctxt, ctxt->native_proc_count++);
+}
+
+// the native at index in the table
+inline value_t native_proc_at(context_p ctxt, int index) {
+  return make_pointer(ctxt, PTR_NATIVE_PROC, (void*)(uintptr_t)index);
 }
 
 inline bool is_native_proc(context_p, value_t v) {
   return is_pointer(PTR_NATIVE_PROC, v);
 }
 
-inline native_proc_fn native_proc_function(context_p, value_t v) {
-  return (native_proc_fn)pointer_addr(v);
+inline native_proc_fn native_proc_function(context_p ctxt, value_t v) {
+  return ctxt->native_procs[(uintptr_t)pointer_addr(v)].fn;
+}
+
+// whether a call with argc args is in the native's arity
+inline bool native_proc_accepts(context_p ctxt, value_t v, int argc) {
+  native_proc_t *native = &ctxt->native_procs[(uintptr_t)pointer_addr(v)];
+  return argc >= native->min && (native->max == ARITY_ANY || argc <= native->max);
+}
+
+inline prim_t native_proc_prim(context_p ctxt, value_t v) {
+  return ctxt->native_procs[(uintptr_t)pointer_addr(v)].prim;
+}
+
+void native_proc_set_prim(context_p ctxt, value_t v, prim_t prim) {
+  ctxt->native_procs[(uintptr_t)pointer_addr(v)].prim = prim;
+}
+
+inline bool native_proc_pure(context_p ctxt, value_t v) {
+  return ctxt->native_procs[(uintptr_t)pointer_addr(v)].pure;
+}
+
+void native_proc_set_pure(context_p ctxt, value_t v, bool pure) {
+  ctxt->native_procs[(uintptr_t)pointer_addr(v)].pure = pure;
+}
+
+// a fixnum's converted, which is exact up to 2^53
+static bool prim_doubles(context_p ctxt, prim_t prim, value_t a, value_t b, value_t *out) {
+  if (!(is_double(ctxt, a) || is_integer(ctxt, a)) ||
+      !(is_double(ctxt, b) || is_integer(ctxt, b))) {
+    return false;
+  }
+
+  double x = is_double(ctxt, a) ? as_double(ctxt, a) : (double)as_integer(ctxt, a);
+  double y = is_double(ctxt, b) ? as_double(ctxt, b) : (double)as_integer(ctxt, b);
+
+  switch (prim) {
+  case PRIM_ADD: *out = make_double(ctxt, x + y); return true;
+  case PRIM_SUB: *out = make_double(ctxt, x - y); return true;
+  case PRIM_MUL: *out = make_double(ctxt, x * y); return true;
+  case PRIM_EQ:  *out = x == y ? vtrue : vfalse; return true;
+  case PRIM_LT:  *out = x <  y ? vtrue : vfalse; return true;
+  case PRIM_GT:  *out = x >  y ? vtrue : vfalse; return true;
+  case PRIM_LTE: *out = x <= y ? vtrue : vfalse; return true;
+  case PRIM_GTE: *out = x >= y ? vtrue : vfalse; return true;
+  default:       return false;
+  }
+}
+
+// what prim answers for two fixnums, unless the answer needs a bignum,
+// or for doubles, or a double and a fixnum; anything else is up to the
+// native
+inline bool prim_numbers(context_p ctxt, prim_t prim, value_t a, value_t b, value_t *out) {
+  if (!is_integer(ctxt, a) || !is_integer(ctxt, b)) {
+    return prim_doubles(ctxt, prim, a, b, out);
+  }
+
+  int64_t x = as_integer(ctxt, a);
+  int64_t y = as_integer(ctxt, b);
+  int64_t r;
+
+  switch (prim) {
+  case PRIM_ADD: r = x + y; break;
+  case PRIM_SUB: r = x - y; break;
+  case PRIM_MUL:
+    if (__builtin_mul_overflow(x, y, &r)) {
+      return false;
+    }
+    break;
+
+  case PRIM_EQ:  *out = x == y ? vtrue : vfalse; return true;
+  case PRIM_LT:  *out = x <  y ? vtrue : vfalse; return true;
+  case PRIM_GT:  *out = x >  y ? vtrue : vfalse; return true;
+  case PRIM_LTE: *out = x <= y ? vtrue : vfalse; return true;
+  case PRIM_GTE: *out = x >= y ? vtrue : vfalse; return true;
+
+  default:
+    return false;
+  }
+
+  if (r < FIXNUM_MIN || r > FIXNUM_MAX) {
+    return false;
+  }
+
+  *out = make_integer(ctxt, r);
+  return true;
 }
 
 // captures env!
 // (body . (args . env))
 inline value_t make_compound_proc(context_p ctxt, value_t args, value_t body, value_t env) {
-  value_t v = make_cons(ctxt, body, make_cons(ctxt, args, env));
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &body);
+
+  value_t tail = make_cons(ctxt, args, env);
+  value_t v    = make_cons(ctxt, body, tail);
+  gc_unroot(ctxt, frame);
+
   return reshape_handle(ctxt, v, HND_PROC);
 }
 
@@ -539,6 +2384,478 @@ inline bool is_proc(context_p ctxt, value_t v) {
   return is_compound_proc(ctxt, v) || is_native_proc(ctxt, v);
 }
 
+/* images */
+
+#define IMAGE_MAGIC   "scmimage"
+#define IMAGE_VERSION 9
+
+typedef struct image_header {
+  char     magic[8];
+  uint32_t version;
+  int32_t  segment_cells;
+  int64_t  anchor;
+  uint64_t size;
+  int32_t  segment_count;
+  int32_t  nursery;
+  int32_t  tenured;
+  int32_t  free_count;
+  value_t  free_list;
+  value_t  root_env;
+  value_t  curr_env;
+  int32_t  symbol_table_size;
+  int32_t  symbol_table_limit;
+  int32_t  string_chunk_count;
+  int32_t  string_slot_count;
+  int32_t  string_free_slot;
+  int32_t  string_bytes_live;
+  int32_t  native_proc_count;
+  int32_t  vector_count;
+  int32_t  reloc_count;
+  int32_t  global_count;
+} image_header_t;
+
+typedef struct image_writer {
+  FILE *file;
+  size_t at;
+  int vector_count;
+  vector_header_t **vectors; // sorted by address; a vector's id is its index
+  int reloc_count;
+  int reloc_limit;
+  uint64_t *relocs;
+} image_writer_t;
+
+// image memory is mapped, not malloc'd; it's never given back
+inline static bool in_image(context_p ctxt, void *ptr) {
+  char *base = ctxt->image_base;
+  return base != NULL && (char*)ptr >= base && (char*)ptr < base + ctxt->image_size;
+}
+
+// two images only agree on where natives are if they came from the same binary
+inline static int64_t image_anchor(void) {
+  return (intptr_t)&enhance_native_environment - (intptr_t)&alloc_context;
+}
+
+static void image_write(image_writer_t *w, const void *bytes, size_t len) {
+  fwrite(bytes, 1, len, w->file);
+  w->at += len;
+}
+
+// every section is 8 byte aligned, so it can be used in place once mapped
+static void image_align(image_writer_t *w) {
+  static const char zeros[8] = { 0 };
+  image_write(w, zeros, (8 - (w->at & 7)) & 7);
+}
+
+static int image_compare_vectors(const void *a, const void *b) {
+  uintptr_t x = (uintptr_t)*(vector_header_t* const*)a;
+  uintptr_t y = (uintptr_t)*(vector_header_t* const*)b;
+  return (x > y) - (x < y);
+}
+
+static void image_gather_vectors(context_p ctxt, image_writer_t *w) {
+  int count = 0;
+  for (int pass = 0; pass < 2; pass++) {
+    count = 0;
+
+    for (vector_slab_t *slab = ctxt->vector_slabs; slab; slab = slab->next) {
+      int width = sizeof(vector_header_t) + (sizeof(value_t) << slab->sclass);
+
+      for (int i = 0; i < slab->slots; i++) {
+        vector_header_t *hdr = (vector_header_t*)(slab->bytes + i * width);
+        if (hdr->flags & VECTOR_USED) {
+          if (pass) w->vectors[count] = hdr;
+          count++;
+        }
+      }
+    }
+
+    for (vector_header_t *hdr = ctxt->vector_large; hdr; hdr = hdr->next) {
+      if (pass) w->vectors[count] = hdr;
+      count++;
+    }
+
+    if (!pass) {
+      w->vectors = malloc((count ? count : 1) * sizeof(vector_header_t*));
+      if (w->vectors == NULL) {
+        fprintf(stderr, "out of memory!\n");
+        exit(1);
+      }
+    }
+  }
+
+  w->vector_count = count;
+  qsort(w->vectors, count, sizeof(vector_header_t*), &image_compare_vectors);
+}
+
+// vectors are written as their id; the ones held by cells are noted in
+// the relocation table, by where they land in the file
+static void image_write_value(context_p ctxt, image_writer_t *w, value_t v, bool reloc) {
+  if (is_pointer(PTR_VECTOR, v)) {
+    vector_header_t *hdr = pointer_addr(v);
+    vector_header_t **found = bsearch(&hdr, w->vectors, w->vector_count,
+                                      sizeof(vector_header_t*), &image_compare_vectors);
+
+    v = make_pointer(ctxt, PTR_VECTOR, (void*)(uintptr_t)(found - w->vectors));
+
+    if (reloc) {
+      if (w->reloc_count == w->reloc_limit) {
+        int limit = w->reloc_limit ? w->reloc_limit * 2 : 256;
+        uint64_t *relocs = realloc(w->relocs, limit * sizeof(uint64_t));
+        if (relocs == NULL) {
+          fprintf(stderr, "out of memory!\n");
+          exit(1);
+        }
+
+        w->reloc_limit = limit;
+        w->relocs      = relocs;
+      }
+
+      w->relocs[w->reloc_count++] = w->at;
+    }
+  }
+
+  image_write(w, &v, sizeof(value_t));
+}
+
+// collects first, so everything written is live
+bool save_image(context_p ctxt, const char *path) {
+  collect_garbage(ctxt);
+  if (ctxt->buffers != NULL) {
+    return false;
+  }
+
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    return false;
+  }
+
+  image_writer_t w = { .file = file, .at = 0, .relocs = NULL, .reloc_count = 0, .reloc_limit = 0 };
+  image_gather_vectors(ctxt, &w);
+
+  image_header_t header;
+  memset(&header, 0x00, sizeof(header));
+  memcpy(header.magic, IMAGE_MAGIC, sizeof(header.magic));
+  header.version            = IMAGE_VERSION;
+  header.anchor             = image_anchor();
+  header.segment_cells      = ctxt->cons_segment_cells;
+  header.segment_count      = ctxt->cons_segment_count;
+  header.nursery            = ctxt->cons_nursery;
+  header.tenured            = ctxt->cons_tenured;
+  header.free_count         = ctxt->cons_free_count;
+  header.free_list          = ctxt->cons_free_list;
+  header.root_env           = ctxt->root_env;
+  header.curr_env           = ctxt->curr_env;
+  header.symbol_table_size  = ctxt->symbol_table_size;
+  header.symbol_table_limit = ctxt->symbol_table_limit;
+  header.string_chunk_count = ctxt->string_chunk_count;
+  header.string_slot_count  = ctxt->string_slot_count;
+  header.string_free_slot   = ctxt->string_free_slot;
+  header.string_bytes_live  = ctxt->string_bytes_live;
+  header.native_proc_count  = ctxt->native_proc_count;
+  header.vector_count       = w.vector_count;
+  header.global_count       = ctxt->globals.size;
+  image_write(&w, &header, sizeof(header));
+
+  /* cons pool - every segment whole */
+  int cells = ctxt->cons_segment_cells;
+
+  for (int id = 0; id < ctxt->cons_segment_count; id++) {
+    int32_t size = ctxt->cons_segments[id].size;
+    image_write(&w, &size, sizeof(size));
+  }
+
+  image_align(&w);
+  for (int id = 0; id < ctxt->cons_segment_count; id++) {
+    value_t *pool = ctxt->cons_segments[id].cells;
+
+    for (int index = 0; index < cells * 2; index++) {
+      // the nursery is all dead, and can hold anything, even freed vectors
+      bool dead = id == ctxt->cons_nursery;
+      image_write_value(ctxt, &w, dead ? vnil : pool[index], true);
+    }
+  }
+
+  /* string pool - only the used part of each chunk */
+  for (int i = 0; i < ctxt->string_chunk_count; i++) {
+    int32_t size = ctxt->string_chunks[i].size;
+    image_write(&w, &size, sizeof(size));
+  }
+  for (int i = 0; i < ctxt->string_chunk_count; i++) {
+    image_align(&w);
+    image_write(&w, ctxt->string_chunks[i].bytes, ctxt->string_chunks[i].size);
+  }
+
+  image_align(&w);
+  for (int i = 0; i < ctxt->string_slot_count; i++) {
+    string_slot_t slot = ctxt->string_slots[i];
+    slot.ptr = (slot.flags & STRING_SLOT_FREE)
+      ? NULL
+      : (char*)(slot.ptr - ctxt->string_chunks[slot.chunk].bytes);
+    image_write(&w, &slot, sizeof(slot));
+  }
+
+  /* symbol table */
+  image_write(&w, ctxt->symbol_table, ctxt->symbol_table_limit * sizeof(symbol_entry_t));
+
+  /* native table - an offset, the arity, the prim and purity for each */
+  for (int i = 0; i < ctxt->native_proc_count; i++) {
+    native_proc_t native = ctxt->native_procs[i];
+    int64_t offset = (intptr_t)native.fn - (intptr_t)&alloc_context;
+    int32_t prim   = native.prim;
+    int32_t pure   = native.pure;
+    image_write(&w, &offset, sizeof(offset));
+    image_write(&w, &native.min, sizeof(native.min));
+    image_write(&w, &native.max, sizeof(native.max));
+    image_write(&w, &prim, sizeof(prim));
+    image_write(&w, &pure, sizeof(pure));
+  }
+
+  /* globals */
+  image_align(&w);
+  for (int i = 0; i < ctxt->globals.size; i++) {
+    image_write_value(ctxt, &w, ctxt->globals.values[i], false);
+  }
+
+  /* vectors - size, then elements */
+  for (int i = 0; i < w.vector_count; i++) {
+    uint64_t size = w.vectors[i]->size;
+    image_write(&w, &size, sizeof(size));
+
+    value_t *elements = (value_t*)(w.vectors[i] + 1);
+    for (uint64_t j = 0; j < size; j++) {
+      image_write_value(ctxt, &w, elements[j], false);
+    }
+  }
+
+  /* relocation table */
+  image_write(&w, w.relocs, w.reloc_count * sizeof(uint64_t));
+
+  header.reloc_count = w.reloc_count;
+  header.size        = w.at;
+  fseek(file, 0, SEEK_SET);
+  fwrite(&header, sizeof(header), 1, file);
+
+  bool ok = !ferror(file);
+  ok = (fclose(file) == 0) && ok;
+
+  free(w.vectors);
+  free(w.relocs);
+  return ok;
+}
+
+static void* image_take(char *base, size_t *at, size_t len) {
+  *at = (*at + 7) & ~(size_t)7;
+  void *ptr = base + *at;
+  *at += len;
+  return ptr;
+}
+
+inline static value_t image_relocate(context_p ctxt, vector_header_t **vectors, value_t v) {
+  if (is_pointer(PTR_VECTOR, v)) {
+    return make_pointer(ctxt, PTR_VECTOR, vectors[(uintptr_t)pointer_addr(v)]);
+  }
+
+  return v;
+}
+
+// answers NULL if the file isn't an image this binary wrote
+context_p load_image(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(fileno(file), &st) < 0 || (size_t)st.st_size < sizeof(image_header_t)) {
+    fclose(file);
+    return NULL;
+  }
+
+  char *base = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(file), 0);
+  fclose(file);
+  if (base == MAP_FAILED) {
+    return NULL;
+  }
+
+  image_header_t *header = (image_header_t*)base;
+  if (memcmp(header->magic, IMAGE_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != IMAGE_VERSION ||
+      header->anchor  != image_anchor() ||
+      header->size    != (uint64_t)st.st_size) {
+    munmap(base, st.st_size);
+    return NULL;
+  }
+
+  context_p ctxt = alloc_empty_context();
+  ctxt->image_base = base;
+  ctxt->image_size = st.st_size;
+
+  size_t at = sizeof(image_header_t);
+
+  /* cons pool - cells are used in place, the bitmaps start clear */
+  int cells = header->segment_cells;
+  int words = (cells + 63) / 64;
+
+  ctxt->cons_segment_cells = cells;
+  ctxt->cons_segment_count = header->segment_count;
+  ctxt->cons_segment_limit = header->segment_count;
+  ctxt->cons_segments      = malloc(header->segment_count * sizeof(cons_segment_t));
+  ctxt->cons_nursery       = header->nursery;
+  ctxt->cons_tenured       = header->tenured;
+  ctxt->cons_free_count    = header->free_count;
+  ctxt->cons_free_list     = header->free_list;
+  if (ctxt->cons_segments == NULL) {
+    fprintf(stderr, "out of memory!\n");
+    exit(1);
+  }
+
+  int32_t *sizes = image_take(base, &at, header->segment_count * sizeof(int32_t));
+
+  for (int id = 0; id < header->segment_count; id++) {
+    uint64_t *marks = malloc(words * sizeof(uint64_t) * 2);
+    if (marks == NULL) {
+      fprintf(stderr, "out of memory!\n");
+      exit(1);
+    }
+    memset(marks, 0x00, words * sizeof(uint64_t) * 2);
+
+    cons_segment_t *seg = &ctxt->cons_segments[id];
+    seg->size       = sizes[id];
+    seg->cells      = image_take(base, &at, cells * 2 * sizeof(value_t));
+    seg->marks      = marks;
+    seg->remembered = marks + words;
+  }
+
+  /* string pool - chunks are used in place, but they're full */
+  int count = header->string_chunk_count;
+  sizes = image_take(base, &at, count * sizeof(int32_t));
+
+  ctxt->string_chunk_count = count;
+  ctxt->string_chunk_limit = count;
+  ctxt->string_chunks      = count ? malloc(count * sizeof(string_chunk_t)) : NULL;
+  if (count && ctxt->string_chunks == NULL) {
+    fprintf(stderr, "out of memory!\n");
+    exit(1);
+  }
+
+  for (int i = 0; i < count; i++) {
+    string_chunk_t *chunk = &ctxt->string_chunks[i];
+    chunk->size  = sizes[i];
+    chunk->limit = sizes[i];
+    chunk->bytes = image_take(base, &at, sizes[i]);
+  }
+
+  count = header->string_slot_count;
+  ctxt->string_slot_count = count;
+  ctxt->string_slot_limit = count;
+  ctxt->string_slots      = count ? malloc(count * sizeof(string_slot_t)) : NULL;
+  if (count && ctxt->string_slots == NULL) {
+    fprintf(stderr, "out of memory!\n");
+    exit(1);
+  }
+  memcpy(ctxt->string_slots, image_take(base, &at, count * sizeof(string_slot_t)), count * sizeof(string_slot_t));
+
+  for (int i = 0; i < count; i++) {
+    string_slot_t *slot = &ctxt->string_slots[i];
+    if (!(slot->flags & STRING_SLOT_FREE)) {
+      slot->ptr = ctxt->string_chunks[slot->chunk].bytes + (uintptr_t)slot->ptr;
+    }
+  }
+
+  ctxt->string_free_slot  = header->string_free_slot;
+  ctxt->string_bytes_live = header->string_bytes_live;
+
+  /* symbol table */
+  int size = header->symbol_table_limit * sizeof(symbol_entry_t);
+  ctxt->symbol_table_size  = header->symbol_table_size;
+  ctxt->symbol_table_limit = header->symbol_table_limit;
+  ctxt->symbol_table       = malloc(size);
+  if (ctxt->symbol_table == NULL) {
+    fprintf(stderr, "out of memory!\n");
+    exit(1);
+  }
+  memcpy(ctxt->symbol_table, image_take(base, &at, size), size);
+
+  /* native table */
+  count = header->native_proc_count;
+  char *natives = image_take(base, &at, count * (sizeof(int64_t) + 4 * sizeof(int32_t)));
+
+  ctxt->native_proc_count = count;
+  ctxt->native_proc_limit = count;
+  ctxt->native_procs      = count ? malloc(count * sizeof(native_proc_t)) : NULL;
+  if (count && ctxt->native_procs == NULL) {
+    fprintf(stderr, "out of memory!\n");
+    exit(1);
+  }
+
+  for (int i = 0; i < count; i++) {
+    int64_t offset;
+    native_proc_t *native = &ctxt->native_procs[i];
+    memcpy(&offset,      natives,      sizeof(offset));
+    memcpy(&native->min, natives + 8,  sizeof(native->min));
+    memcpy(&native->max, natives + 12, sizeof(native->max));
+    int32_t prim, pure;
+    memcpy(&prim, natives + 16, sizeof(prim));
+    memcpy(&pure, natives + 20, sizeof(pure));
+    native->prim = (prim_t)prim;
+    native->pure = pure;
+    native->fn   = (native_proc_fn)((intptr_t)&alloc_context + offset);
+    natives += 24;
+  }
+
+  /* globals - relocated along with the vectors */
+  count = header->global_count;
+  value_t *globals = image_take(base, &at, count * sizeof(value_t));
+
+  /* vectors - allocate them all, then fill them in */
+  count = header->vector_count;
+  vector_header_t **vectors = malloc((count ? count : 1) * sizeof(vector_header_t*));
+  if (vectors == NULL) {
+    fprintf(stderr, "out of memory!\n");
+    exit(1);
+  }
+
+  size_t first = at;
+  for (int i = 0; i < count; i++) {
+    uint64_t length = *(uint64_t*)image_take(base, &at, sizeof(uint64_t));
+    image_take(base, &at, length * sizeof(value_t));
+    vectors[i] = alloc_vector(ctxt, length);
+  }
+
+  at = first;
+  for (int i = 0; i < count; i++) {
+    uint64_t length = *(uint64_t*)image_take(base, &at, sizeof(uint64_t));
+    value_t *from = image_take(base, &at, length * sizeof(value_t));
+    value_t *to   = (value_t*)(vectors[i] + 1);
+
+    for (uint64_t j = 0; j < length; j++) {
+      to[j] = image_relocate(ctxt, vectors, from[j]);
+    }
+  }
+
+  ctxt->vector_bytes_live      = ctxt->vector_bytes_allocated;
+  ctxt->vector_bytes_allocated = 0;
+
+  /* relocation table - only the cells holding vectors get touched */
+  uint64_t *relocs = image_take(base, &at, header->reloc_count * sizeof(uint64_t));
+  for (int i = 0; i < header->reloc_count; i++) {
+    value_t *slot = (value_t*)(base + relocs[i]);
+    *slot = image_relocate(ctxt, vectors, *slot);
+  }
+  for (int i = 0; i < header->global_count; i++) {
+    gc_push(&ctxt->globals, image_relocate(ctxt, vectors, globals[i]));
+  }
+  free(vectors);
+
+  /* environments */
+  ctxt->root_env = header->root_env;
+  ctxt->curr_env = header->curr_env;
+
+  intern_known_symbols(ctxt);
+
+  return ctxt;
+}
+
 /* conversions */
 
 value_t to_integer(context_p ctxt, value_t v) {
@@ -547,19 +2864,30 @@ value_t to_integer(context_p ctxt, value_t v) {
   }
 
   if (is_double(ctxt, v)) {
-    return make_integer(ctxt, round(as_double(ctxt, v)));
+    double d = round(as_double(ctxt, v));
+    if (!(fabs(d) < 0x1p63)) {
+      return make_error(ctxt, __LINE__);
+    }
+    return make_exact(ctxt, (int64_t)d);
   }
 
+  // leading digits, like atoi
   if (is_string(ctxt, v)) {
-    uint32_t num = atoi(string_ptr(ctxt, v));
-    return make_integer(ctxt, num);
+    char *str  = string_ptr(ctxt, v);
+    uint32_t n = string_len(ctxt, v);
+    bool minus = n > 0 && str[0] == '-';
+    uint32_t len = 0;
+    while (minus + len < n && str[minus + len] >= '0' && str[minus + len] <= '9') {
+      len++;
+    }
+    return exact_parse(ctxt, str + minus, len, minus);
   }
 
   return make_error(ctxt, __LINE__);
 }
 
 value_t to_character(context_p ctxt, value_t v) {
-  if (is_integer(ctxt, v) && (as_integer(ctxt, v) < 256)) {
+  if (is_integer(ctxt, v) && as_integer(ctxt, v) >= 0 && as_integer(ctxt, v) < 256) {
     return reshape_box(ctxt, v, BOX_CHARACTER);
   }
 
@@ -567,17 +2895,25 @@ value_t to_character(context_p ctxt, value_t v) {
 }
 
 value_t to_string(context_p ctxt, value_t v) {
+  // the symbol's own slot; neither is ever written to
   if (is_symbol(ctxt, v)) {
-    value_t sym = environment_get(ctxt, v, ctxt->curr_env);
-    return reshape_handle(ctxt, sym, HND_STRING);
+    return reshape_handle(ctxt, v, HND_STRING);
   }
 
   if (is_integer(ctxt, v)) {
     char buffer[256];
-    int len = sprintf(buffer, "%d", as_integer(ctxt, v));
+    int len = sprintf(buffer, "%" PRId64, as_integer(ctxt, v));
     return make_string(ctxt, buffer, len);
   }
 
+  if (is_bignum(ctxt, v)) {
+    int len;
+    char *digits = exact_format(ctxt, v, &len);
+    value_t str = make_string(ctxt, digits, len);
+    free(digits);
+    return str;
+  }
+
   if (is_double(ctxt, v)) {
     char buffer[256];
     int len = sprintf(buffer, "%lf", as_double(ctxt, v));
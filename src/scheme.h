@@ -2,6 +2,7 @@
 #define __scheme_h
 
 #include <stdio.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -12,16 +13,212 @@ typedef union value {
   uint64_t as_uint64;
 } value_t;
 
+struct context;
+// args arrive evaluated, argc of them in argv; argv is on the eval stack,
+// so it's a gc root, but it's the caller's and isn't to be kept
+typedef value_t (*native_proc_fn)(struct context*, int argc, value_t *argv);
+
+// natives the evaluators open-code when both args are fixnums
+typedef enum {
+  PRIM_NONE,
+  PRIM_ADD,
+  PRIM_SUB,
+  PRIM_MUL,
+  PRIM_EQ,
+  PRIM_LT,
+  PRIM_GT,
+  PRIM_LTE,
+  PRIM_GTE,
+} prim_t;
+
+// a native's entry in the table; max is ARITY_ANY when it takes any number
+typedef struct native_proc {
+  native_proc_fn fn;
+  int32_t min;
+  int32_t max;
+  prim_t  prim;
+  bool    pure; // no effects, and the same answer for the same args
+} native_proc_t;
+
+#define ARITY_ANY -1
+
+typedef struct value_stack {
+  int size;
+  int limit;
+  value_t *values;
+} value_stack_t;
+
+// sweeping goes a kind of object at a time, then the string chunks are
+// compacted (if they need it) and slices repointed at the moved bytes
+typedef enum {
+  GC_IDLE = 0,
+  GC_MARKING,
+  GC_SWEEPING,
+  GC_SWEEPING_VECTORS,
+  GC_SWEEPING_BUFFERS,
+  GC_SWEEPING_STRINGS,
+  GC_COMPACTING,
+  GC_REPOINTING,
+} gc_phase_t;
+
+typedef struct cons_segment {
+  int size;
+  value_t *cells;
+  uint64_t *marks;
+  uint64_t *remembered;
+} cons_segment_t;
+
+typedef struct string_chunk {
+  int size;
+  int limit;
+  char *bytes;
+} string_chunk_t;
+
+typedef struct string_slot {
+  char *ptr;
+  uint32_t len;
+  uint16_t chunk;
+  uint16_t flags;
+  uint32_t base;   // the slot a slice's bytes belong to, otherwise its own
+  uint32_t offset; // where a slice starts in its base's bytes
+} string_slot_t;
+
+typedef struct symbol_entry {
+  uint64_t hash;
+  value_t symbol;
+  int32_t global; // index into ctxt->globals, or -1
+} symbol_entry_t;
+
+#define VECTOR_CLASSES 8
+
+typedef struct vector_header {
+  uint32_t size;
+  uint16_t sclass;
+  uint16_t flags;
+  struct vector_header *next;
+} vector_header_t;
+
+// the bytes behind a buffer, shared by every slice cut from it
+typedef struct buffer_store {
+  size_t size;
+  uint16_t flags;
+  struct buffer_store *next;
+  char bytes[];
+} buffer_store_t;
+
+// a buffer is a window onto a store
+typedef struct buffer_header {
+  buffer_store_t *store;
+  size_t offset;
+  size_t length;
+  uint16_t flags;
+  struct buffer_header *next;
+} buffer_header_t;
+
+typedef struct vector_slab {
+  int sclass;
+  int slots;
+  char *bytes;
+  struct vector_slab *next;
+} vector_slab_t;
+
+typedef struct context_stats {
+  uint64_t cells_allocated;   // conses ever, nursery included
+  uint64_t cells_in_use;      // allocated and not yet freed, live or not
+  uint64_t cells_live;        // as of the last major collection, 0 before one
+  uint64_t cells_capacity;
+  uint64_t strings_allocated; // string pool slots ever: strings, symbols, bignums...
+  uint64_t string_count;      // these counts are of what's there now
+  uint64_t string_bytes;
+  uint64_t symbol_count;
+  uint64_t symbol_bytes;
+  uint64_t vectors_allocated; // ever
+  uint64_t vector_count;
+  uint64_t vector_bytes;
+  uint64_t buffers_allocated; // ever, slices included
+  uint64_t buffer_count;
+  uint64_t buffer_bytes;      // of their stores, counted once however sliced
+  uint64_t symbol_table_limit;
+  uint64_t symbol_probe_max;  // longest distance from an entry's home slot
+  uint64_t gc_minor_count;
+  uint64_t gc_major_count;    // completed cycles
+  uint64_t gc_pause_total;    // nanoseconds
+  uint64_t gc_pause_max;
+} context_stats_t;
+
 typedef struct context {
-  int cons_pool_size;
-  int cons_pool_limit;
-  value_t *cons_pool_ptr;
+  int cons_segment_cells;
+  int cons_segment_count;
+  int cons_segment_limit;
+  cons_segment_t *cons_segments;
+  int cons_nursery;
+  int cons_tenured;
+  int cons_free_count;
   value_t cons_free_list;
-  int symbol_pool_size;
-  value_t *symbol_pool_ptr;
-  int string_buffer_limit;
-  int string_buffer_offset;
-  char *string_buffer_ptr;
+  uint64_t cons_allocated;
+  value_stack_t gc_scan;
+  value_stack_t gc_gray;
+  value_stack_t gc_remembered;
+  gc_phase_t gc_phase;
+  int gc_step_work;
+  uint64_t gc_cells_live;
+  uint64_t gc_minor_count;
+  uint64_t gc_major_count;
+  uint64_t gc_pause_total;
+  uint64_t gc_pause_max;
+  int gc_root_symbol; // how far marking's scanned the big roots
+  int gc_root_global;
+  int gc_root_stack;
+  int gc_sweep_segment;
+  int gc_sweep_index;
+  int gc_sweep_limit;  // segments and string slots there were to sweep
+  int gc_sweep_slots;
+  size_t gc_sweep_live;
+  vector_slab_t *gc_sweep_slab;
+  vector_header_t *gc_sweep_large;
+  buffer_header_t *gc_sweep_buffers;
+  buffer_store_t *gc_sweep_stores;
+  int gc_old_chunk_count; // string chunks being compacted out of
+  string_chunk_t *gc_old_chunks;
+  int gc_root_count;
+  int gc_root_limit;
+  value_t **gc_roots;
+  int symbol_table_size;
+  int symbol_table_limit;
+  symbol_entry_t *symbol_table;
+  int string_chunk_count;
+  int string_chunk_limit;
+  string_chunk_t *string_chunks;
+  int string_slot_count;
+  int string_slot_limit;
+  string_slot_t *string_slots;
+  int string_free_slot;
+  int string_bytes_live;
+  int string_bytes_allocated;
+  uint64_t strings_allocated;
+  vector_slab_t *vector_slabs;
+  vector_header_t *vector_free[VECTOR_CLASSES];
+  vector_header_t *vector_large;
+  int vector_bytes_live;
+  int vector_bytes_allocated;
+  uint64_t vectors_allocated;
+  buffer_header_t *buffers;
+  buffer_store_t *buffer_stores;
+  size_t buffer_bytes_live;
+  size_t buffer_bytes_allocated;
+  uint64_t buffers_allocated;
+  int native_proc_count;
+  int native_proc_limit;
+  native_proc_t *native_procs;
+  value_stack_t globals;
+  value_stack_t eval_stack;
+  int eval_stack_max;
+  int eval_stack_clean;
+  struct jit *jit;
+  int jit_threshold;
+  value_t known; // what the optimizer's assumed about globals
+  void *image_base;
+  size_t image_size;
   value_t root_env;
   value_t curr_env;
 } context_t;
@@ -33,6 +230,7 @@ typedef enum {
   PTR_MALLOC,
   PTR_VECTOR,
   PTR_NATIVE_PROC,
+  PTR_BUFFER,
 } ptr_type_t;
 
 typedef enum {
@@ -41,6 +239,8 @@ typedef enum {
   HND_SYMBOL,
   HND_STRING,
   HND_PROC,
+  HND_BIGNUM,
+  HND_NUMVEC,
 } hnd_type_t;
 
 typedef enum {
@@ -63,6 +263,7 @@ typedef union box_data {
 
 context_p alloc_context(int initial_size);
 value_t   enhance_native_environment(context_p ctxt);
+value_t   eq_native(context_p ctxt);
 value_t   enhance_scheme_environment(context_p ctxt);
 
 #define vnan   ((value_t)((uint64_t)0x7FF0000000000001LL))
@@ -82,14 +283,88 @@ extern value_t symquote;
 
 /* the machine */
 context_p  alloc_context(int);
+void       collect_garbage(context_p);
+void       context_stats(context_p, context_stats_t *stats);
+
+/* precise roots; a c local holding a value across anything that might
+   allocate has to be registered, since young cells move */
+int        gc_root_frame(context_p);
+void       gc_root(context_p, value_t *slot);
+void       gc_unroot(context_p, int frame);
+
+bool       save_image(context_p, const char *path);
+context_p  load_image(const char *path);
 
 value_t    read(context_p, FILE*);
+bool       read_done(FILE*);
+value_t    analyze(context_p, value_t v);
+value_t    lambda_names(context_p, value_t lambda, int *params);
+value_t    collect_defines(context_p, value_t v, value_t names);
+bool       has_lambda(context_p, value_t v);
+value_t    optimize(context_p, value_t v);
 value_t    eval(context_p, value_t v, value_t *inoutenv);
+value_t    vm_eval(context_p, value_t v, value_t *inoutenv);
+bool       eval_reserve(context_p, int n); // the stack eval and the vm share
 void       print(context_p, value_t);
 
 value_t    environment_get(context_p, value_t env, value_t key);
 value_t    environment_set(context_p, value_t env, value_t key, value_t val);
 
+/* the vm, see vm.c */
+typedef enum {
+  OP_CONST,     // k          push consts[k]
+  OP_LOCAL,     // i          push stack slot i
+  OP_FRAME,     // d | i<<16  push slot i of the heap frame d out
+  OP_GLOBAL,    // g          push global g
+  OP_SETLOCAL,  // i          store the top in stack slot i, leaving nil
+  OP_SETFRAME,  // i          store the top in heap slot i, leaving nil
+  OP_DEFGLOBAL, // g          store the top in global g, leaving nil
+  OP_POP,
+  OP_JUMP,      // pc
+  OP_JUMPF,     // pc         pop, and jump if it's false
+  OP_CLOSURE,   // k          push a proc for the template consts[k]
+  OP_CALL,      // argc
+  OP_TAILCALL,  // argc
+  OP_PRIM,      // p | tail<<8  the prim p on two args, if it's still the operator
+  OP_RETURN,
+  OP_COUNT
+} opcode_t;
+
+// a template's fields
+enum {
+  T_CODE,
+  T_PARAMS,
+  T_SLOTS,
+  T_HEAP,
+  T_DEPTH,
+  T_CALLS,
+  T_JIT,
+  T_CONSTS
+};
+
+/* the jit, see jit.c; the vm's registers while machine code runs */
+typedef struct jit_state {
+  context_p ctxt;
+  value_t  *sp;      // the eval stack's next free slot
+  value_t  *fp;      // the frame's first slot
+  value_t  *consts;
+  value_t  *globals;
+  value_t  *env;     // the vm's env register, a gc root
+  uint32_t  pc;      // where the vm carries on, or JIT_RETURN
+} jit_state_t;
+
+#define JIT_RETURN UINT32_MAX
+
+bool       jit_compile(context_p, value_t tmpl);
+bool       jit_enter(context_p, value_t tmpl, jit_state_t *state, uint32_t pc);
+void       jit_sweep(context_p);
+
+/* globals; a symbol's cell is looked up once, then used by index */
+int        global_index(context_p, value_t sym);
+value_t    global_get(context_p, int index);
+void       global_set(context_p, int index, value_t val);
+void       global_define(context_p, value_t sym, value_t val);
+
 /* conversions */
 value_t    to_integer(context_p, value_t);
 value_t    to_character(context_p, value_t);
@@ -121,9 +396,34 @@ bool       is_nan(context_p, value_t);
 bool       is_inf(context_p, value_t);
 
 /* ints */
-value_t    make_integer(context_p, uint32_t);
+/* fixnums; make_integer's value has to be in range */
+#define FIXNUM_BITS 48
+#define FIXNUM_MAX  (((int64_t)1 << (FIXNUM_BITS - 1)) - 1)
+#define FIXNUM_MIN  (-((int64_t)1 << (FIXNUM_BITS - 1)))
+
+value_t    make_integer(context_p, int64_t);
 bool       is_integer(context_p, value_t);
-uint32_t   as_integer(context_p, value_t);
+int64_t    as_integer(context_p, value_t);
+
+/* bignums, exact integers outside fixnum range, see bignum.c; the
+   limbs move when the string pool's compacted, which any allocation
+   can do, so not across any allocation */
+value_t    make_bignum(context_p, bool negative, const uint64_t *limbs, int size);
+bool       is_bignum(context_p, value_t);
+bool       bignum_negative(context_p, value_t);
+int        bignum_size(context_p, value_t);
+uint64_t*  bignum_limbs(context_p, value_t);
+
+bool       is_exact(context_p, value_t);
+value_t    make_exact(context_p, int64_t);
+value_t    exact_add(context_p, value_t a, value_t b);
+value_t    exact_sub(context_p, value_t a, value_t b);
+value_t    exact_mul(context_p, value_t a, value_t b);
+void       exact_divide(context_p, value_t a, value_t b, value_t *quotient, value_t *remainder); // truncating, b != 0
+int        exact_compare(context_p, value_t a, value_t b);
+double     exact_double(context_p, value_t);
+value_t    exact_parse(context_p, const char *digits, int len, bool negative);
+char*      exact_format(context_p, value_t, int *len); // malloc'd
 
 /* floats */
 value_t    make_float(context_p, float);
@@ -135,8 +435,10 @@ value_t    make_character(context_p, char);
 bool       is_character(context_p, value_t);
 char       as_character(context_p, value_t);
 
-/* strings */
+/* strings; the bytes aren't terminated, and move when the string pool's
+   compacted, which any allocation can do, so not across any allocation */
 value_t    make_string(context_p, char*, int);
+value_t    make_substring(context_p, value_t str, int64_t start, int64_t end); // shares str's bytes
 bool       is_string(context_p, value_t);
 char*      string_ptr(context_p, value_t);
 uint32_t   string_len(context_p, value_t);
@@ -172,18 +474,61 @@ void       cons_set_cdr(context_p, value_t pair, value_t val);
 #define cons_set_cdar(ctxt, hnd, v) cons_set_cdr(ctxt, cons_car(ctxt, hnd), v)
 #define cons_set_cddr(ctxt, hnd, v) cons_set_cdr(ctxt, cons_cdr(ctxt, hnd), v)
 
-/* buffers */
-value_t    make_buffer(context_p, int size, char fill);
+/* buffers, byte slices; a slice shares its bytes with the buffer it was
+   cut from, and they never move. see buffer.c */
+value_t    make_buffer(context_p, int64_t size, char fill);
 bool       is_buffer(context_p, value_t v);
+uint64_t   buffer_length(context_p, value_t v);
+char*      buffer_data(context_p, value_t v); // unchecked
+value_t    buffer_slice(context_p, value_t v, int64_t start, int64_t end);
+
+value_t    buffer_get(context_p, value_t v, int64_t index);
+value_t    buffer_set(context_p, value_t v, int64_t index, value_t byte);
+value_t    buffer_fill(context_p, value_t v, value_t byte);
+value_t    buffer_copy(context_p, value_t to, int64_t at, value_t from);
+value_t    buffer_index(context_p, value_t v, value_t byte, int64_t start);
+value_t    buffer_compare(context_p, value_t a, value_t b);
+value_t    buffer_read_file(context_p, const char *path);
+value_t    buffer_write_file(context_p, const char *path, value_t v, bool append);
 
 /* vectors */
 value_t    make_vector(context_p, int size, value_t fill);
 bool       is_vector(context_p, value_t v);
+uint32_t   vector_size(context_p, value_t v);
+value_t    vector_get(context_p, value_t v, int index);
+value_t    vector_set(context_p, value_t v, int index, value_t val);
+value_t*   vector_data(context_p, value_t v); // unchecked, read only
+bool       vector_marked(context_p, value_t v); // by the major that's marking
+
+/* numeric vectors, unboxed elements in the string pool; their data moves
+   when the pool's compacted, which any allocation can do, so not across
+   any allocation. see numvec.c */
+typedef enum {
+  NUMVEC_U8,
+  NUMVEC_S32,
+  NUMVEC_F64,
+} numvec_type_t;
+
+value_t    make_numvec(context_p, numvec_type_t type, int64_t count); // zeroed
+bool       is_numvec(context_p, value_t v);
+numvec_type_t numvec_type(context_p, value_t v);
+uint32_t   numvec_count(context_p, value_t v);
+uint32_t   numvec_bytes(context_p, value_t v);
+void*      numvec_data(context_p, value_t v); // unchecked
+
+value_t    numvec_get(context_p, value_t v, int64_t index);
+value_t    numvec_set(context_p, value_t v, int64_t index, value_t x);
+value_t    numvec_fill(context_p, value_t v, value_t x);
+value_t    numvec_copy(context_p, value_t to, value_t from);
+value_t    numvec_sum(context_p, value_t v);
+value_t    numvec_dot(context_p, value_t a, value_t b);
+value_t    numvec_scale(context_p, value_t v, value_t k); // v *= k
+value_t    numvec_add(context_p, value_t a, value_t b);   // a += b
+value_t    numvec_min(context_p, value_t v);
+value_t    numvec_max(context_p, value_t v);
 
 /* procs */
 
-typedef value_t (*native_proc_fn)(context_p, value_t args, value_t env);
-
 bool       is_proc(context_p ctxt, value_t v);
 
 value_t    make_compound_proc(context_p, value_t args, value_t body, value_t env);
@@ -192,9 +537,16 @@ value_t    compound_proc_body(context_p, value_t v);
 value_t    compound_proc_args(context_p, value_t v);
 value_t    compound_proc_env(context_p, value_t v);
 
-value_t    make_native_proc(context_p, native_proc_fn fn);
+value_t    make_native_proc(context_p, native_proc_fn fn, int min, int max);
+value_t    native_proc_at(context_p, int index);
 bool       is_native_proc(context_p, value_t v);
 
 native_proc_fn native_proc_function(context_p, value_t v);
+bool       native_proc_accepts(context_p, value_t v, int argc);
+prim_t     native_proc_prim(context_p, value_t v);
+void       native_proc_set_prim(context_p, value_t v, prim_t prim);
+bool       native_proc_pure(context_p, value_t v);
+void       native_proc_set_pure(context_p, value_t v, bool pure);
+bool       prim_numbers(context_p, prim_t prim, value_t a, value_t b, value_t *out);
 
 #endif
@@ -0,0 +1,771 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "scheme.h"
+
+/*
+  the vm is another way to run an expression: it's compiled, once, to
+  bytecode for a stack machine. the variables resolve the same as they
+  do for eval, and the globals are the same cells.
+
+  a compiled procedure is a template, a vector of
+
+    code       a vector of instructions
+    params     how many args it takes
+    slots      its params, then whatever its body defines
+    heap       whether the slots are in a heap frame
+    depth      the most its expression stack grows
+    calls      how many times it's been entered, until it's jitted
+    jit        its code in the jit's table, plus one; 0 for none yet
+    consts...  quoted values, and the templates of nested lambdas
+
+  and a closure is a compound proc with a template for its args and the
+  env it was made in. an instruction is an integer, an opcode in the low
+  byte and a 32 bit operand above it, so code never moves or needs
+  tracing. an operand that won't fit its field fails the compile, and
+  the form answers an error rather than running with it cut short.
+
+  a procedure runs with its args on ctxt->eval_stack, just above the proc
+  itself. if its body makes no closures, the rest of its slots go on
+  the stack after them; otherwise the slots are copied into a heap
+  frame, [parent, slot1...] like eval's, that closures can keep hold of,
+  and its locals are found by following parents. over the slots are the
+  caller's pc, fp, env and template, to return to, then the expression
+  stack. a tail call slides the new proc and args down over the frame
+  and keeps the caller's return record.
+*/
+
+// a return record: the caller's pc, fp, env and template
+#define RETURN_SIZE 4
+
+/* the compiler */
+
+/*
+  the scope is a list of frames, innermost first, and each frame is
+  (heap . names), the names in slot order
+*/
+
+typedef struct compiler {
+  context_p ctxt;
+  uint64_t *code;
+  int       size;
+  int       limit;
+  value_t   consts; // newest first
+  int       count;
+  value_t   scope;
+  int       depth;
+  int       max_depth;
+  bool      failed; // something didn't fit, here or in a nested lambda
+} compiler_t;
+
+// arg, if it fits in bits; otherwise the compile's failed
+static uint32_t operand(compiler_t *c, int64_t arg, int bits) {
+  if (arg < 0 || arg >= (int64_t)1 << bits) {
+    c->failed = true;
+    return 0;
+  }
+  return (uint32_t)arg;
+}
+
+static void emit(compiler_t *c, opcode_t op, int64_t arg, int effect) {
+  if (c->size == c->limit) {
+    c->limit = c->limit ? c->limit * 2 : 32;
+    c->code  = realloc(c->code, c->limit * sizeof(uint64_t));
+    if (c->code == NULL) {
+      fprintf(stderr, "out of memory!\n");
+      exit(1);
+    }
+  }
+
+  c->code[c->size++] = op | (uint64_t)operand(c, arg, 32) << 8;
+  c->depth += effect;
+  if (c->depth > c->max_depth) {
+    c->max_depth = c->depth;
+  }
+}
+
+static void patch(compiler_t *c, int at, int64_t arg) {
+  c->code[at] = (c->code[at] & 0xFF) | (uint64_t)operand(c, arg, 32) << 8;
+}
+
+static int add_const(compiler_t *c, value_t v) {
+  int index = c->count - 1;
+  for (value_t cursor = c->consts; !is_nil(c->ctxt, cursor); cursor = cons_cdr(c->ctxt, cursor)) {
+    if (equality_exact(c->ctxt, cons_car(c->ctxt, cursor), v)) {
+      return index;
+    }
+    index--;
+  }
+
+  c->consts = make_cons(c->ctxt, v, c->consts);
+  return c->count++;
+}
+
+// finds sym's frame and slot, or false for a global; the depth only
+// counts heap frames, since those are all there are to follow
+static bool resolve(compiler_t *c, value_t sym, int *depth, int *index, bool *heap) {
+  context_p ctxt = c->ctxt;
+
+  *depth = 0;
+  for (value_t scope = c->scope; !is_nil(ctxt, scope); scope = cons_cdr(ctxt, scope)) {
+    value_t frame = cons_car(ctxt, scope);
+    *heap  = is_truthy(ctxt, cons_car(ctxt, frame));
+    *index = 0;
+    for (value_t names = cons_cdr(ctxt, frame); !is_nil(ctxt, names); names = cons_cdr(ctxt, names)) {
+      if (equality_exact(ctxt, cons_car(ctxt, names), sym)) {
+        return true;
+      }
+      (*index)++;
+    }
+    if (*heap) {
+      (*depth)++;
+    }
+  }
+
+  return false;
+}
+
+// the prim a call can be open-coded as: two args, and an operator that
+// names a global holding one, for now
+static prim_t call_prim(compiler_t *c, value_t v) {
+  context_p ctxt = c->ctxt;
+  value_t op = cons_car(ctxt, v);
+  int depth, index;
+  bool heap;
+
+  if (!is_symbol(ctxt, op) || resolve(c, op, &depth, &index, &heap)) {
+    return PRIM_NONE;
+  }
+
+  value_t args = cons_cdr(ctxt, v);
+  if (!is_cons(ctxt, args) ||
+      !is_cons(ctxt, cons_cdr(ctxt, args)) ||
+      !is_nil(ctxt, cons_cddr(ctxt, args))) {
+    return PRIM_NONE;
+  }
+
+  value_t proc = global_get(ctxt, global_index(ctxt, op));
+  return is_native_proc(ctxt, proc) ? native_proc_prim(ctxt, proc) : PRIM_NONE;
+}
+
+static value_t finish(compiler_t *c, int params, int slots, bool heap) {
+  context_p ctxt = c->ctxt;
+  value_t code = vnil;
+  value_t tmpl = vnil;
+
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &code);
+  gc_root(ctxt, &tmpl);
+
+  code = make_vector(ctxt, c->size, vnil);
+  for (int i = 0; i < c->size; i++) {
+    vector_set(ctxt, code, i, make_integer(ctxt, c->code[i]));
+  }
+
+  tmpl = make_vector(ctxt, T_CONSTS + c->count, vnil);
+  vector_set(ctxt, tmpl, T_CODE,   code);
+  vector_set(ctxt, tmpl, T_PARAMS, make_integer(ctxt, params));
+  vector_set(ctxt, tmpl, T_SLOTS,  make_integer(ctxt, slots));
+  vector_set(ctxt, tmpl, T_HEAP,   heap ? vtrue : vfalse);
+  vector_set(ctxt, tmpl, T_DEPTH,  make_integer(ctxt, c->max_depth));
+  vector_set(ctxt, tmpl, T_CALLS,  make_integer(ctxt, 0));
+  vector_set(ctxt, tmpl, T_JIT,    make_integer(ctxt, 0));
+
+  int index = T_CONSTS + c->count - 1;
+  for (value_t cursor = c->consts; !is_nil(ctxt, cursor); cursor = cons_cdr(ctxt, cursor)) {
+    vector_set(ctxt, tmpl, index--, cons_car(ctxt, cursor));
+  }
+
+  free(c->code);
+  c->code = NULL;
+
+  gc_unroot(ctxt, frame);
+  return tmpl;
+}
+
+static void compile(compiler_t *c, value_t v, bool tail);
+
+static void compile_body(compiler_t *c, value_t body, bool tail) {
+  context_p ctxt = c->ctxt;
+
+  if (is_nil(ctxt, body)) {
+    emit(c, OP_CONST, add_const(c, vnil), 1);
+    if (tail) {
+      emit(c, OP_RETURN, 0, -1);
+    }
+    return;
+  }
+
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &body);
+
+  for (; !is_nil(ctxt, cons_cdr(ctxt, body)); body = cons_cdr(ctxt, body)) {
+    compile(c, cons_car(ctxt, body), false);
+    emit(c, OP_POP, 0, -1);
+  }
+  compile(c, cons_car(ctxt, body), tail);
+
+  gc_unroot(ctxt, frame);
+}
+
+static value_t compile_lambda(compiler_t *outer, value_t v) {
+  context_p ctxt = outer->ctxt;
+  compiler_t c = { ctxt, NULL, 0, 0, vnil, 0, vnil, 0, 0, false };
+  value_t names = vnil;
+
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &v);
+  gc_root(ctxt, &names);
+  gc_root(ctxt, &c.consts);
+  gc_root(ctxt, &c.scope);
+
+  int params;
+  names = lambda_names(ctxt, v, &params);
+
+  int slots = 0;
+  for (value_t cursor = names; !is_nil(ctxt, cursor); cursor = cons_cdr(ctxt, cursor)) {
+    slots++;
+  }
+
+  bool heap = has_lambda(ctxt, cons_cddr(ctxt, v));
+  c.scope = make_cons(ctxt, heap ? vtrue : vfalse, names);
+  c.scope = make_cons(ctxt, c.scope, outer->scope);
+
+  compile_body(&c, cons_cddr(ctxt, v), true);
+  value_t tmpl = finish(&c, params, slots, heap);
+  outer->failed |= c.failed;
+
+  gc_unroot(ctxt, frame);
+  return tmpl;
+}
+
+static void compile(compiler_t *c, value_t v, bool tail) {
+  context_p ctxt = c->ctxt;
+  value_t car = vnil;
+  int depth, index;
+  bool heap;
+
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &v);
+  gc_root(ctxt, &car);
+
+  if (is_nil(ctxt, v)) {
+    emit(c, OP_CONST, add_const(c, v), 1);
+    goto value;
+  }
+
+  /* atoms */
+  if (is_atom(ctxt, v)) {
+    if (is_symbol(ctxt, v)) {
+      if (!resolve(c, v, &depth, &index, &heap)) {
+        emit(c, OP_GLOBAL, global_index(ctxt, v), 1);
+      }
+      else if (heap) {
+        emit(c, OP_FRAME, operand(c, depth, 16) | operand(c, index + 1, 16) << 16, 1);
+      }
+      else {
+        emit(c, OP_LOCAL, index, 1);
+      }
+      goto value;
+    }
+
+    if (is_exact(ctxt, v)     ||
+        is_character(ctxt, v) ||
+        is_float(ctxt, v)     ||
+        is_double(ctxt, v)    ||
+        is_string(ctxt, v)    ||
+        is_boolean(ctxt, v)) {
+      emit(c, OP_CONST, add_const(c, v), 1);
+      goto value;
+    }
+
+    fprintf(stderr, "this object isn't handled currently\n");
+    emit(c, OP_CONST, add_const(c, vnil), 1);
+    goto value;
+  }
+
+  /* pairs */
+  car = cons_car(ctxt, v);
+
+  // (quote ...)
+  if (equality_exact(ctxt, symquote, car)) {
+    emit(c, OP_CONST, add_const(c, cons_cadr(ctxt, v)), 1);
+    goto value;
+  }
+
+  // (if test then else); in tail position both branches return
+  if (equality_exact(ctxt, symif, car)) {
+    compile(c, cons_cadr(ctxt, v), false);
+    int test = c->size;
+    emit(c, OP_JUMPF, 0, -1);
+
+    compile(c, cons_caddr(ctxt, v), tail);
+    int skip = c->size;
+    if (!tail) {
+      emit(c, OP_JUMP, 0, 0);
+      c->depth--;
+    }
+
+    patch(c, test, c->size);
+    compile(c, cons_cadddr(ctxt, v), tail);
+    if (!tail) {
+      patch(c, skip, c->size);
+    }
+    goto done;
+  }
+
+  // (define name value), into the innermost frame if there is one
+  if (equality_exact(ctxt, symdefine, car)) {
+    compile(c, cons_caddr(ctxt, v), false);
+
+    car = cons_cadr(ctxt, v);
+    if (is_nil(ctxt, c->scope)) {
+      emit(c, OP_DEFGLOBAL, global_index(ctxt, car), 0);
+    }
+    else {
+      resolve(c, car, &depth, &index, &heap);
+      if (heap) {
+        emit(c, OP_SETFRAME, index + 1, 0);
+      }
+      else {
+        emit(c, OP_SETLOCAL, index, 0);
+      }
+    }
+    goto value;
+  }
+
+  // (begin ...)
+  if (equality_exact(ctxt, symbegin, car)) {
+    compile_body(c, cons_cdr(ctxt, v), tail);
+    goto done;
+  }
+
+  // (lambda (vars) body...)
+  if (equality_exact(ctxt, symlambda, car)) {
+    car = compile_lambda(c, v);
+    emit(c, OP_CLOSURE, add_const(c, car), 1);
+    goto value;
+  }
+
+  // otherwise it's an application, operator first
+  prim_t prim = call_prim(c, v);
+  int argc = -1;
+  for (car = v; !is_nil(ctxt, car); car = cons_cdr(ctxt, car)) {
+    compile(c, cons_car(ctxt, car), false);
+    argc++;
+  }
+
+  if (prim != PRIM_NONE) {
+    emit(c, OP_PRIM, operand(c, prim, 8) | tail << 8, -2);
+    goto done;
+  }
+  if (tail) {
+    emit(c, OP_TAILCALL, argc, -argc);
+    goto done;
+  }
+  emit(c, OP_CALL, argc, -argc);
+  goto done;
+
+ value:
+  if (tail) {
+    emit(c, OP_RETURN, 0, -1);
+  }
+
+ done:
+  gc_unroot(ctxt, frame);
+}
+
+/* the machine */
+
+inline static int template_field(context_p ctxt, value_t tmpl, int field) {
+  return as_integer(ctxt, vector_data(ctxt, tmpl)[field]);
+}
+
+// the stack slots a template's frame takes, none when they're on the heap
+inline static int template_slots(context_p ctxt, value_t tmpl) {
+  if (is_truthy(ctxt, vector_data(ctxt, tmpl)[T_HEAP])) {
+    return 0;
+  }
+  return template_field(ctxt, tmpl, T_SLOTS);
+}
+
+// whether proc was made by the vm, rather than eval
+inline static bool is_compiled(context_p ctxt, value_t proc) {
+  if (!is_compound_proc(ctxt, proc)) {
+    return false;
+  }
+
+  value_t tmpl = compound_proc_args(ctxt, proc);
+  return is_vector(ctxt, tmpl) && is_vector(ctxt, vector_data(ctxt, tmpl)[T_CODE]);
+}
+
+inline static void vm_push(value_stack_t *stack, value_t v) {
+  stack->values[stack->size++] = v;
+}
+
+// like eval's, the low water mark has to come down with the stack
+inline static void vm_drop(context_p ctxt, int n) {
+  value_stack_t *stack = &ctxt->eval_stack;
+  stack->size -= n;
+  if (stack->size < ctxt->eval_stack_clean) {
+    ctxt->eval_stack_clean = stack->size;
+  }
+}
+
+inline static void vm_store(context_p ctxt, int index, value_t v) {
+  ctxt->eval_stack.values[index] = v;
+  if (index < ctxt->eval_stack_clean) {
+    ctxt->eval_stack_clean = index;
+  }
+}
+
+/*
+  dispatch is threaded through a table of label addresses, indexed by
+  opcode; the code itself holds opcodes rather than addresses, since it
+  lives in vectors the collector and images see.
+*/
+#define NEXT() do {                             \
+    word = as_integer(ctxt, *pc++);             \
+    goto *dispatch[word & 0xFF];                \
+  } while (0)
+
+#define ARG ((uint32_t)(word >> 8))
+
+static value_t run(context_p ctxt, value_t tmpl, value_t env) {
+  static void *dispatch[OP_COUNT] = {
+    [OP_CONST]     = &&op_const,
+    [OP_LOCAL]     = &&op_local,
+    [OP_FRAME]     = &&op_frame,
+    [OP_GLOBAL]    = &&op_global,
+    [OP_SETLOCAL]  = &&op_setlocal,
+    [OP_SETFRAME]  = &&op_setframe,
+    [OP_DEFGLOBAL] = &&op_defglobal,
+    [OP_POP]       = &&op_pop,
+    [OP_JUMP]      = &&op_jump,
+    [OP_JUMPF]     = &&op_jumpf,
+    [OP_CLOSURE]   = &&op_closure,
+    [OP_CALL]      = &&op_call,
+    [OP_TAILCALL]  = &&op_tailcall,
+    [OP_PRIM]      = &&op_prim,
+    [OP_RETURN]    = &&op_return,
+  };
+
+  value_stack_t *stack = &ctxt->eval_stack;
+  int base = stack->size;
+
+  value_t result = vnil;
+  value_t proc   = vnil;
+  value_t r_env  = vnil;
+  value_t r_tmpl = vnil;
+  int     r_pc   = 0;
+  int     r_fp   = 0;
+  int     argc   = 0;
+
+  // the registers; everything else is on the stack
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &tmpl);
+  gc_root(ctxt, &env);
+  gc_root(ctxt, &result);
+  gc_root(ctxt, &proc);
+  gc_root(ctxt, &r_env);
+  gc_root(ctxt, &r_tmpl);
+
+  value_t *code, *consts, *pc;
+  uint64_t word;
+  int fp, slots;
+
+  jit_state_t st = { .ctxt = ctxt, .env = &env };
+
+  // the top level runs as a call with no proc, that returns to nowhere
+  if (!eval_reserve(ctxt, 1 + RETURN_SIZE + template_field(ctxt, tmpl, T_DEPTH))) {
+    goto overflow;
+  }
+  vm_push(stack, vnil);
+  fp    = stack->size;
+  slots = 0;
+  vm_push(stack, make_integer(ctxt, 0));
+  vm_push(stack, make_integer(ctxt, fp));
+  vm_push(stack, env);
+  vm_push(stack, vnil);
+
+  code   = vector_data(ctxt, vector_data(ctxt, tmpl)[T_CODE]);
+  consts = vector_data(ctxt, tmpl) + T_CONSTS;
+  pc     = code;
+  NEXT();
+
+ op_const:
+  vm_push(stack, consts[ARG]);
+  NEXT();
+
+ op_local:
+  vm_push(stack, stack->values[fp + ARG]);
+  NEXT();
+
+ op_frame: {
+    value_t f = env;
+    for (int depth = ARG & 0xFFFF; depth > 0; depth--) {
+      f = vector_data(ctxt, f)[0];
+    }
+    vm_push(stack, vector_data(ctxt, f)[ARG >> 16]);
+    NEXT();
+  }
+
+ op_global:
+  vm_push(stack, ctxt->globals.values[ARG]);
+  NEXT();
+
+ op_setlocal:
+  vm_store(ctxt, fp + ARG, stack->values[stack->size - 1]);
+  stack->values[stack->size - 1] = vnil;
+  NEXT();
+
+ op_setframe:
+  vector_set(ctxt, env, ARG, stack->values[stack->size - 1]);
+  stack->values[stack->size - 1] = vnil;
+  NEXT();
+
+ op_defglobal:
+  global_set(ctxt, ARG, stack->values[stack->size - 1]);
+  stack->values[stack->size - 1] = vnil;
+  NEXT();
+
+ op_pop:
+  vm_drop(ctxt, 1);
+  NEXT();
+
+ op_jump:
+  pc = code + ARG;
+  NEXT();
+
+ op_jumpf:
+  vm_drop(ctxt, 1);
+  if (!is_truthy(ctxt, stack->values[stack->size])) {
+    pc = code + ARG;
+  }
+  NEXT();
+
+ op_closure:
+  result = make_compound_proc(ctxt, consts[ARG], vnil, env);
+  vm_push(stack, result);
+  NEXT();
+
+ op_call:
+  argc = ARG;
+ call_argc:
+  r_pc   = pc - code;
+  r_fp   = fp;
+  r_env  = env;
+  r_tmpl = tmpl;
+  goto call;
+
+ op_tailcall:
+  argc = ARG;
+ tailcall_argc: {
+    value_t *record = stack->values + fp + slots;
+    r_pc   = as_integer(ctxt, record[0]);
+    r_fp   = as_integer(ctxt, record[1]);
+    r_env  = record[2];
+    r_tmpl = record[3];
+
+    // the proc and args go where this frame's proc was
+    int from = stack->size - argc - 1;
+    for (int i = 0; i <= argc; i++) {
+      stack->values[fp - 1 + i] = stack->values[from + i];
+    }
+    stack->size = fp + argc;
+    if (fp - 1 < ctxt->eval_stack_clean) {
+      ctxt->eval_stack_clean = fp - 1;
+    }
+    goto call;
+  }
+
+ op_return:
+  result = stack->values[stack->size - 1];
+ return_result: {
+    value_t *record = stack->values + fp + slots;
+    r_pc   = as_integer(ctxt, record[0]);
+    r_fp   = as_integer(ctxt, record[1]);
+    r_env  = record[2];
+    r_tmpl = record[3];
+
+    vm_drop(ctxt, stack->size - (fp - 1));
+    goto resume;
+  }
+
+  // two fixnums or doubles, and the operator's still the native it was compiled
+  // against; otherwise it's an ordinary call
+ op_prim: {
+    prim_t   prim = (prim_t)(ARG & 0xFF);
+    value_t *top  = stack->values + stack->size;
+
+    argc = 2;
+    if (!is_native_proc(ctxt, top[-3]) ||
+        native_proc_prim(ctxt, top[-3]) != prim ||
+        !prim_numbers(ctxt, prim, top[-2], top[-1], &result)) {
+      if (ARG >> 8) {
+        goto tailcall_argc;
+      }
+      goto call_argc;
+    }
+
+    vm_drop(ctxt, 3);
+    if (ARG >> 8) {
+      goto return_result;
+    }
+    vm_push(stack, result);
+    NEXT();
+  }
+
+  // the proc and argc args are on top of the stack, and r_* is where to go after
+ call:
+  proc = stack->values[stack->size - argc - 1];
+
+  if (is_compiled(ctxt, proc)) {
+    tmpl = compound_proc_args(ctxt, proc);
+
+    // the same error a native gives for the wrong number of args
+    if (argc != template_field(ctxt, tmpl, T_PARAMS)) {
+      vm_drop(ctxt, argc + 1);
+      result = make_error(ctxt, __LINE__);
+      goto resume;
+    }
+
+    int nslots = template_field(ctxt, tmpl, T_SLOTS);
+    if (!eval_reserve(ctxt, nslots + RETURN_SIZE + template_field(ctxt, tmpl, T_DEPTH))) {
+      goto overflow;
+    }
+    fp = stack->size - argc;
+
+    if (is_truthy(ctxt, vector_data(ctxt, tmpl)[T_HEAP])) {
+      result = make_vector(ctxt, nslots + 1, vnil);
+      vector_set(ctxt, result, 0, compound_proc_env(ctxt, proc));
+      for (int i = 0; i < argc; i++) {
+        vector_set(ctxt, result, i + 1, stack->values[fp + i]);
+      }
+      vm_drop(ctxt, argc);
+
+      env   = result;
+      slots = 0;
+    }
+    else {
+      for (int i = argc; i < nslots; i++) {
+        vm_push(stack, vnil);
+      }
+
+      env   = compound_proc_env(ctxt, proc);
+      slots = nslots;
+    }
+
+    vm_push(stack, make_integer(ctxt, r_pc));
+    vm_push(stack, make_integer(ctxt, r_fp));
+    vm_push(stack, r_env);
+    vm_push(stack, r_tmpl);
+
+    code   = vector_data(ctxt, vector_data(ctxt, tmpl)[T_CODE]);
+    consts = vector_data(ctxt, tmpl) + T_CONSTS;
+    pc     = code;
+
+    // hot templates get compiled, once
+    int jitted = template_field(ctxt, tmpl, T_JIT);
+    if (jitted > 0) {
+      goto jit;
+    }
+    if (jitted == 0 && ctxt->jit_threshold > 0) {
+      int calls = template_field(ctxt, tmpl, T_CALLS) + 1;
+      vector_data(ctxt, tmpl)[T_CALLS] = make_integer(ctxt, calls);
+      if (calls >= ctxt->jit_threshold) {
+        if (jit_compile(ctxt, tmpl)) {
+          goto jit;
+        }
+        vector_set(ctxt, tmpl, T_JIT, make_integer(ctxt, -1));
+      }
+    }
+    NEXT();
+  }
+
+  // a native gets its args where they are, on the stack
+  if (is_native_proc(ctxt, proc)) {
+    if (!native_proc_accepts(ctxt, proc, argc)) {
+      vm_drop(ctxt, argc + 1);
+      result = make_error(ctxt, __LINE__);
+      goto resume;
+    }
+
+    native_proc_fn fn = native_proc_function(ctxt, proc);
+    result = (*fn)(ctxt, argc, stack->values + stack->size - argc);
+    vm_drop(ctxt, argc + 1);
+    goto resume;
+  }
+
+  printf("not a function!\n");
+  vm_drop(ctxt, argc + 1);
+  result = vnil;
+  goto resume;
+
+  // result takes the callee's place on the stack, and r_* carries on
+ resume:
+  vm_push(stack, result);
+  if (is_nil(ctxt, r_tmpl)) {
+    goto done;
+  }
+
+  tmpl   = r_tmpl;
+  env    = r_env;
+  fp     = r_fp;
+  slots  = template_slots(ctxt, tmpl);
+  code   = vector_data(ctxt, vector_data(ctxt, tmpl)[T_CODE]);
+  consts = vector_data(ctxt, tmpl) + T_CONSTS;
+  pc     = code + r_pc;
+  if (template_field(ctxt, tmpl, T_JIT) > 0) {
+    goto jit;
+  }
+  NEXT();
+
+  // the compiled code runs until it needs the vm, and says where to
+  // carry on; it may have written anywhere in the frame
+ jit:
+  st.sp      = stack->values + stack->size;
+  st.fp      = stack->values + fp;
+  st.consts  = consts;
+  st.globals = ctxt->globals.values;
+  if (!jit_enter(ctxt, tmpl, &st, pc - code)) {
+    NEXT();
+  }
+
+  stack->size = st.sp - stack->values;
+  if (fp - 1 < ctxt->eval_stack_clean) {
+    ctxt->eval_stack_clean = fp - 1;
+  }
+  if (st.pc == JIT_RETURN) {
+    result = stack->values[stack->size - 1];
+    goto return_result;
+  }
+  pc = code + st.pc;
+  NEXT();
+
+ overflow:
+  vm_drop(ctxt, stack->size - base);
+  gc_unroot(ctxt, frame);
+  return make_error(ctxt, __LINE__);
+
+ done:
+  vm_drop(ctxt, stack->size - base);
+  gc_unroot(ctxt, frame);
+  return result;
+}
+
+value_t vm_eval(context_p ctxt, value_t v, value_t *inoutenv) {
+  compiler_t c = { ctxt, NULL, 0, 0, vnil, 0, vnil, 0, 0, false };
+
+  int frame = gc_root_frame(ctxt);
+  gc_root(ctxt, &c.consts);
+  gc_root(ctxt, &c.scope);
+
+  compile(&c, v, true);
+  value_t tmpl = finish(&c, 0, 0, false);
+
+  gc_unroot(ctxt, frame);
+  if (c.failed) {
+    return make_error(ctxt, __LINE__);
+  }
+  return run(ctxt, tmpl, *inoutenv);
+}
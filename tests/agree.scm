@@ -0,0 +1,45 @@
+(define fact (lambda (n) (if (< n 2) 1 (* n (fact (- n 1))))))
+(fact 10)
+(define fib (lambda (n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2))))))
+(fib 20)
+(define loop (lambda (n acc) (if (= n 0) acc (loop (- n 1) (+ acc 2)))))
+(loop 100000 0)
+(define ev? (lambda (n) (if (= n 0) #t (od? (- n 1)))))
+(define od? (lambda (n) (if (= n 0) #f (ev? (- n 1)))))
+(ev? 10001)
+(define f (lambda (x) (define y (* x 2)) (define z (+ y 1)) (list x y z)))
+(f 5)
+(define adder (lambda (n) (lambda (x) (+ x n))))
+(define add3 (adder 3))
+(add3 4)
+(define counter (lambda (x) (define y (+ x 1)) (lambda (z) (list x y z))))
+((counter 1) 7)
+(define outer (lambda (x) (define inner (lambda (y) (+ x y))) (inner (inner 1))))
+(outer 10)
+(define hot (lambda (n acc) (if (= n 0) acc (hot (- n 1) (cons n acc)))))
+(define len (lambda (l) (if (null? l) 0 (+ 1 (len (cdr l))))))
+(len (hot 200 (quote ())))
+(define sum (lambda (v i acc) (if (= i (vector-length v)) acc (sum v (+ i 1) (+ acc (vector-ref v i))))))
+(sum (make-vector 100 3) 0 0)
+(define g (lambda (a b) (list a b)))
+(g 1)
+(g 1 2 3)
+(g 1 2)
+(car 1 2)
+(quotient 17 5)
+(remainder -17 5)
+(* 140737488355327 2)
+(- -140737488355328 1)
+(+ 1.5 2)
+(< 1 2.5)
+(string-length "hello")
+(substring "hello world" 6 11)
+(symbol->string (quote abc))
+(string->number "42")
+(number->string 99)
+(char->integer \a)
+(if (eq? (quote a) (quote a)) (quote yes) (quote no))
+(begin 1 2 3)
+((lambda (x y) (+ x y)) 3 4)
+; a reference 260 heap frames out, past what a byte of depth holds
+((lambda (x) ((lambda (a1) ((lambda (a2) ((lambda (a3) ((lambda (a4) ((lambda (a5) ((lambda (a6) ((lambda (a7) ((lambda (a8) ((lambda (a9) ((lambda (a10) ((lambda (a11) ((lambda (a12) ((lambda (a13) ((lambda (a14) ((lambda (a15) ((lambda (a16) ((lambda (a17) ((lambda (a18) ((lambda (a19) ((lambda (a20) ((lambda (a21) ((lambda (a22) ((lambda (a23) ((lambda (a24) ((lambda (a25) ((lambda (a26) ((lambda (a27) ((lambda (a28) ((lambda (a29) ((lambda (a30) ((lambda (a31) ((lambda (a32) ((lambda (a33) ((lambda (a34) ((lambda (a35) ((lambda (a36) ((lambda (a37) ((lambda (a38) ((lambda (a39) ((lambda (a40) ((lambda (a41) ((lambda (a42) ((lambda (a43) ((lambda (a44) ((lambda (a45) ((lambda (a46) ((lambda (a47) ((lambda (a48) ((lambda (a49) ((lambda (a50) ((lambda (a51) ((lambda (a52) ((lambda (a53) ((lambda (a54) ((lambda (a55) ((lambda (a56) ((lambda (a57) ((lambda (a58) ((lambda (a59) ((lambda (a60) ((lambda (a61) ((lambda (a62) ((lambda (a63) ((lambda (a64) ((lambda (a65) ((lambda (a66) ((lambda (a67) ((lambda (a68) ((lambda (a69) ((lambda (a70) ((lambda (a71) ((lambda (a72) ((lambda (a73) ((lambda (a74) ((lambda (a75) ((lambda (a76) ((lambda (a77) ((lambda (a78) ((lambda (a79) ((lambda (a80) ((lambda (a81) ((lambda (a82) ((lambda (a83) ((lambda (a84) ((lambda (a85) ((lambda (a86) ((lambda (a87) ((lambda (a88) ((lambda (a89) ((lambda (a90) ((lambda (a91) ((lambda (a92) ((lambda (a93) ((lambda (a94) ((lambda (a95) ((lambda (a96) ((lambda (a97) ((lambda (a98) ((lambda (a99) ((lambda (a100) ((lambda (a101) ((lambda (a102) ((lambda (a103) ((lambda (a104) ((lambda (a105) ((lambda (a106) ((lambda (a107) ((lambda (a108) ((lambda (a109) ((lambda (a110) ((lambda (a111) ((lambda (a112) ((lambda (a113) ((lambda (a114) ((lambda (a115) ((lambda (a116) ((lambda (a117) ((lambda (a118) ((lambda (a119) ((lambda (a120) ((lambda (a121) ((lambda (a122) ((lambda (a123) ((lambda (a124) ((lambda (a125) ((lambda (a126) ((lambda (a127) ((lambda (a128) ((lambda (a129) ((lambda (a130) ((lambda (a131) ((lambda (a132) ((lambda (a133) ((lambda (a134) ((lambda (a135) ((lambda (a136) ((lambda (a137) ((lambda (a138) ((lambda (a139) ((lambda (a140) ((lambda (a141) ((lambda (a142) ((lambda (a143) ((lambda (a144) ((lambda (a145) ((lambda (a146) ((lambda (a147) ((lambda (a148) ((lambda (a149) ((lambda (a150) ((lambda (a151) ((lambda (a152) ((lambda (a153) ((lambda (a154) ((lambda (a155) ((lambda (a156) ((lambda (a157) ((lambda (a158) ((lambda (a159) ((lambda (a160) ((lambda (a161) ((lambda (a162) ((lambda (a163) ((lambda (a164) ((lambda (a165) ((lambda (a166) ((lambda (a167) ((lambda (a168) ((lambda (a169) ((lambda (a170) ((lambda (a171) ((lambda (a172) ((lambda (a173) ((lambda (a174) ((lambda (a175) ((lambda (a176) ((lambda (a177) ((lambda (a178) ((lambda (a179) ((lambda (a180) ((lambda (a181) ((lambda (a182) ((lambda (a183) ((lambda (a184) ((lambda (a185) ((lambda (a186) ((lambda (a187) ((lambda (a188) ((lambda (a189) ((lambda (a190) ((lambda (a191) ((lambda (a192) ((lambda (a193) ((lambda (a194) ((lambda (a195) ((lambda (a196) ((lambda (a197) ((lambda (a198) ((lambda (a199) ((lambda (a200) ((lambda (a201) ((lambda (a202) ((lambda (a203) ((lambda (a204) ((lambda (a205) ((lambda (a206) ((lambda (a207) ((lambda (a208) ((lambda (a209) ((lambda (a210) ((lambda (a211) ((lambda (a212) ((lambda (a213) ((lambda (a214) ((lambda (a215) ((lambda (a216) ((lambda (a217) ((lambda (a218) ((lambda (a219) ((lambda (a220) ((lambda (a221) ((lambda (a222) ((lambda (a223) ((lambda (a224) ((lambda (a225) ((lambda (a226) ((lambda (a227) ((lambda (a228) ((lambda (a229) ((lambda (a230) ((lambda (a231) ((lambda (a232) ((lambda (a233) ((lambda (a234) ((lambda (a235) ((lambda (a236) ((lambda (a237) ((lambda (a238) ((lambda (a239) ((lambda (a240) ((lambda (a241) ((lambda (a242) ((lambda (a243) ((lambda (a244) ((lambda (a245) ((lambda (a246) ((lambda (a247) ((lambda (a248) ((lambda (a249) ((lambda (a250) ((lambda (a251) ((lambda (a252) ((lambda (a253) ((lambda (a254) ((lambda (a255) ((lambda (a256) ((lambda (a257) ((lambda (a258) ((lambda (a259) ((lambda (a260) (begin a1 a2 a3 a4 a5 a6 a7 a8 a9 a10 a11 a12 a13 a14 a15 a16 a17 a18 a19 a20 a21 a22 a23 a24 a25 a26 a27 a28 a29 a30 a31 a32 a33 a34 a35 a36 a37 a38 a39 a40 a41 a42 a43 a44 a45 a46 a47 a48 a49 a50 a51 a52 a53 a54 a55 a56 a57 a58 a59 a60 a61 a62 a63 a64 a65 a66 a67 a68 a69 a70 a71 a72 a73 a74 a75 a76 a77 a78 a79 a80 a81 a82 a83 a84 a85 a86 a87 a88 a89 a90 a91 a92 a93 a94 a95 a96 a97 a98 a99 a100 a101 a102 a103 a104 a105 a106 a107 a108 a109 a110 a111 a112 a113 a114 a115 a116 a117 a118 a119 a120 a121 a122 a123 a124 a125 a126 a127 a128 a129 a130 a131 a132 a133 a134 a135 a136 a137 a138 a139 a140 a141 a142 a143 a144 a145 a146 a147 a148 a149 a150 a151 a152 a153 a154 a155 a156 a157 a158 a159 a160 a161 a162 a163 a164 a165 a166 a167 a168 a169 a170 a171 a172 a173 a174 a175 a176 a177 a178 a179 a180 a181 a182 a183 a184 a185 a186 a187 a188 a189 a190 a191 a192 a193 a194 a195 a196 a197 a198 a199 a200 a201 a202 a203 a204 a205 a206 a207 a208 a209 a210 a211 a212 a213 a214 a215 a216 a217 a218 a219 a220 a221 a222 a223 a224 a225 a226 a227 a228 a229 a230 a231 a232 a233 a234 a235 a236 a237 a238 a239 a240 a241 a242 a243 a244 a245 a246 a247 a248 a249 a250 a251 a252 a253 a254 a255 a256 a257 a258 a259 a260 x)) 260)) 259)) 258)) 257)) 256)) 255)) 254)) 253)) 252)) 251)) 250)) 249)) 248)) 247)) 246)) 245)) 244)) 243)) 242)) 241)) 240)) 239)) 238)) 237)) 236)) 235)) 234)) 233)) 232)) 231)) 230)) 229)) 228)) 227)) 226)) 225)) 224)) 223)) 222)) 221)) 220)) 219)) 218)) 217)) 216)) 215)) 214)) 213)) 212)) 211)) 210)) 209)) 208)) 207)) 206)) 205)) 204)) 203)) 202)) 201)) 200)) 199)) 198)) 197)) 196)) 195)) 194)) 193)) 192)) 191)) 190)) 189)) 188)) 187)) 186)) 185)) 184)) 183)) 182)) 181)) 180)) 179)) 178)) 177)) 176)) 175)) 174)) 173)) 172)) 171)) 170)) 169)) 168)) 167)) 166)) 165)) 164)) 163)) 162)) 161)) 160)) 159)) 158)) 157)) 156)) 155)) 154)) 153)) 152)) 151)) 150)) 149)) 148)) 147)) 146)) 145)) 144)) 143)) 142)) 141)) 140)) 139)) 138)) 137)) 136)) 135)) 134)) 133)) 132)) 131)) 130)) 129)) 128)) 127)) 126)) 125)) 124)) 123)) 122)) 121)) 120)) 119)) 118)) 117)) 116)) 115)) 114)) 113)) 112)) 111)) 110)) 109)) 108)) 107)) 106)) 105)) 104)) 103)) 102)) 101)) 100)) 99)) 98)) 97)) 96)) 95)) 94)) 93)) 92)) 91)) 90)) 89)) 88)) 87)) 86)) 85)) 84)) 83)) 82)) 81)) 80)) 79)) 78)) 77)) 76)) 75)) 74)) 73)) 72)) 71)) 70)) 69)) 68)) 67)) 66)) 65)) 64)) 63)) 62)) 61)) 60)) 59)) 58)) 57)) 56)) 55)) 54)) 53)) 52)) 51)) 50)) 49)) 48)) 47)) 46)) 45)) 44)) 43)) 42)) 41)) 40)) 39)) 38)) 37)) 36)) 35)) 34)) 33)) 32)) 31)) 30)) 29)) 28)) 27)) 26)) 25)) 24)) 23)) 22)) 21)) 20)) 19)) 18)) 17)) 16)) 15)) 14)) 13)) 12)) 11)) 10)) 9)) 8)) 7)) 6)) 5)) 4)) 3)) 2)) 1)) 42)
@@ -0,0 +1,38 @@
+(define fact (lambda (n) (if (< n 2) 1 (* n (fact (- n 1))))))
+(define pow (lambda (b n) (if (= n 0) 1 (* b (pow b (- n 1))))))
+(fact 20)
+(fact 25)
+(fact 30)
+(fact 50)
+(pow 2 47)
+(pow 2 48)
+(pow 2 64)
+(pow 2 100)
+(pow 3 80)
+(pow -7 41)
+(pow 10 40)
+(+ (fact 30) (pow 3 40))
+(- (pow 2 64) (pow 2 65))
+(- (pow 2 64) (pow 2 64))
+(+ (pow 2 64) (- 0 (pow 2 64)) 5)
+(* (pow 10 40) (pow 10 40))
+(* (fact 50) (- 0 (fact 40)))
+(* (pow 7 400) (pow 11 300))
+(= (* (pow 3 500) (pow 3 500)) (pow 9 500))
+(quotient (fact 30) (pow 2 20))
+(remainder (fact 30) (+ (pow 3 40) 17))
+(quotient (- 0 (pow 2 100)) 7)
+(remainder (- 0 (pow 2 100)) 7)
+(quotient (pow 2 100) (pow 2 99))
+(< (pow 2 100) (pow 2 101))
+(< (- 0 (pow 2 100)) 1)
+(> (pow 2 64) 140737488355327)
+(= (pow 2 64) (* (pow 2 32) (pow 2 32)))
+(- (pow 2 47) 1)
+(+ 140737488355327 1)
+(- -140737488355328 1)
+(* 140737488355327 140737488355327)
+(number->string (pow 2 90))
+(string->number "123456789012345678901234567890")
+(+ (string->number "-99999999999999999999") 1)
+(integer? (pow 2 80))
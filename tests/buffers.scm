@@ -0,0 +1,46 @@
+; slices share their parent's store, so writes show through both ways
+(define b (string->buffer "hello, buffers"))
+(define s (buffer-slice b 7))
+(define ss (buffer-slice s 1 4))
+(list (buffer-length s) (buffer-length ss))
+(buffer->string ss)
+(buffer-set! s 0 66)
+(buffer->string b)
+(buffer-set! ss 0 85)
+(buffer->string b)
+(buffer-set! b 9 70)
+(buffer->string ss)
+(buffer-fill! ss 45)
+(buffer->string b)
+; out of range
+(buffer-slice b 15)
+(buffer-slice b 3 2)
+(buffer-slice b -1)
+(buffer-slice s 0 8)
+(buffer-ref ss 3)
+(buffer-set! ss 3 0)
+(buffer-ref b 14)
+(buffer-set! b 0 256)
+; searching, comparing and copying between slices of one store
+(define d (string->buffer "abcdefabcdef"))
+(define lo (buffer-slice d 0 8))
+(define hi (buffer-slice d 4))
+(list (buffer-index d 99) (buffer-index hi 99) (buffer-index lo 99 3) (buffer-index hi 122))
+(buffer-index lo 97 9)
+(list (buffer-compare lo hi) (buffer-compare hi lo) (buffer-compare (buffer-slice d 0 3) (buffer-slice d 6 9)))
+(list (buffer-compare (buffer-slice d 0 2) (buffer-slice d 6 9)) (buffer-compare d (buffer-slice d 0 12)))
+(buffer-copy! hi 0 lo)
+(buffer->string d)
+(buffer-copy! d 0 (buffer-slice d 2 10))
+(buffer->string d)
+(buffer-copy! lo 1 hi)
+(buffer-copy! hi 9 (buffer-slice d 0 0))
+; through a file and back
+(define f (make-buffer 300 7))
+(buffer-set! f 299 255)
+(write-buffer "buffers.dat" (buffer-slice f 100))
+(define r (read-buffer "buffers.dat"))
+(list (buffer-length r) (buffer-ref r 0) (buffer-ref r 199) (buffer-compare r (buffer-slice f 100)))
+(append-buffer "buffers.dat" (string->buffer "end"))
+(buffer->string (buffer-slice (read-buffer "buffers.dat") 200))
+(read-buffer "no-such-file.dat")
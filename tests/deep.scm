@@ -0,0 +1,7 @@
+; non-tail recursion a million deep runs on the heap, not the c stack
+(define count (lambda (n) (if (= n 0) 0 (+ 1 (count (- n 1))))))
+(count 1000000)
+(define build (lambda (n) (if (= n 0) (quote ()) (cons n (build (- n 1))))))
+(define len (lambda (l) (if (null? l) 0 (+ 1 (len (cdr l))))))
+(len (build 1000000))
+(count 10)
@@ -0,0 +1,59 @@
+; numeric vectors, at lengths that leave a tail past the simd width
+(define set-each (lambda (v set! i n f) (if (= i n) v (begin (set! v i (f i)) (set-each v set! (+ i 1) n f)))))
+(define u (set-each (make-u8vector 37) u8vector-set! 0 37 (lambda (i) (* i 7))))
+(define s (set-each (make-s32vector 37) s32vector-set! 0 37 (lambda (i) (- (* i i) 500))))
+(define f (set-each (make-f64vector 37) f64vector-set! 0 37 (lambda (i) (* i 0.5))))
+(u8vector-set! u 36 255)
+(s32vector-set! s 36 -1000)
+(f64vector-set! f 36 -1.5)
+(list (u8vector-length u) (s32vector-length s) (f64vector-length f))
+(list (numvec-sum u) (numvec-sum s) (numvec-sum f))
+(list (numvec-dot u u) (numvec-dot s s) (numvec-dot f f))
+(list (numvec-min u) (numvec-min s) (numvec-min f))
+(list (numvec-max u) (numvec-max s) (numvec-max f))
+(list (u8vector-ref u 36) (s32vector-ref s 35) (f64vector-ref f 35))
+; exact sums and dots past a fixnum
+(numvec-sum (make-s32vector 70001 2147483647))
+(numvec-sum (make-s32vector 70001 -2147483648))
+(numvec-dot (make-s32vector 3 -2147483648) (make-s32vector 3 -2147483648))
+(numvec-dot (make-s32vector 3 -2147483648) (make-s32vector 3 2147483647))
+(numvec-sum (make-u8vector 70001 255))
+; integer elements wrap
+(define w (u8vector 200 100 3))
+(numvec-scale! w 2)
+w
+(numvec-add! w (u8vector 200 100 250))
+w
+(numvec-scale! u 3)
+(numvec-sum u)
+(define i (s32vector 2147483647 -2147483648))
+(numvec-add! i (s32vector 1 -1))
+i
+(numvec-scale! i -1)
+i
+(numvec-scale! f 2)
+(numvec-sum f)
+(numvec-add! f f)
+(numvec-max f)
+; fill and copy
+(numvec-fill! s 3)
+(numvec-sum s)
+(define c (make-s32vector 5 0))
+(numvec-copy! c (s32vector 1 2 3))
+c
+(numvec-copy! (s32vector 1 2) c)
+(numvec-copy! c (u8vector 1 2))
+(numvec-dot s c)
+(numvec-add! s c)
+; no extreme of nothing
+(numvec-min (make-f64vector 0))
+(numvec-max (make-s32vector 0))
+(numvec-sum (make-u8vector 0))
+; each typed name takes only its own type
+(f64vector-ref (make-u8vector 3 7) 0)
+(u8vector-length (make-f64vector 5))
+(s32vector-set! (make-f64vector 2) 0 1.5)
+(u8vector-ref (make-s32vector 3 1) 0)
+(f64vector-length (make-f64vector 5))
+(u8vector? (make-u8vector 1))
+(s32vector? (make-u8vector 1))
@@ -0,0 +1,57 @@
+; what --optimize folds, prunes, drops and inlines has to answer what
+; the plain evaluators do, in every mode
+(define fold (lambda (x) (+ x (* 2 3) (- 10 4))))
+(fold 1)
+(define fold-error (lambda () (quotient 1 0)))
+(fold-error)
+(define fold-arity (lambda () (car (quote (1)) 2)))
+(fold-arity)
+(define prune (lambda (x) (if (< 1 2) x (car x))))
+(prune 5)
+(define prune-else (lambda (x) (if #f (car x) (list x))))
+(prune-else 5)
+(define drop (lambda (x) 1 x "s" \a (+ x 1)))
+(drop 1)
+(define drop-all (lambda () 1 2 3))
+(drop-all)
+(define sq (lambda (x) (* x x)))
+(define use-sq (lambda (n) (+ (sq n) (sq 2))))
+(use-sq 5)
+; an impure arg used twice in the body isn't inlined, or it'd run twice
+(define dbl (lambda (x) (list x x)))
+(define use-dbl (lambda () (dbl (print-debug 4))))
+(use-dbl)
+; the body mentions a global the caller has a local of the same name for
+(define x 100)
+(define addx (lambda (y) (+ x y)))
+(define use-addx (lambda (x) (addx x)))
+(use-addx 1)
+(define two (lambda (a b) (+ a b)))
+(define use-two (lambda () (two 1)))
+(use-two)
+(define use-two-more (lambda () (two 1 2 3)))
+(use-two-more)
+; deeper than inlines go inside of inlines
+(define i1 (lambda (x) (+ x 1)))
+(define i2 (lambda (x) (i1 (+ x 1))))
+(define i3 (lambda (x) (i2 (+ x 1))))
+(define i4 (lambda (x) (i3 (+ x 1))))
+(define i5 (lambda (x) (i4 (+ x 1))))
+(define i6 (lambda (x) (i5 (+ x 1))))
+(define use-i6 (lambda (x) (i6 x)))
+(use-i6 0)
+(define fact (lambda (n) (if (< n 2) 1 (* n (fact (- n 1))))))
+(define use-fact (lambda () (fact 5)))
+(use-fact)
+; what was inlined or folded can still be defined again
+(define sq (lambda (x) (+ x 1)))
+(sq 3)
+(use-sq 5)
+(define i1 (lambda (x) (- x 1)))
+(use-i6 0)
+(define eq? (lambda (a b) #f))
+(use-sq 5)
+(define * (lambda (a b) 0))
+(fold 1)
+(define < (lambda (a b) #f))
+(prune 5)
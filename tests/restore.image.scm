@@ -0,0 +1,14 @@
+; the world restore.scm expects to find in the image
+(define n 42)
+(define big (* 99999999999 99999999999))
+(define s "hello world")
+(define sub (substring s 6 11))
+(define sym (quote restored))
+(define l (list 1 2 (list 3 4) "five"))
+(define v (make-vector 3 (quote x)))
+(vector-set! v 1 sub)
+(define fv (f64vector 1.5 2.5 3))
+(define adder (lambda (k) (lambda (x) (+ x k))))
+(define add10 (adder 10))
+(define count (lambda (n acc) (if (= n 0) acc (count (- n 1) (+ acc 1)))))
+(count 1000 0)
@@ -0,0 +1,16 @@
+n
+big
+(* big big)
+s
+sub
+(substring sub 1 4)
+sym
+l
+v
+(f64vector-ref fv 1)
+(numvec-sum fv)
+(add10 5)
+((adder 1) 1)
+(count 5000 0)
+(define more (lambda (x) (list x n)))
+(more 1)
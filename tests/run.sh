@@ -0,0 +1,53 @@
+#!/bin/sh
+# runs each tests/*.scm under eval, the vm, and the vm without the jit,
+# and eval and the vm optimized, and diffs what it prints with
+# tests/*.out. a test with a NAME.image.scm next to it runs against the
+# image that file leaves behind. error codes are line numbers in the
+# source, so only that there was one's compared. a NAME.flags holds
+# options the test always runs with. a run that doesn't exit 0 fails.
+# tests run in a scratch directory under $TMPDIR, so the files they
+# write are theirs alone.
+
+scheme=${1:-out/scheme}
+case "$scheme" in
+  */*) scheme=$(cd "$(dirname "$scheme")" && pwd)/$(basename "$scheme") ;;
+esac
+dir=$(cd "$(dirname "$0")" && pwd)
+work=${TMPDIR:-/tmp}/scheme-test-$$
+image=$work.image
+output=$work.out
+failed=0
+
+for test in "$dir"/*.scm; do
+  case "$test" in
+    *.image.scm) continue ;;
+  esac
+
+  name=$(basename "$test" .scm)
+  flags=""
+  if [ -f "$dir/$name.flags" ]; then
+    flags=$(cat "$dir/$name.flags")
+  fi
+
+  for mode in "" "--vm" "--vm --no-jit" "--optimize" "--vm --optimize"; do
+    load=""
+    if [ -f "$dir/$name.image.scm" ]; then
+      rm -f "$image"
+      "$scheme" $mode --save-image "$image" "$dir/$name.image.scm" > /dev/null 2>&1 < /dev/null
+      load="--image $image"
+    fi
+
+    rm -rf "$work"
+    mkdir -p "$work"
+    if (cd "$work" && "$scheme" $mode $flags $load "$test" < /dev/null 2> /dev/null > "$output") &&
+        sed 's/^!!! error: .*/!!! error/' "$output" | diff -u "$dir/$name.out" - > /dev/null; then
+      echo "ok   $name ${mode:-eval}"
+    else
+      echo "FAIL $name ${mode:-eval}"
+      failed=1
+    fi
+  done
+done
+
+rm -rf "$work" "$image" "$output"
+exit $failed
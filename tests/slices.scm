@@ -0,0 +1,18 @@
+; enough dead strings that the pool gets compacted, with slices (and
+; slices of slices) held across it; they have to still read right
+(define get (lambda (key l) (if (eq? (car (car l)) key) (cdr (car l)) (get key (cdr l)))))
+(define majors (get (quote gc-major) (heap-stats)))
+(define mk (lambda (n acc) (if (= n 0) acc (mk (- n 1) (cons (substring (number->string (+ 1000000 n)) 1 7) acc)))))
+(define sl (mk 3000 (quote ())))
+(define junk (lambda (n) (if (= n 0) 0 (begin (cons (number->string (* n 7919)) n) (junk (- n 1))))))
+(junk 100000)
+(define sub2 (lambda (l acc) (if (null? l) acc (sub2 (cdr l) (cons (substring (car l) 2 6) acc)))))
+(define s2 (sub2 sl (quote ())))
+(junk 200000)
+(define chk (lambda (l n ok) (if (null? l) ok (chk (cdr l) (+ n 1) (if (= (string->number (car l)) n) (+ ok 1) ok)))))
+(chk sl 1 0)
+(define chk2 (lambda (l n ok) (if (null? l) ok (chk2 (cdr l) (- n 1) (if (= (string->number (car l)) (remainder n 10000)) (+ ok 1) ok)))))
+(chk2 s2 3000 0)
+(string-ref (car sl) 5)
+(substring (car (cdr s2)) 1 3)
+(> (get (quote gc-major) (heap-stats)) majors)
@@ -0,0 +1,13 @@
+; with tests/stacklimit.flags' --stack-limit, too deep is an error value,
+; not a crash, and the stack's good again after
+(define count (lambda (n) (if (= n 0) 0 (+ 1 (count (- n 1))))))
+(count 20)
+(count 1000000)
+(count 20)
+; tail calls don't use any of it up
+(define loop (lambda (n acc) (if (= n 0) acc (loop (- n 1) (+ acc 1)))))
+(loop 100000 0)
+(define build (lambda (n) (if (= n 0) (quote ()) (cons n (build (- n 1))))))
+(build 5)
+(build 2000)
+(count 20)
@@ -0,0 +1,8 @@
+; tail calls run in constant space: three million of them, under
+; tests/tail.flags' stack limit
+(define loop (lambda (n acc) (if (= n 0) acc (loop (- n 1) (+ acc 1)))))
+(loop 3000000 0)
+; through begin, and between procs with different numbers of args
+(define ping (lambda (n) (begin (if (= n 0) (quote done) (pong n 1)))))
+(define pong (lambda (n step) (ping (- n step))))
+(ping 3000000)